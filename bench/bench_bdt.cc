@@ -0,0 +1,162 @@
+// Benchmark: TreeEnsemble inference (run_analysis --bdt) one event at a time
+// and in batches (scalar and AVX2 tree walks), against TMVA::Reader for TMVA
+// weight files. Inputs are
+// synthetic, drawn around the split thresholds of each feature so every
+// path of the trees is used.
+//
+// Usage: bench_bdt MODEL.json|MODEL.xml [--events N] [--batch N] [--reps N]
+
+#include "TreeEnsemble.h"
+#include "Selection.h"
+
+#include <TMVA/Reader.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+// Best wall time of `reps` runs, in seconds
+static double bestOf(int reps, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    std::size_t n = 1000000, batch = 256;
+    int reps = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--events" && i + 1 < argc)     { n = std::max(1ULL, std::strtoull(argv[++i], nullptr, 10)); }
+        else if (a == "--batch" && i + 1 < argc) { batch = std::max(1ULL, std::strtoull(argv[++i], nullptr, 10)); }
+        else if (a == "--reps" && i + 1 < argc)  { reps = std::max(1, std::atoi(argv[++i])); }
+        else if (!a.empty() && a[0] != '-' && path.empty()) { path = a; }
+        else {
+            std::cerr << "Usage: bench_bdt MODEL.json|MODEL.xml [--events N] [--batch N] [--reps N]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "ERROR: No model file" << std::endl;
+        return 1;
+    }
+
+    TreeEnsemble model;
+    if (!model.load(path)) {
+        std::cerr << "ERROR: " << model.getError() << std::endl;
+        return 1;
+    }
+    const std::size_t nf = static_cast<std::size_t>(model.getNumFeatures());
+    const std::size_t nOut = static_cast<std::size_t>(model.getNumOutputs());
+    std::cout << "Model: " << path << ": " << model.getNumTrees() << " trees, " << model.getNumNodes()
+              << " nodes, max depth " << model.getMaxDepth() << ", " << nf << " features, " << nOut
+              << " output(s)" << std::endl;
+
+    // Uniform over the split range of each feature, widened by 10% each side
+    std::mt19937_64 rng(12345);
+    std::vector<float> rows(n * nf);
+    auto ranges = model.getSplitRanges();
+    for (std::size_t f = 0; f < nf; ++f) {
+        float pad = 0.1f * (ranges[f].second - ranges[f].first) + 1e-3f;
+        std::uniform_real_distribution<float> u(ranges[f].first - pad, ranges[f].second + pad);
+        for (std::size_t i = 0; i < n; ++i) rows[i * nf + f] = u(rng);
+    }
+
+    std::cout << "\n" << std::left << std::setw(28) << "Path" << std::right << std::setw(12) << "Mevt/s"
+              << std::setw(12) << "ns/evt" << std::setw(10) << "Speedup" << std::setw(14) << "Max |diff|"
+              << std::endl;
+    std::cout << std::string(76, '-') << std::endl;
+    double tRef = 0;
+    auto row = [&](const std::string& name, double t, double diff) {
+        if (tRef == 0) tRef = t;
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << n / t / 1e6 << std::setprecision(1) << std::setw(12) << 1e9 * t / n
+                  << std::setprecision(2) << std::setw(9) << tRef / t << "x";
+        if (diff >= 0) std::cout << std::scientific << std::setprecision(2) << std::setw(14) << diff;
+        std::cout << std::defaultfloat << std::endl;
+    };
+
+    // Reference: TMVA::Reader, one event at a time (TMVA weight files only)
+    std::vector<float> ref;
+    if (endsWith(path, ".xml")) {
+        std::vector<Float_t> vars(nf), spectators(model.getSpectatorNames().size());
+        TMVA::Reader reader("!Color:Silent");
+        for (std::size_t f = 0; f < nf; ++f) reader.AddVariable(model.getFeatureNames()[f].c_str(), &vars[f]);
+        for (std::size_t s = 0; s < spectators.size(); ++s) {
+            reader.AddSpectator(model.getSpectatorNames()[s].c_str(), &spectators[s]);
+        }
+        reader.BookMVA("BDT", path.c_str());
+        ref.resize(n * nOut);
+        double t = bestOf(reps, [&] {
+            for (std::size_t i = 0; i < n; ++i) {
+                std::copy(&rows[i * nf], &rows[i * nf] + nf, vars.begin());
+                if (nOut == 1) {
+                    ref[i] = static_cast<float>(reader.EvaluateMVA("BDT"));
+                } else {
+                    const std::vector<Float_t>& v = reader.EvaluateMulticlass("BDT");
+                    std::copy(v.begin(), v.begin() + std::min(v.size(), nOut), &ref[i * nOut]);
+                }
+            }
+        });
+        row("TMVA::Reader", t, -1);
+    }
+
+    auto maxDiff = [&](const std::vector<float>& out) {
+        if (ref.empty()) return -1.0;
+        double d = 0;
+        for (std::size_t i = 0; i < out.size(); ++i) d = std::max(d, std::fabs(double(out[i]) - ref[i]));
+        return d;
+    };
+
+    std::vector<float> out(n * nOut);
+    double tSingle = bestOf(reps, [&] {
+        for (std::size_t i = 0; i < n; ++i) model.predict(&rows[i * nf], 1, &out[i * nOut]);
+    });
+    row("TreeEnsemble, 1 event", tSingle, maxDiff(out));
+
+    // Every level must give the outputs of the scalar walk exactly
+    std::vector<float> scalarOut;
+    bool allMatch = true;
+    double worst = -1;
+    SimdLevel best = EventSelector::detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2}) {
+        std::string name = "TreeEnsemble, batch " + std::to_string(batch) + " " + simdLevelName(level);
+        if (level > best) {
+            std::cout << std::left << std::setw(28) << name << "  (not supported by this CPU)" << std::endl;
+            continue;
+        }
+        std::fill(out.begin(), out.end(), 0.0f);
+        double t = bestOf(reps, [&] {
+            for (std::size_t i = 0; i < n; i += batch) {
+                model.predict(&rows[i * nf], std::min(batch, n - i), &out[i * nOut], level);
+            }
+        });
+        row(name, t, maxDiff(out));
+        if (scalarOut.empty()) scalarOut = out;
+        allMatch = allMatch && out == scalarOut;
+        worst = std::max(worst, maxDiff(out));
+    }
+    if (!allMatch) std::cerr << "ERROR: SIMD outputs differ from the scalar walk" << std::endl;
+
+    // Float outputs: a difference near 1e-6 against TMVA is rounding; more
+    // means a different leaf somewhere
+    return allMatch && worst < 1e-4 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Benchmark: per-event scheme dispatch by string key (the old event loop:
+// string-compared scheme flag, map lookups for data, cutflow and histograms)
+// vs SchemeId (flag table, vectors indexed by scheme and variable).
+//
+// Usage: bench_scheme_dispatch [nEvents] [repetitions]
+
+#include "Config.h"
+#include "Selection.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+// The scheme flag check as it was before SchemeId
+static bool legacySchemeFlag(const EventData& evt, const std::string& schemeKey) {
+    if (schemeKey == "nonRes")              return evt.is_nonRes > 0.5;
+    if (schemeKey == "nonResReg")           return evt.is_nonResReg > 0.5;
+    if (schemeKey == "nonResReg_DNNpair")   return evt.is_nonResReg_DNNpair > 0.5;
+    if (schemeKey == "nonResReg_vbfpair")   return evt.is_nonResReg_vbfpair > 0.5;
+    if (schemeKey == "Res")                 return evt.is_Res > 0.5;
+    if (schemeKey == "Res_DNNpair")         return evt.is_Res_DNNpair > 0.5;
+    return false;
+}
+
+static const char* const kVars[] = {"dijet_mass", "lead_bjet_pt", "sublead_bjet_pt", "M_X"};
+static constexpr int kNVars = 4;
+
+static double varValue(const SchemeData& sd, int v) {
+    switch (v) {
+        case 0:  return sd.dijet_mass;
+        case 1:  return sd.lead_bjet_pt;
+        case 2:  return sd.sublead_bjet_pt;
+        default: return sd.M_X;
+    }
+}
+
+// Best wall time of `reps` runs, in seconds
+static double bestOf(int reps, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int reps      = (argc > 2) ? std::atoi(argv[2]) : 5;
+
+    std::cout << "Generating " << n << " synthetic events..." << std::endl;
+    std::mt19937_64 rng(12345);
+    std::uniform_real_distribution<double> u(0, 1);
+    std::vector<EventData> events(n);
+    std::vector<SchemeData> schemeRows(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        EventData& e = events[i];
+        e.weight = 1.0;
+        e.mass = 90 + 100 * u(rng);
+        e.lead_pt = 20 + 130 * u(rng);
+        e.sublead_pt = 15 + 85 * u(rng);
+        e.lead_mvaID = -1 + 2 * u(rng);
+        e.sublead_mvaID = -1 + 2 * u(rng);
+        for (int s = 0; s < N_SCHEMES; ++s) e.*kSchemeFlags[s] = u(rng) < 0.6 ? 1 : 0;
+        SchemeData& sd = schemeRows[i];
+        sd.dijet_mass = u(rng) < 0.1 ? SENTINEL : 300 * u(rng);
+        sd.lead_bjet_pt = 10 + 140 * u(rng);
+        sd.sublead_bjet_pt = 10 + 110 * u(rng);
+        sd.M_X = 200 + 1200 * u(rng);
+    }
+
+    EventSelector selector;
+    std::vector<std::string> keys;
+    for (auto& [key, _] : getSchemes()) keys.push_back(key);
+
+    // Old loop: everything keyed by scheme / variable name
+    std::map<std::string, SchemeData> legacyData;
+    std::map<std::string, Cutflow> legacyCutflows;
+    std::map<std::string, std::map<std::string, double>> legacySums;
+    double tLegacy = bestOf(reps, [&] {
+        for (auto& key : keys) {
+            legacyCutflows[key] = selector.makeCutflow(key);
+            for (auto v : kVars) legacySums[key][v] = 0;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            const EventData& evt = events[i];
+            for (auto& key : keys) {
+                Cutflow& cf = legacyCutflows[key];
+                cf.record(0, evt.weight);
+                if (!legacySchemeFlag(evt, key)) continue;
+                if (!selector.passDiphotonMass(evt) || !selector.passPhotonPt(evt) ||
+                    !selector.passPhotonMvaId(evt)) continue;
+                cf.record(4, evt.weight);
+                SchemeData& sd = legacyData[key];
+                sd = schemeRows[i];
+                if (!selector.passSchemeCuts(sd)) continue;
+                auto& hs = legacySums[key];
+                for (int v = 0; v < kNVars; ++v) hs[kVars[v]] += varValue(sd, v) * evt.weight;
+            }
+        }
+    });
+
+    // New loop: SchemeId and pre-resolved vectors
+    std::vector<SchemeData> data(N_SCHEMES);
+    std::vector<Cutflow> cutflows(N_SCHEMES);
+    std::vector<std::vector<double>> sums(N_SCHEMES);
+    double tIndexed = bestOf(reps, [&] {
+        for (int s = 0; s < N_SCHEMES; ++s) {
+            cutflows[s] = selector.makeCutflow(keys[s]);
+            sums[s].assign(kNVars, 0);
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            const EventData& evt = events[i];
+            for (int s = 0; s < N_SCHEMES; ++s) {
+                Cutflow& cf = cutflows[s];
+                cf.record(0, evt.weight);
+                if (!selector.passCommonCuts(evt, static_cast<SchemeId>(s))) continue;
+                cf.record(4, evt.weight);
+                SchemeData& sd = data[s];
+                sd = schemeRows[i];
+                if (!selector.passSchemeCuts(sd)) continue;
+                double* h = sums[s].data();
+                for (int v = 0; v < kNVars; ++v) h[v] += varValue(sd, v) * evt.weight;
+            }
+        }
+    });
+
+    bool match = true;
+    for (int s = 0; s < N_SCHEMES; ++s) {
+        match = match && cutflows[s].steps[4].nEvents == legacyCutflows[keys[s]].steps[4].nEvents;
+        for (int v = 0; v < kNVars; ++v) match = match && sums[s][v] == legacySums[keys[s]][kVars[v]];
+    }
+
+    std::cout << std::left << std::setw(28) << "Dispatch"
+              << std::right << std::setw(12) << "Mevt/s"
+              << std::setw(10) << "Speedup" << std::endl;
+    std::cout << std::string(50, '-') << std::endl;
+    std::cout << std::left << std::setw(28) << "string keys + maps"
+              << std::right << std::setw(12) << std::fixed << std::setprecision(2) << n / tLegacy / 1e6
+              << std::setw(9) << 1.0 << "x" << std::endl;
+    std::cout << std::left << std::setw(28) << "SchemeId + vectors"
+              << std::right << std::setw(12) << n / tIndexed / 1e6
+              << std::setw(9) << tLegacy / tIndexed << "x" << std::endl;
+    std::cout << "\n" << N_SCHEMES << " schemes per event, results "
+              << (match ? "identical" : "DIFFER") << std::endl;
+    return match ? 0 : 1;
+}
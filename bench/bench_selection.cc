@@ -0,0 +1,131 @@
+// Benchmark: per-event EventSelector::passPreselection vs the batch
+// preselection (scalar, AVX2, AVX-512) on a synthetic sample.
+//
+// Usage: bench_selection [nEvents] [repetitions]
+
+#include "Config.h"
+#include "Selection.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+struct SyntheticSample {
+    std::vector<double> mass, lead_pt, sublead_pt, lead_mvaID, sublead_mvaID;
+    std::vector<double> dijet_mass, lead_bjet_pt, sublead_bjet_pt;
+    std::vector<unsigned char> flag;
+
+    explicit SyntheticSample(std::size_t n) {
+        std::mt19937_64 rng(12345);
+        std::uniform_real_distribution<double> u(0, 1);
+        auto uni = [&](double lo, double hi) { return lo + (hi - lo) * u(rng); };
+        auto orSentinel = [&](double frac, double v) { return u(rng) < frac ? SENTINEL : v; };
+        for (std::size_t i = 0; i < n; ++i) {
+            mass.push_back(uni(90, 190));
+            lead_pt.push_back(uni(20, 150));
+            sublead_pt.push_back(uni(15, 100));
+            lead_mvaID.push_back(uni(-1, 1));
+            sublead_mvaID.push_back(uni(-1, 1));
+            flag.push_back(u(rng) < 0.6 ? 1 : 0);
+            dijet_mass.push_back(orSentinel(0.10, uni(0, 300)));
+            lead_bjet_pt.push_back(orSentinel(0.05, uni(10, 150)));
+            sublead_bjet_pt.push_back(orSentinel(0.05, uni(10, 120)));
+        }
+    }
+
+    SelectionColumns columns() const {
+        SelectionColumns c;
+        c.n = mass.size();
+        c.mass = mass.data();
+        c.lead_pt = lead_pt.data();
+        c.sublead_pt = sublead_pt.data();
+        c.lead_mvaID = lead_mvaID.data();
+        c.sublead_mvaID = sublead_mvaID.data();
+        c.schemeFlag = flag.data();
+        c.dijet_mass = dijet_mass.data();
+        c.lead_bjet_pt = lead_bjet_pt.data();
+        c.sublead_bjet_pt = sublead_bjet_pt.data();
+        return c;
+    }
+};
+
+// Best wall time of `reps` runs, in seconds
+static double bestOf(int reps, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    int reps      = (argc > 2) ? std::atoi(argv[2]) : 5;
+
+    std::cout << "Generating " << n << " synthetic events..." << std::endl;
+    SyntheticSample sample(n);
+    SelectionColumns cols = sample.columns();
+    EventSelector selector;
+    const std::string key = "nonRes";
+
+    // Reference: one event at a time through EventData / SchemeData
+    std::vector<uint64_t> ref((n + 63) / 64, 0);
+    double tEvent = bestOf(reps, [&] {
+        EventData evt;
+        SchemeData sd;
+        std::fill(ref.begin(), ref.end(), 0);
+        for (std::size_t i = 0; i < n; ++i) {
+            evt.mass = cols.mass[i];
+            evt.lead_pt = cols.lead_pt[i];
+            evt.sublead_pt = cols.sublead_pt[i];
+            evt.lead_mvaID = cols.lead_mvaID[i];
+            evt.sublead_mvaID = cols.sublead_mvaID[i];
+            evt.is_nonRes = cols.schemeFlag[i];
+            sd.dijet_mass = cols.dijet_mass[i];
+            sd.lead_bjet_pt = cols.lead_bjet_pt[i];
+            sd.sublead_bjet_pt = cols.sublead_bjet_pt[i];
+            if (selector.passPreselection(evt, sd, key)) ref[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    });
+
+    long long nPass = 0;
+    for (auto w : ref) nPass += __builtin_popcountll(w);
+
+    std::cout << std::left << std::setw(28) << "Path"
+              << std::right << std::setw(12) << "Mevt/s"
+              << std::setw(10) << "Speedup"
+              << std::setw(10) << "Match" << std::endl;
+    std::cout << std::string(60, '-') << std::endl;
+    auto row = [&](const std::string& name, double t, bool match) {
+        std::cout << std::left << std::setw(28) << name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(1) << n / t / 1e6
+                  << std::setw(9) << std::setprecision(2) << tEvent / t << "x"
+                  << std::setw(10) << (match ? "yes" : "NO") << std::endl;
+    };
+    row("per-event passPreselection", tEvent, true);
+
+    bool allMatch = true;
+    SimdLevel best = EventSelector::detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > best) {
+            std::cout << std::left << std::setw(28) << (std::string("batch ") + simdLevelName(level))
+                      << "  (not supported by this CPU)" << std::endl;
+            continue;
+        }
+        std::vector<uint64_t> mask(ref.size(), 0);
+        double t = bestOf(reps, [&] { selector.passPreselectionBatch(cols, mask.data(), level); });
+        bool match = (mask == ref);
+        allMatch = allMatch && match;
+        row(std::string("batch ") + simdLevelName(level), t, match);
+    }
+
+    std::cout << "\nPassing events: " << nPass << " / " << n << std::endl;
+    return allMatch ? 0 : 1;
+}
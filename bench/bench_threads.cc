@@ -0,0 +1,155 @@
+// Benchmark: run_analysis event loop on 1 thread vs N threads over the same
+// input, and a bin-by-bin check that both give the same bits (histograms,
+// mass planes, sparse-store projections, unbinned lists and cutflows).
+//
+// Usage: bench_threads FILE... [--threads N] [--in-memory] [--no-sparse]
+//
+// Exits 1 when any bin differs.
+
+#include "Analysis.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+// Bitwise comparison of two runs; prints the first few differences
+class RunComparison {
+public:
+    void values(const std::string& what, const std::vector<double>& a, const std::vector<double>& b) {
+        bool same = a.size() == b.size() &&
+                    (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0);
+        count(what, same);
+    }
+    void hist(const std::string& what, const FastHist1D& a, const FastHist1D& b) {
+        values(what + " sumw", a.getSumw(), b.getSumw());
+        values(what + " sumw2", a.getSumw2(), b.getSumw2());
+        count(what + " entries", a.getEntries() == b.getEntries());
+    }
+    void hist(const std::string& what, const FastHist2D& a, const FastHist2D& b) {
+        values(what + " sumw", a.getSumw(), b.getSumw());
+        values(what + " sumw2", a.getSumw2(), b.getSumw2());
+        count(what + " entries", a.getEntries() == b.getEntries());
+    }
+    void count(const std::string& what, bool same) {
+        ++nChecked_;
+        if (same) return;
+        if (nDiffs_ < 10) std::cout << "  DIFF " << what << std::endl;
+        ++nDiffs_;
+    }
+    int checked() const { return nChecked_; }
+    int diffs() const { return nDiffs_; }
+
+private:
+    int nChecked_ = 0;
+    int nDiffs_ = 0;
+};
+
+static void compareSets(const HistogramSet& a, const HistogramSet& b, RunComparison& cmp) {
+    for (auto& [name, h] : a.common) cmp.hist("common " + name, h, b.common.at(name));
+    for (auto& [key, hists] : a.scheme) {
+        for (auto& [name, h] : hists) cmp.hist(key + " " + name, h, b.scheme.at(key).at(name));
+    }
+    for (auto& [key, h] : a.massPlane) cmp.hist(key + " mass plane", h, b.massPlane.at(key));
+    // The cells of a sparse store are unordered; compare every projection
+    for (auto& [key, s] : a.sparse) {
+        const SparseHist& t = b.sparse.at(key);
+        cmp.count(key + " sparse cells", s.getOccupiedCells() == t.getOccupiedCells());
+        for (int x = 0; x < static_cast<int>(s.getAxes().size()); ++x) {
+            const std::string& axis = s.getAxes()[x].name;
+            cmp.hist(key + " sparse " + axis, s.project1D(x), t.project1D(x));
+        }
+    }
+    for (auto& [key, u] : a.unbinned) {
+        const UnbinnedEvents& v = b.unbinned.at(key);
+        cmp.values(key + " unbinned mgg", u.mgg, v.mgg);
+        cmp.values(key + " unbinned mjj", u.mjj, v.mjj);
+        cmp.values(key + " unbinned weight", u.weight, v.weight);
+        cmp.count(key + " unbinned category", u.category == v.category);
+    }
+    for (auto& [key, cf] : a.cutflows) {
+        const Cutflow& other = b.cutflows.at(key);
+        cmp.count(key + " cutflow steps", cf.steps.size() == other.steps.size());
+        for (size_t i = 0; i < std::min(cf.steps.size(), other.steps.size()); ++i) {
+            const CutflowStep& p = cf.steps[i];
+            const CutflowStep& q = other.steps[i];
+            cmp.count(key + " cutflow " + p.label,
+                      p.nEvents == q.nEvents && p.sumW == q.sumW && p.sumW2 == q.sumW2);
+        }
+    }
+}
+
+static std::unique_ptr<HistogramSet> bookSet(const EventSelector& selector,
+                                             const std::vector<std::string>& keys, bool sparse) {
+    auto hists = std::make_unique<HistogramSet>();
+    hists->book(keys);
+    if (sparse) hists->bookSparse(keys);
+    hists->bookUnbinned(keys);
+    hists->initCutflows(selector, keys);
+    return hists;
+}
+
+int main(int argc, char** argv) {
+    RunOptions opts;
+    int threads = 4;
+    bool sparse = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--threads" && i + 1 < argc) { threads = std::max(2, std::atoi(argv[++i])); }
+        else if (a == "--in-memory")          { opts.inMemory = true; }
+        else if (a == "--no-sparse")          { sparse = false; }
+        else if (!a.empty() && a[0] != '-')   { opts.files.push_back(a); }
+        else {
+            std::cerr << "Usage: bench_threads FILE... [--threads N] [--in-memory] [--no-sparse]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (opts.files.empty()) {
+        std::cerr << "ERROR: No input file" << std::endl;
+        return 1;
+    }
+    for (auto& [key, scheme] : getSchemes()) opts.schemeKeys.push_back(key);
+
+    EventSelector selector;
+    std::vector<int> counts = {1, threads};
+    std::vector<std::unique_ptr<HistogramSet>> results;
+    std::vector<double> seconds;
+    Long64_t nEvents = 0;
+    for (int n : counts) {
+        RunOptions runOpts = opts;
+        runOpts.threads = n;
+        auto hists = bookSet(selector, opts.schemeKeys, sparse);
+        auto t0 = std::chrono::steady_clock::now();
+        RunReport report = runEventLoop(runOpts, selector, *hists);
+        auto t1 = std::chrono::steady_clock::now();
+        if (!report.failures.empty()) {
+            for (auto& msg : report.failures) std::cerr << "ERROR: " << msg << std::endl;
+            return 1;
+        }
+        nEvents = report.nEvents;
+        seconds.push_back(std::chrono::duration<double>(t1 - t0).count());
+        results.push_back(std::move(hists));
+    }
+
+    RunComparison cmp;
+    compareSets(*results[0], *results[1], cmp);
+
+    std::cout << "\n" << nEvents << " events from " << opts.files.size() << " file(s)\n"
+              << std::left << std::setw(12) << "Threads" << std::right << std::setw(12) << "Time [s]"
+              << std::setw(14) << "Mevents/s" << std::setw(10) << "Speedup" << std::endl;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        std::cout << std::left << std::setw(12) << counts[i] << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(12) << seconds[i] << std::setw(14)
+                  << nEvents / seconds[i] / 1e6 << std::setprecision(2) << std::setw(10)
+                  << seconds[0] / seconds[i] << std::endl;
+    }
+    std::cout << "\n" << cmp.checked() << " comparisons, " << cmp.diffs() << " different; Match "
+              << (cmp.diffs() == 0 ? "yes" : "NO") << std::endl;
+    return cmp.diffs() == 0 ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+// Benchmark: file size vs run_analysis read throughput for the output layouts
+// the converters offer (TreeLayout.h). The input tree is rewritten once per
+// setting (compression x cluster size x branch order), then the event loop of
+// run_analysis runs over the copy, with the page cache of the copy dropped
+// first so the reads hit the disk.
+//
+// Usage: bench_tree_layout INPUT.root [--tree NAME] [--entries N] [--threads N]
+//                          [--compressions LIST] [--cluster-mb LIST]
+//                          [--order hot|original|both] [--work-dir DIR]
+//                          [--write-hot FILE]
+//
+// --write-hot writes the branches run_analysis reads, for csv_to_root
+// --hot-branches, and exits.
+
+#include "Analysis.h"
+#include "DataLoader.h"
+#include "TreeLayout.h"
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TObjArray.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Setting {
+    TreeLayout layout;
+    bool hotFirst = true;
+    std::string label;
+};
+
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::istringstream iss(s);
+    for (std::string item; std::getline(iss, item, ',');) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static std::vector<std::string> allSchemeKeys() {
+    std::vector<std::string> keys;
+    for (auto& [key, scheme] : getSchemes()) keys.push_back(key);
+    return keys;
+}
+
+// Branches the event loop binds, in binding order
+static std::vector<std::string> analysisBranches(const std::string& file, const std::string& treeName) {
+    DataLoader loader(file, treeName);
+    std::vector<std::string> names;
+    if (!loader.isOpen()) return names;
+    EventData evt;
+    std::vector<SchemeData> sds(N_SCHEMES);
+    loader.setupBranches(evt);
+    for (auto& key : allSchemeKeys()) loader.setupSchemeBranches(sds[schemeIndex(key)], key);
+    for (auto& b : loader.getSelectionBindings()) names.push_back(b.name);
+    for (auto& b : loader.getEventBindings()) names.push_back(b.name);
+    for (auto& group : loader.getSchemeBindings()) {
+        for (auto& b : group) names.push_back(b.name);
+    }
+    return names;
+}
+
+// Copy the first nEntries entries of every single-value branch into output
+// with the given layout. Returns false if either file cannot be opened.
+static bool writeCopy(const std::string& input, const std::string& treeName, Long64_t nEntries,
+                      const std::string& output, const Setting& setting) {
+    std::unique_ptr<TFile> in(TFile::Open(input.c_str(), "READ"));
+    TTree* tree = in ? dynamic_cast<TTree*>(in->Get(treeName.c_str())) : nullptr;
+    if (!tree) return false;
+
+    std::vector<std::string> names;
+    std::vector<char> types;
+    TObjArray* list = tree->GetListOfBranches();
+    for (int b = 0; b < list->GetEntriesFast(); ++b) {
+        auto* br = static_cast<TBranch*>(list->UncheckedAt(b));
+        char type = branchTypeCode(br);
+        if (type == 0) continue;
+        names.push_back(br->GetName());
+        types.push_back(type);
+    }
+    std::deque<uint64_t> buffers(names.size(), 0);
+    tree->SetBranchStatus("*", 0);
+    for (std::size_t c = 0; c < names.size(); ++c) {
+        tree->SetBranchStatus(names[c].c_str(), 1);
+        tree->SetBranchAddress(names[c].c_str(), static_cast<void*>(&buffers[c]));
+    }
+
+    std::unique_ptr<TFile> out(TFile::Open(output.c_str(), "RECREATE"));
+    if (!out || out->IsZombie()) return false;
+    applyFileLayout(out.get(), setting.layout);
+    out->cd();
+    TTree* copy = new TTree(treeName.c_str(), treeName.c_str()); // owned by out
+    std::vector<std::string> hot = setting.hotFirst ? setting.layout.hotBranches
+                                                    : std::vector<std::string>{};
+    for (std::size_t c : hotFirstOrder(names, hot)) {
+        copy->Branch(names[c].c_str(), static_cast<void*>(&buffers[c]),
+                     (names[c] + "/" + types[c]).c_str());
+    }
+    applyTreeLayout(copy, setting.layout);
+
+    Long64_t n = std::min(nEntries, tree->GetEntries());
+    for (Long64_t i = 0; i < n; ++i) {
+        tree->GetEntry(i);
+        copy->Fill();
+    }
+    out->cd();
+    copy->Write();
+    out->Close();
+    return true;
+}
+
+// Drop the cached pages of a file so the next read comes from disk
+static void dropPageCache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static double fileMB(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size / (1024.0 * 1024.0) : 0.0;
+}
+
+int main(int argc, char** argv) {
+    std::string input, treeName = "data", workDir = "/tmp", writeHot;
+    std::string compressions = "none,lz4:4,zlib:1,zlib:6,zstd:5,zstd:9";
+    std::string clusterMB = "30";
+    std::string order = "both";
+    Long64_t nEntries = 200000;
+    int threads = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--tree" && i + 1 < argc)              { treeName = argv[++i]; }
+        else if (a == "--entries" && i + 1 < argc)      { nEntries = std::atoll(argv[++i]); }
+        else if (a == "--threads" && i + 1 < argc)      { threads = std::max(1, std::atoi(argv[++i])); }
+        else if (a == "--compressions" && i + 1 < argc) { compressions = argv[++i]; }
+        else if (a == "--cluster-mb" && i + 1 < argc)   { clusterMB = argv[++i]; }
+        else if (a == "--order" && i + 1 < argc)        { order = argv[++i]; }
+        else if (a == "--work-dir" && i + 1 < argc)     { workDir = argv[++i]; }
+        else if (a == "--write-hot" && i + 1 < argc)    { writeHot = argv[++i]; }
+        else if (!a.empty() && a[0] != '-' && input.empty()) { input = a; }
+        else {
+            std::cerr << "Usage: bench_tree_layout INPUT.root [--tree NAME] [--entries N] [--threads N]\n"
+                         "                         [--compressions LIST] [--cluster-mb LIST]\n"
+                         "                         [--order hot|original|both] [--work-dir DIR]\n"
+                         "                         [--write-hot FILE]" << std::endl;
+            return 1;
+        }
+    }
+    if (input.empty()) {
+        std::cerr << "ERROR: No input file" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> hot = analysisBranches(input, treeName);
+    if (hot.empty()) {
+        std::cerr << "ERROR: Cannot read tree '" << treeName << "' from " << input << std::endl;
+        return 1;
+    }
+    if (!writeHot.empty()) {
+        std::ofstream out(writeHot);
+        out << "Branches: " << hot.size() << "\n";
+        for (auto& name : hot) out << name << "\n";
+        std::cout << "Wrote " << hot.size() << " analysis branches to " << writeHot << std::endl;
+        return out ? 0 : 1;
+    }
+
+    std::vector<Setting> settings;
+    for (auto& comp : splitList(compressions)) {
+        for (auto& mb : splitList(clusterMB)) {
+            for (int hotFirst = 1; hotFirst >= 0; --hotFirst) {
+                if ((order == "hot" && !hotFirst) || (order == "original" && hotFirst)) continue;
+                Setting s;
+                if (comp != "default" && !parseCompression(comp, s.layout)) {
+                    std::cerr << "ERROR: Unknown compression '" << comp << "'" << std::endl;
+                    return 1;
+                }
+                s.layout.autoFlush = -(std::max(1LL, std::atoll(mb.c_str())) << 20);
+                s.layout.hotBranches = hot;
+                s.hotFirst = hotFirst;
+                s.label = compressionName(s.layout) + " " + mb + "MB " + (hotFirst ? "hot" : "orig");
+                settings.push_back(s);
+            }
+        }
+    }
+
+    std::vector<std::string> schemeKeys = allSchemeKeys();
+    EventSelector selector;
+    std::cout << "Input: " << input << ", up to " << nEntries << " entries, " << hot.size()
+              << " analysis branches, " << threads << " thread(s)\n" << std::endl;
+    std::cout << std::left << std::setw(24) << "setting" << std::right
+              << std::setw(10) << "write s" << std::setw(11) << "size MB"
+              << std::setw(10) << "read s" << std::setw(12) << "events/s"
+              << std::setw(12) << "file MB/s" << std::endl;
+
+    const std::string copy = workDir + "/bench_tree_layout.root";
+    for (auto& s : settings) {
+        auto t0 = std::chrono::steady_clock::now();
+        if (!writeCopy(input, treeName, nEntries, copy, s)) {
+            std::cerr << "ERROR: Cannot write " << copy << std::endl;
+            return 1;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double mb = fileMB(copy);
+        dropPageCache(copy);
+
+        RunOptions opts;
+        opts.files = {copy};
+        opts.schemeKeys = schemeKeys;
+        opts.threads = threads;
+        HistogramSet hists;
+        hists.book(schemeKeys);
+        hists.initCutflows(selector, schemeKeys);
+        auto t2 = std::chrono::steady_clock::now();
+        RunReport report = runEventLoop(opts, selector, hists);
+        auto t3 = std::chrono::steady_clock::now();
+
+        double writeS = std::chrono::duration<double>(t1 - t0).count();
+        double readS = std::chrono::duration<double>(t3 - t2).count();
+        std::cout << std::left << std::setw(24) << s.label << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(10) << writeS
+                  << std::setw(11) << mb << std::setw(10) << readS
+                  << std::setprecision(0) << std::setw(12) << report.nEvents / readS
+                  << std::setprecision(1) << std::setw(12) << mb / readS << std::endl;
+    }
+    std::remove(copy.c_str());
+    return 0;
+}
@@ -0,0 +1,208 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "Config.h"
+#include "DataLoader.h"
+#include "Selection.h"
+#include "Plotter.h"
+#include "ColumnStore.h"
+#include "FastHist.h"
+#include "SparseHist.h"
+#include "UnbinnedExport.h"
+#include "TreeEnsemble.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+// All histograms and cutflows filled by the event loop. The histograms are
+// FastHist values; Plotter converts them to ROOT histograms when drawing.
+class HistogramSet {
+public:
+    std::map<std::string, FastHist1D> common;
+    std::map<std::string, std::map<std::string, FastHist1D>> scheme;
+    std::map<std::string, FastHist2D> massPlane;
+    std::map<std::string, Cutflow> cutflows;
+    // Optional per-scheme sparse store over getSparseAxisDefs(); filled like
+    // the mass plane (after the scheme cuts, not in the blinded window)
+    std::map<std::string, SparseHist> sparse;
+    // Optional per-scheme unbinned (mgg, mjj, weight, category) of the same
+    // events; add() appends, so merged results keep work-unit order
+    std::map<std::string, UnbinnedEvents> unbinned;
+    // Models evaluated per scheme (run_analysis --bdt); their outputs are
+    // ordinary scheme histograms, see bookBdt
+    std::vector<BdtVariable> bdt;
+
+    // Book every histogram of getPlotDefs() / getSchemePlotDefs()
+    void book(const std::vector<std::string>& schemeKeys);
+
+    // Book an empty sparse store for every scheme
+    void bookSparse(const std::vector<std::string>& schemeKeys);
+
+    // Book an empty unbinned event list for every scheme
+    void bookUnbinned(const std::vector<std::string>& schemeKeys);
+
+    // Add the output histograms of each model to every scheme (call after
+    // book); they are cached, merged and drawn like the others
+    void bookBdt(const std::vector<BdtVariable>& vars, const std::vector<std::string>& schemeKeys);
+
+    // Empty cutflow for every scheme
+    void initCutflows(const EventSelector& selector, const std::vector<std::string>& schemeKeys);
+
+    // Empty copy with the same binning
+    std::unique_ptr<HistogramSet> cloneEmpty() const;
+
+    // Bin-by-bin sum of another set with the same layout
+    void add(const HistogramSet& other);
+};
+
+// One event-loop instance: its own file handle and branch bindings.
+// Several workers can run concurrently on disjoint entry ranges.
+class AnalysisWorker {
+public:
+    AnalysisWorker(const std::string& filename, const std::vector<std::string>& schemeKeys,
+                   const EventSelector& selector, bool doBlind,
+                   const ReadCacheOptions& readCache = ReadCacheOptions{});
+    // Same on a loader that is already open (and has nothing bound yet)
+    AnalysisWorker(std::unique_ptr<DataLoader> loader, const std::vector<std::string>& schemeKeys,
+                   const EventSelector& selector, bool doBlind,
+                   const ReadCacheOptions& readCache = ReadCacheOptions{});
+
+    bool isOpen() const { return loader_->isOpen(); }
+    DataLoader& getLoader() { return *loader_; }
+
+    // Load entries [begin, end) into an in-memory ColumnStore (selection
+    // branches now, the others as process() needs them); later process()
+    // calls inside that range run over its columns instead of ROOT I/O
+    bool cacheColumns(Long64_t begin, Long64_t end, const ColumnStoreOptions& opts);
+    const ColumnStore* getColumnStore() const { return store_.get(); }
+
+    // Process entries [begin, end) into hists. Cutflows are always counted;
+    // histograms only when fillHistograms is set, and the common ones only
+    // when fillCommon is also set. Can be called repeatedly. False on a read
+    // error of the loader: hists then holds part of the range and must be
+    // discarded.
+    bool process(Long64_t begin, Long64_t end, HistogramSet& hists, bool fillHistograms = true,
+                 bool fillCommon = true);
+
+private:
+    // Where a value is read: a field of the bound EventData / SchemeData
+    // (stride 0), or, after bindColumns, its ColumnStore column (offset 0,
+    // stride one element, row = entry - store begin)
+    struct ValueSource {
+        const char* base = nullptr;   // &evt_ / &slot.sd, or column data
+        FieldRef    field;
+        std::size_t stride = 0;
+
+        double read(Long64_t row) const { return field.read(base + row * stride); }
+    };
+
+    // One histogram of the fill table and the value it takes
+    struct FillSlot {
+        FastHist1D* hist = nullptr;
+        ValueSource value;
+        bool        blinded = false;
+    };
+
+    // One model evaluated for a scheme. Feature rows are buffered and run
+    // through the trees in batches; hists / weights wait for the outputs.
+    struct BdtSlot {
+        const BdtVariable* var = nullptr;
+        std::vector<ValueSource> features;
+        std::vector<FastHist1D*> hists; // per output
+        std::vector<float>  rows;       // pending events x features
+        std::vector<double> weights;    // pending events
+        std::vector<float>  out;
+    };
+
+    // One selected scheme: its bound branches and, during process(), the
+    // histograms and cutflow it fills (resolved once per call, not per event)
+    struct SchemeSlot {
+        SchemeId    id;
+        std::string key;
+        SchemeData  sd;
+        Cutflow*    cutflow = nullptr;
+        std::vector<FillSlot> fills;
+        FastHist2D* massPlane = nullptr;
+        ValueSource mjj;
+        SparseHist* sparse = nullptr;
+        std::vector<ValueSource> sparseAxes;
+        std::vector<double> sparseX; // values of the current event, one per axis
+        UnbinnedEvents* unbinned = nullptr;
+        std::vector<BdtSlot> bdt;
+    };
+
+    void resolveTargets(HistogramSet& hists, bool fillHistograms, bool fillCommon);
+    ValueSource source(const FieldRef& field, const void* structBase) const;
+    // Point every resolved ValueSource at its store column
+    void bindColumns();
+    void bindColumn(ValueSource& v) const;
+    // process() over the columns of store_; false if a column the selection
+    // needs is missing (the caller then reads through the loader)
+    bool processColumns(Long64_t begin, Long64_t end, bool fillHistograms, bool fillCommon);
+    // Histograms of a scheme for an event that passed its cuts
+    void fillScheme(SchemeSlot& slot, Long64_t row, double w, bool blindVeto);
+    static void fill(std::vector<FillSlot>& fills, Long64_t row, double w, bool blindVeto);
+    static void flushBdt(BdtSlot& b);
+    // True if an EventData field is bound in the selection group (always read)
+    bool inSelectionGroup(const FieldRef& field) const;
+
+    std::unique_ptr<DataLoader> loader_;
+    std::unique_ptr<ColumnStore> store_;
+    EventData evt_;
+    std::vector<SchemeSlot> slots_; // sized once: SchemeData addresses are bound
+    std::vector<FillSlot> commonFills_;
+    ValueSource mass_;            // mgg, for the mass plane and unbinned export
+    ValueSource bdtScores_[4];    // MultiBDT_output, for bdtCategory
+    bool schemeNeedsEvent_ = false; // a sparse axis, the unbinned category or a
+                                    // model feature reads an event-group branch
+    const EventSelector& selector_;
+    bool doBlind_;
+};
+
+// A contiguous entry range of one input file (end < 0: up to the last entry)
+struct WorkUnit {
+    size_t   fileIndex = 0;
+    Long64_t begin     = 0;
+    Long64_t end       = -1;
+};
+
+struct RunOptions {
+    std::vector<std::string> files;
+    std::vector<std::string> schemeKeys;
+    bool doBlind = true;
+    int  threads = 1;
+    bool fillHistograms = true; // false: cutflows only
+    bool fillCommon = true;     // false: leave the common histograms alone
+    bool inMemory = false;      // run each work unit over a ColumnStore
+    ColumnStoreOptions columnStore; // memoryBudget is shared by all threads
+    ReadCacheOptions readCache;     // per worker
+    uint64_t modelKey = 0;          // identity of the HistogramSet::bdt models
+};
+
+struct RunReport {
+    Long64_t nEvents = 0;
+    Long64_t bytesRead = 0; // uncompressed bytes of all branch reads
+    int nFilesOk = 0;
+    int nFilesReused = 0;              // incremental runs: taken from the saved state
+    std::vector<std::string> failures; // one message per failed file
+    std::vector<char> fileOk;          // per RunOptions::files entry
+    std::vector<Long64_t> fileEntries; // entries processed per file
+    Long64_t readCalls = 0;            // file read requests, all workers
+    Long64_t fileBytesRead = 0;        // compressed bytes read from the files
+    double prefetchEfficiency = -1;    // ReadStats, weighted by fileBytesRead; -1: no cache
+};
+
+// Run the event loop over all files on opts.threads threads. Every work unit
+// fills its own empty copy of `hists`; the copies are added back in unit
+// order. Histogram and cutflow sums are exact (see ExactSum.h), so the
+// result is bit-identical for any thread count (bench_threads checks it). A
+// file that cannot be opened, or hits a read error in any of its units, is
+// reported in the returned failures and none of its events are counted.
+// With perFile, the results of each input file are also returned separately
+// (an empty copy of hists for files that failed).
+RunReport runEventLoop(const RunOptions& opts, const EventSelector& selector,
+                       HistogramSet& hists,
+                       std::vector<std::unique_ptr<HistogramSet>>* perFile = nullptr);
+
+#endif
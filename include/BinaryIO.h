@@ -0,0 +1,36 @@
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Read/write helpers for the binary side files (result cache entries, sparse
+// stores): values are written in host layout, so the files are only read
+// back on the machine type that wrote them. Every reader checks the stream.
+
+template <typename T>
+inline void put(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+inline bool get(std::istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+// Length-prefixed; reading refuses lengths above 1 MB
+inline void putString(std::ostream& out, const std::string& s) {
+    put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+inline bool getString(std::istream& in, std::string& s) {
+    uint32_t n = 0;
+    if (!get(in, n) || n > (1u << 20)) return false;
+    s.resize(n);
+    return static_cast<bool>(in.read(&s[0], n));
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef COLUMNSTORE_H
+#define COLUMNSTORE_H
+
+#include "DataLoader.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <cstdint>
+
+struct ColumnStoreOptions {
+    std::size_t memoryBudget = std::size_t(2) << 30; // bytes kept in RAM
+    std::string spillDir     = "/tmp";
+};
+
+// In-memory columnar copy of the branches a DataLoader has bound.
+// Each branch becomes one contiguous array of its native type (double,
+// float, unsigned char, unsigned int, unsigned long long). Columns that do not fit in the
+// memory budget are backed by an unlinked temporary file in spillDir and
+// paged in by the kernel on access.
+//
+// Columns are filled by stage, like the DataLoader staged reads: load()
+// reads the selection group of every entry, loadEventRows / loadSchemeRows
+// the other groups only for the entries asked for (the ones passing the
+// event-level cuts), each entry at most once. The event loop reads the
+// arrays directly (AnalysisWorker::process, the batch preselection).
+class ColumnStore {
+public:
+    using Options = ColumnStoreOptions;
+
+    struct Column {
+        std::string name;
+        char        type = 'D';        // leafTypeCode
+        std::size_t elemSize = 0;
+        const void* target = nullptr;  // bound struct member
+        char*       data = nullptr;
+        std::size_t bytes = 0;         // allocated size
+        bool        spilled = false;
+    };
+
+    explicit ColumnStore(const Options& opts = Options{});
+    ~ColumnStore();
+    ColumnStore(const ColumnStore&) = delete;
+    ColumnStore& operator=(const ColumnStore&) = delete;
+
+    // Allocate a column for every bound branch of entries [begin, end) and
+    // read the selection group. Returns false if the loader is closed or a
+    // spill file cannot be created.
+    bool load(DataLoader& loader, Long64_t begin, Long64_t end);
+
+    // Read the event group / the group of one scheme for the entries of
+    // [begin, end) set in rows (bit (i % 64) of rows[i / 64] for entry
+    // begin + i; null: all of them) that are not loaded yet. The range must
+    // lie inside the store.
+    void loadEventRows(DataLoader& loader, Long64_t begin, Long64_t end, const uint64_t* rows);
+    void loadSchemeRows(DataLoader& loader, SchemeId id, Long64_t begin, Long64_t end,
+                        const uint64_t* rows);
+
+    Long64_t getBegin() const { return begin_; }
+    Long64_t getEnd() const { return begin_ + nRows_; }
+    Long64_t size() const { return nRows_; }
+    bool contains(Long64_t entry) const { return entry >= begin_ && entry < begin_ + nRows_; }
+
+    // Typed column access; nullptr if the branch is not stored or T does not
+    // match its native type. Row r holds tree entry getBegin() + r; rows not
+    // loaded yet read as 0.
+    template <typename T>
+    const T* column(const std::string& name) const {
+        auto it = byName_.find(name);
+        if (it == byName_.end()) return nullptr;
+        const Column& c = columns_[it->second];
+        if (c.type != leafTypeCode<T>()) return nullptr;
+        return reinterpret_cast<const T*>(c.data);
+    }
+    // Same, by the struct member the branch is bound to (e.g. &evt.mass)
+    template <typename T>
+    const T* column(const T* target) const {
+        const Column* c = find(target);
+        if (!c || c->type != leafTypeCode<T>()) return nullptr;
+        return reinterpret_cast<const T*>(c->data);
+    }
+    // Column bound to target, nullptr if none
+    const Column* find(const void* target) const;
+
+    const std::vector<Column>& getColumns() const { return columns_; }
+    std::size_t getMemoryBytes() const { return memoryBytes_; }
+    std::size_t getSpilledBytes() const { return spilledBytes_; }
+
+private:
+    // The columns of one read stage and the rows read so far
+    struct Group {
+        std::vector<size_t>   columns;
+        std::vector<uint64_t> loaded; // one bit per row
+    };
+
+    bool addGroup(const std::vector<BranchBinding>& bindings, Group& group);
+    char* allocate(std::size_t& bytes, bool& spilled);
+    template <typename Read>
+    void loadRows(Group& group, Long64_t begin, Long64_t end, const uint64_t* rows, Read read);
+    void release();
+
+    Options opts_;
+    Long64_t begin_ = 0;
+    Long64_t nRows_ = 0;
+    std::vector<Column> columns_;
+    std::map<std::string, size_t> byName_;
+    std::map<const void*, size_t> byTarget_;
+    Group selection_;
+    Group event_;
+    std::vector<Group> schemes_ = std::vector<Group>(N_SCHEMES);
+    std::size_t memoryBytes_ = 0;
+    std::size_t spilledBytes_ = 0;
+};
+
+#endif
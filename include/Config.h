@@ -4,6 +4,8 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <cstddef>
+#include <type_traits>
 
 // Physics constants
 constexpr double HIGGS_MASS   = 125.0;
@@ -21,6 +23,40 @@ struct JetPairingScheme {
     bool hasVbfBranches;
 };
 
+// The scheme keys, in getSchemes() (std::map key) order. SchemeId,
+// kSchemeKeys and kSchemeFlags (EventData.h) are all generated from this
+// list; getSchemes() is checked against it on first use.
+#define HH_SCHEMES(X) \
+    X(Res) X(Res_DNNpair) X(nonRes) X(nonResReg) X(nonResReg_DNNpair) X(nonResReg_vbfpair)
+
+// Dense scheme indices. The event loop works on these instead of string keys.
+enum class SchemeId : int {
+#define HH_SCHEME_ID(key) key,
+    HH_SCHEMES(HH_SCHEME_ID)
+#undef HH_SCHEME_ID
+};
+
+// Key of every SchemeId
+constexpr const char* kSchemeKeys[] = {
+#define HH_SCHEME_KEY(key) #key,
+    HH_SCHEMES(HH_SCHEME_KEY)
+#undef HH_SCHEME_KEY
+};
+constexpr int N_SCHEMES = static_cast<int>(sizeof(kSchemeKeys) / sizeof(kSchemeKeys[0]));
+
+constexpr bool schemeKeyLess(const char* a, const char* b) {
+    while (*a && *a == *b) ++a, ++b;
+    return static_cast<unsigned char>(*a) < static_cast<unsigned char>(*b);
+}
+constexpr bool schemeKeysSorted() {
+    for (int i = 1; i < N_SCHEMES; ++i) {
+        if (!schemeKeyLess(kSchemeKeys[i - 1], kSchemeKeys[i])) return false;
+    }
+    return true;
+}
+// SchemeId order must be the getSchemes() iteration order
+static_assert(schemeKeysSorted(), "HH_SCHEMES must list the keys in std::map (strcmp) order");
+
 struct SelectionCuts {
     double leadPtOverMgg    = 1.0 / 3.0;
     double subleadPtOverMgg = 1.0 / 4.0;
@@ -33,16 +69,65 @@ struct SelectionCuts {
     int    nBLooseMin       = 1;
 };
 
+// Where the event loop reads a plotted value: a double or float member of
+// EventData (source Event) or SchemeData (source Scheme), by byte offset.
+// Built in Config.cc with the EVT() / SD() macros.
+struct FieldRef {
+    enum Source : unsigned char { None, Event, Scheme };
+    Source      source = None;
+    char        type   = 'D'; // 'D' double, 'F' float, 'b' unsigned char
+    std::size_t offset = 0;
+
+    template <typename T>
+    static constexpr FieldRef of(Source source, std::size_t offset) {
+        static_assert(std::is_same<T, double>::value || std::is_same<T, float>::value ||
+                          std::is_same<T, unsigned char>::value,
+                      "plotted fields must be double, float or unsigned char");
+        return FieldRef{source,
+                        std::is_same<T, float>::value           ? 'F'
+                        : std::is_same<T, unsigned char>::value ? 'b'
+                                                                : 'D',
+                        offset};
+    }
+
+    // Value of the field in a struct starting at base
+    double read(const void* base) const {
+        const char* p = static_cast<const char*>(base) + offset;
+        switch (type) {
+            case 'F': return *reinterpret_cast<const float*>(p);
+            case 'b': return *reinterpret_cast<const unsigned char*>(p);
+            default:  return *reinterpret_cast<const double*>(p);
+        }
+    }
+};
+
 struct PlotDef {
     int nbins;
     double xmin;
     double xmax;
     std::string xlabel;
     std::string units;
+    FieldRef field;       // value filled by the event loop
+    bool blinded = false; // not filled inside [BLIND_LOW, BLIND_HIGH] when blinding
+};
+
+// One axis of the optional sparse N-dimensional store (run_analysis
+// --sparse, see SparseHist.h): uniform binning and the value it bins
+struct SparseAxisDef {
+    std::string name;
+    int nbins;
+    double xmin;
+    double xmax;
+    FieldRef field;
 };
 
 const std::map<std::string, JetPairingScheme>& getSchemes();
+// SchemeId <-> key; schemeIndex returns -1 for an unknown key
+int schemeIndex(const std::string& key);
+const std::string& schemeKeyOf(SchemeId id);
 std::map<std::string, PlotDef> getPlotDefs();
 std::map<std::string, PlotDef> getSchemePlotDefs();
+// Axes of the sparse store, in key order
+std::vector<SparseAxisDef> getSparseAxisDefs();
 
 #endif
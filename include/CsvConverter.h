@@ -0,0 +1,62 @@
+#ifndef CSVCONVERTER_H
+#define CSVCONVERTER_H
+
+#include "Schema.h"
+#include "TreeLayout.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// CSV -> ROOT TTree conversion (tools/csv_to_root). The CSV is memory-mapped
+// and cut into blocks of whole lines; worker threads parse blocks into column
+// chunks with std::from_chars while the calling thread fills the tree block
+// by block, so entries keep the CSV row order. Branch types come from a
+// schema (see Schema.h); columns it does not list are written as /D.
+struct CsvConvertOptions {
+    std::string input;
+    std::string output;
+    std::string treeName = "data";
+    int threads = 0;                          // parse threads; 0 → one per core
+    std::size_t blockBytes = std::size_t(8) << 20;
+    char delimiter = ',';
+    ColumnTypes schema;
+    TreeLayout layout;
+};
+
+struct CsvConvertReport {
+    bool ok = false;
+    std::string error;
+    int columns = 0;
+    long long rows = 0;
+    long long parseErrors = 0;  // fields that are not numbers, stored as 0
+    long long inexact = 0;      // values that do not fit their schema type
+    std::size_t inputBytes = 0;
+    double seconds = 0;
+};
+
+// Values of one block, column-major: value (row r, column c) is at
+// values[c * nRows + r]
+struct CsvColumnChunk {
+    std::size_t nRows = 0;
+    std::vector<double> values;
+    long long parseErrors = 0;
+};
+
+// Column names of a header line (trimmed, quotes removed)
+std::vector<std::string> parseCsvHeader(const char* begin, const char* end, char delimiter);
+
+// Parse the lines in [begin, end) (every line complete) into chunk. Short
+// lines are padded with 0, extra fields are ignored, empty fields are 0,
+// True/False are 1/0.
+void parseCsvBlock(const char* begin, const char* end, std::size_t nColumns, char delimiter,
+                   CsvColumnChunk& chunk);
+
+CsvConvertReport convertCsvToRoot(const CsvConvertOptions& opts);
+
+// Scan the whole CSV (same threads and blocks as the conversion) and return
+// the narrowest exact type of every column; names receives the header.
+// Returns false if the file cannot be read.
+bool inferCsvSchema(const CsvConvertOptions& opts, std::vector<std::string>& names,
+                    ColumnTypes& types);
+
+#endif
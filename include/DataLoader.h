@@ -1,95 +1,156 @@
 #ifndef DATALOADER_H
 #define DATALOADER_H
 
+#include "Config.h"
+#include "EventData.h"
+#include "LeafTypes.h"
 #include <string>
 #include <memory>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <cstdint>
+#include <utility>
+#include <functional>
 #include <TFile.h>
 #include <TTree.h>
-
-// Common event-level variables (scheme-independent)
-struct EventData {
-    // Event identifiers
-    unsigned int  run   = 0;
-    unsigned long long event = 0;
-    unsigned int  lumi  = 0;
-
-    // Weights
-    double weight       = 1.0;
-    double eventWeight  = 1.0;
-    double weight_central = 1.0;
-
-    // Diphoton candidate kinematics
-    double mass = 0, pt = 0, eta = 0, phi = 0;
-
-    // Photon variables
-    double lead_pt = 0, lead_eta = 0, lead_phi = 0, lead_mvaID = 0, lead_r9 = 0;
-    double sublead_pt = 0, sublead_eta = 0, sublead_phi = 0, sublead_mvaID = 0, sublead_r9 = 0;
-
-    // Category flags (stored as Double in the ntuple)
-    double is_nonRes = 0, is_nonResReg = 0, is_nonResReg_DNNpair = 0;
-    double is_nonResReg_vbfpair = 0, is_Res = 0, is_Res_DNNpair = 0;
-
-    // Multiplicities
-    double n_jets = 0, nBLoose = 0, nBMedium = 0, nBTight = 0;
-
-    // BDT outputs (Float in ntuple)
-    float MultiBDT_output[4] = {0, 0, 0, 0};
-
-    // Discriminants (Float in ntuple)
-    float alpha = 0, beta = 0, gamma = 0, D_ttH = 0, D_qcd = 0;
-
-    // MET
-    double puppiMET_pt = 0, puppiMET_phi = 0;
-
-    // Sigma m
-    double sigma_m_over_m = 0;
+#include <TBranch.h>
+
+class ParquetReader;
+
+// Inputs read as Parquet instead of ROOT, by extension
+bool isParquetPath(const std::string& path);
+
+// Type code of a single-value branch, 0 for arrays and unsupported types
+char branchTypeCode(TBranch* branch);
+
+// An enabled branch and the address it is bound to
+struct BranchBinding {
+    std::string name;
+    TBranch*    branch = nullptr; // owned by the TTree
+    void*       address = nullptr;
+    std::size_t size = 0;         // bytes per entry
+    char        type = 'D';       // leafTypeCode of the bound type
+    // Set when the branch is stored as another type (e.g. a narrowed skim):
+    // the branch reads into source and the value is converted to address.
+    // Parquet columns that cannot hold SENTINEL (nulls) are staged as D.
+    void*       source = nullptr;
+    char        sourceType = 0;
+    char        storedType = 0;   // leafTypeCode of the branch / column in the file
+    int         column = -1;      // Parquet inputs: ParquetReader column
 };
 
-// Per-scheme variables (prefix-dependent)
-struct SchemeData {
-    // Dijet
-    double dijet_mass = 0, dijet_pt = 0, dijet_eta = 0;
-    double dijet_mass_DNNreg = 0;
-
-    // Lead b-jet
-    double lead_bjet_pt = 0, lead_bjet_eta = 0, lead_bjet_phi = 0, lead_bjet_mass = 0;
-    double lead_bjet_btagPNetB = 0, lead_bjet_btagUParTAK4B = 0;
-
-    // Sublead b-jet
-    double sublead_bjet_pt = 0, sublead_bjet_eta = 0, sublead_bjet_phi = 0, sublead_bjet_mass = 0;
-    double sublead_bjet_btagPNetB = 0, sublead_bjet_btagUParTAK4B = 0;
-
-    // HH candidate
-    double HHbbggCandidate_mass = 0, HHbbggCandidate_pt = 0;
-
-    // Angular / kinematic
-    double CosThetaStar_CS = 0;
-    double DeltaR_jg_min = 0;
-    double M_X = 0;
-    double chi_t0 = 0, chi_t1 = 0;
-
-    // Photon pT / mgg (scheme-level)
-    double pholead_PtOverM = 0, phosublead_PtOverM = 0;
+// TTreeCache set up over the enabled branches (DataLoader::setupReadCache)
+struct ReadCacheOptions {
+    Long64_t cacheBytes = Long64_t(64) << 20; // 0: no cache
+    // Unzip the baskets of the next cluster on helper threads while the
+    // current one is processed (TTreeCacheUnzip), and fill the cache from a
+    // prefetch thread (TFile.AsyncPrefetching)
+    bool prefetch = false;
+};
 
-    // Flag
-    double has_two_btagged_jets = 0;
+// File-level I/O counters of one loader
+struct ReadStats {
+    Long64_t readCalls = 0;      // read requests sent to the file (syscalls locally)
+    Long64_t fileBytes = 0;      // compressed bytes read from the file
+    double   prefetchEfficiency = -1;  // used / prefetched baskets (not a hit rate); -1: no cache
 };
 
+// Reads one input file: a ROOT TTree, or a flat Parquet file (*.parquet,
+// *.pq) whose columns are named like the branches. Parquet inputs have no
+// TTree and their BranchBinding::branch is null.
 class DataLoader {
 public:
+    // Failure to open the file or find the tree is not fatal: check isOpen()
+    // and report getError(); every other method is a no-op on a closed loader.
     DataLoader(const std::string& filename, const std::string& treeName = "data");
     ~DataLoader();
 
+    bool isOpen() const { return tree_ != nullptr || parquet_ != nullptr; }
+    bool isParquet() const { return parquet_ != nullptr; }
+    const std::string& getError() const { return error_; }
+    const std::string& getFileName() const { return filename_; }
+
     void setupBranches(EventData& evt);
     void setupSchemeBranches(SchemeData& sd, const std::string& schemeKey);
+    // Only run, lumi and event, read by getEventEntry (event index building)
+    void setupEventIdBranches(EventData& evt);
+    // Every single-value branch (those wanted accepts, if given), each bound
+    // to an 8-byte word of the loader holding the value in its stored type
+    // (BranchBinding::type), read by getEventEntry. Replaces the other
+    // setups (event dumps).
+    void setupAllBranches(const std::function<bool(const std::string&)>& wanted = nullptr);
 
     Long64_t getEntries() const;
-    void getEntry(Long64_t i);
-    TTree* getTree() const { return tree_; }
+    void getEntry(Long64_t i); // every enabled branch
+
+    // Staged reading: each call decompresses only its own group of branches.
+    //   selection: weight, scheme flags and the photon/diphoton columns the
+    //              common preselection cuts need
+    //   event:     the remaining EventData branches
+    //   scheme:    the SchemeData branches of one scheme
+    void getSelectionEntry(Long64_t i);
+    void getEventEntry(Long64_t i);
+    void getSchemeEntry(Long64_t i, SchemeId id);
+    void getSchemeEntry(Long64_t i, const std::string& schemeKey);
+
+    // Bytes returned by GetEntry so far (uncompressed)
+    Long64_t getBytesRead() const { return bytesRead_; }
+    // Set by the first read that failed (a basket or row group that cannot
+    // be decoded; getError() says which). The values of that read are not
+    // valid: the entries read since the last check must be discarded.
+    bool hasReadError() const { return readError_; }
+    // Forget a read error, to go on with other entries (event dumps)
+    void clearReadError() {
+        readError_ = false;
+        error_.clear();
+    }
+
+    // Cache exactly the branches bound so far; call after setupBranches /
+    // setupSchemeBranches. No-op for Parquet inputs or cacheBytes == 0.
+    void setupReadCache(const ReadCacheOptions& opts);
+    // Restrict cache fills to entries [begin, end) (the current work unit)
+    void setCacheRange(Long64_t begin, Long64_t end);
+    ReadStats getReadStats() const;
+
+    // Bindings made by setupBranches / setupSchemeBranches, per stage
+    const std::vector<BranchBinding>& getSelectionBindings() const { return selection_; }
+    const std::vector<BranchBinding>& getEventBindings() const { return event_; }
+    // Scheme bindings indexed by SchemeId (empty for schemes not set up)
+    const std::vector<std::vector<BranchBinding>>& getSchemeBindings() const {
+        return schemes_;
+    }
+
+    // Split [0, entries) into at most nChunks contiguous ranges aligned to
+    // TTree cluster (Parquet row group) boundaries, so each range
+    // decompresses its own baskets
+    std::vector<std::pair<Long64_t, Long64_t>> splitEntryRange(int nChunks) const;
+    TTree* getTree() const { return tree_; } // null for Parquet inputs
 
 private:
+    template <typename T>
+    void bind(const std::string& name, T* addr, std::vector<BranchBinding>& group);
+    void readGroup(Long64_t i, const std::vector<BranchBinding>& group);
+    void setReadError(const std::string& what, Long64_t entry);
+    void convertGroup(Long64_t i, const std::vector<BranchBinding>& group);
+    // A value of the file that the bound type cannot hold (warned once per branch)
+    void reportInexact(const BranchBinding& b, Long64_t entry);
+
+    std::string filename_;
+    std::string error_;
+    bool readError_ = false;
     std::unique_ptr<TFile> file_;
     TTree* tree_ = nullptr; // owned by TFile
+    std::unique_ptr<ParquetReader> parquet_;
+
+    std::vector<BranchBinding> selection_;
+    std::vector<BranchBinding> event_;
+    std::vector<std::vector<BranchBinding>> schemes_ =
+        std::vector<std::vector<BranchBinding>>(N_SCHEMES);
+    std::deque<uint64_t> staging_; // read buffers of converted branches
+    std::set<std::string> inexactBranches_;
+    Long64_t bytesRead_ = 0;
 };
 
 #endif
@@ -0,0 +1,86 @@
+#ifndef EVENTDATA_H
+#define EVENTDATA_H
+
+#include "Config.h"
+
+// The structs the event loop reads into. Plain data, no ROOT: DataLoader
+// binds the branches to them, and the PlotDef field table, the selection and
+// the exporters read them.
+
+// Common event-level variables (scheme-independent)
+struct EventData {
+    // Event identifiers
+    unsigned int  run   = 0;
+    unsigned long long event = 0;
+    unsigned int  lumi  = 0;
+
+    // Weights
+    double weight       = 1.0;
+    double eventWeight  = 1.0;
+    double weight_central = 1.0;
+
+    // Diphoton candidate kinematics
+    double mass = 0, pt = 0, eta = 0, phi = 0;
+
+    // Photon variables
+    double lead_pt = 0, lead_eta = 0, lead_phi = 0, lead_mvaID = 0, lead_r9 = 0;
+    double sublead_pt = 0, sublead_eta = 0, sublead_phi = 0, sublead_mvaID = 0, sublead_r9 = 0;
+
+    // Category flags and multiplicities: UChar_t, the type csv_to_root
+    // --infer-schema gives them. Ntuples storing them as Double are
+    // converted on read.
+    unsigned char is_nonRes = 0, is_nonResReg = 0, is_nonResReg_DNNpair = 0;
+    unsigned char is_nonResReg_vbfpair = 0, is_Res = 0, is_Res_DNNpair = 0;
+    unsigned char n_jets = 0, nBLoose = 0, nBMedium = 0, nBTight = 0;
+
+    // BDT outputs (Float in ntuple)
+    float MultiBDT_output[4] = {0, 0, 0, 0};
+
+    // Discriminants (Float in ntuple)
+    float alpha = 0, beta = 0, gamma = 0, D_ttH = 0, D_qcd = 0;
+
+    // MET
+    double puppiMET_pt = 0, puppiMET_phi = 0;
+
+    // Sigma m
+    double sigma_m_over_m = 0;
+};
+
+// is_<scheme> flag of every scheme, indexed by SchemeId
+constexpr unsigned char EventData::* kSchemeFlags[N_SCHEMES] = {
+#define HH_SCHEME_FLAG(key) &EventData::is_##key,
+    HH_SCHEMES(HH_SCHEME_FLAG)
+#undef HH_SCHEME_FLAG
+};
+
+// Per-scheme variables (prefix-dependent)
+struct SchemeData {
+    // Dijet
+    double dijet_mass = 0, dijet_pt = 0, dijet_eta = 0;
+    double dijet_mass_DNNreg = 0;
+
+    // Lead b-jet
+    double lead_bjet_pt = 0, lead_bjet_eta = 0, lead_bjet_phi = 0, lead_bjet_mass = 0;
+    double lead_bjet_btagPNetB = 0, lead_bjet_btagUParTAK4B = 0;
+
+    // Sublead b-jet
+    double sublead_bjet_pt = 0, sublead_bjet_eta = 0, sublead_bjet_phi = 0, sublead_bjet_mass = 0;
+    double sublead_bjet_btagPNetB = 0, sublead_bjet_btagUParTAK4B = 0;
+
+    // HH candidate
+    double HHbbggCandidate_mass = 0, HHbbggCandidate_pt = 0;
+
+    // Angular / kinematic
+    double CosThetaStar_CS = 0;
+    double DeltaR_jg_min = 0;
+    double M_X = 0;
+    double chi_t0 = 0, chi_t1 = 0;
+
+    // Photon pT / mgg (scheme-level)
+    double pholead_PtOverM = 0, phosublead_PtOverM = 0;
+
+    // Flag: UChar_t like the EventData category flags
+    unsigned char has_two_btagged_jets = 0;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef EVENTDUMP_H
+#define EVENTDUMP_H
+
+#include "EventIndex.h"
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+// Full-branch dump of picked entries (tools/event_dump). Each input file is
+// opened once with the selected single-value branches enabled (every one by
+// default); its picked entries are read in increasing order, so thousands of
+// events cost one pass per file. An entry that cannot be read is reported in
+// DumpReport::failures instead of being dumped.
+enum class DumpFormat { Table, Json, Csv };
+
+bool parseDumpFormat(const std::string& name, DumpFormat& format);
+
+struct DumpOptions {
+    DumpFormat format = DumpFormat::Table;
+    std::string treeName = "data";
+    // '*' / '?' patterns; empty: everything
+    std::vector<std::string> branches; // full branch names
+    std::vector<std::string> groups;   // object groups (see branchGroup)
+};
+
+struct DumpReport {
+    long long nEvents = 0;
+    int nFilesOk = 0;
+    std::vector<std::string> failures; // one message per failed file or unreadable entry
+};
+
+// Object a branch belongs to: the scheme key for scheme branches (longest
+// matching prefix), "lead" / "sublead" / "puppiMET", numbered objects such
+// as "jet3", "fatjet1", "lepton2", else "event". field receives the branch
+// name without the group prefix.
+std::string branchGroup(const std::string& branch, std::string* field = nullptr);
+
+// Exact text of a value stored as a leaf type (shortest round-trip form for
+// floating point, "nan" / "inf" as such)
+std::string formatLeafValue(const void* value, char type);
+
+// Dump the given entries (EventLocation::fileIndex indexes files) to out.
+// The CSV columns are those of the first file that opens; a branch missing
+// from a later file is left empty.
+DumpReport dumpEvents(const std::vector<std::string>& files, std::vector<EventLocation> picks,
+                      const DumpOptions& opts, std::ostream& out);
+
+#endif
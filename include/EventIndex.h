@@ -0,0 +1,91 @@
+#ifndef EVENTINDEX_H
+#define EVENTINDEX_H
+
+#include <Rtypes.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// (run, lumi, event) of one collision event
+struct EventId {
+    uint32_t run   = 0;
+    uint32_t lumi  = 0;
+    uint64_t event = 0;
+
+    bool operator<(const EventId& o) const {
+        if (run != o.run) return run < o.run;
+        if (lumi != o.lumi) return lumi < o.lumi;
+        return event < o.event;
+    }
+    bool operator==(const EventId& o) const {
+        return run == o.run && lumi == o.lumi && event == o.event;
+    }
+};
+
+// "run:lumi:event"; false if malformed
+bool parseEventId(const std::string& text, EventId& id);
+// A comma-separated list of run:lumi:event, or a file with one per line
+// (':' or blanks between the numbers, '#' comments). Malformed items are
+// reported and skipped.
+std::vector<EventId> parseEventList(const std::string& spec);
+std::string formatEventId(const EventId& id);
+
+// Entry number of every event of one input file, sorted by (run, lumi,
+// event): 24 bytes per entry, looked up by binary search.
+//
+// The index is kept in a sidecar file, <input>.evidx by default or
+// <indexDir>/<name>.<hash>.evidx. It records the size, modification time
+// and ROOT UUID of the input and is rebuilt when they change.
+class EventIndex {
+public:
+    struct Record {
+        EventId  id;
+        Long64_t entry = 0;
+    };
+
+    // Load the sidecar or, if it is missing or stale, build it by reading
+    // the run, lumi and event branches and save it. Check isOpen(): a read
+    // error while building leaves it closed, and nothing is saved.
+    static EventIndex loadOrBuild(const std::string& file, const std::string& indexDir = "",
+                                  const std::string& treeName = "data");
+
+    bool isOpen() const { return open_; }
+    const std::string& getError() const { return error_; }
+    bool wasBuilt() const { return built_; } // false: read from the sidecar
+    const std::string& getSidecarPath() const { return sidecar_; }
+    std::size_t size() const { return records_.size(); }
+
+    // Entries of an event (more than one if the file holds duplicates)
+    std::vector<Long64_t> find(const EventId& id) const;
+
+private:
+    // Read the sidecar; false if it is stale or does not hold one valid
+    // record per entry of the file
+    bool load(uint64_t fingerprint, Long64_t entries);
+    bool save(uint64_t fingerprint) const;
+
+    std::vector<Record> records_;
+    std::string sidecar_;
+    std::string error_;
+    bool open_ = false;
+    bool built_ = false;
+};
+
+std::string eventIndexPath(const std::string& file, const std::string& indexDir);
+
+// Where a requested event was found
+struct EventLocation {
+    EventId     id;
+    std::size_t fileIndex = 0;
+    Long64_t    entry = 0;
+};
+
+// Look every id up in the index of every file (loaded or built as needed).
+// Results are in file order, then in the order of ids. Files whose index
+// cannot be built are reported and skipped; nBuilt receives the number of
+// indexes that had to be (re)built.
+std::vector<EventLocation> locateEvents(const std::vector<std::string>& files,
+                                        const std::vector<EventId>& ids,
+                                        const std::string& indexDir = "", int* nBuilt = nullptr);
+
+#endif
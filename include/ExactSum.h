@@ -0,0 +1,122 @@
+#ifndef EXACTSUM_H
+#define EXACTSUM_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Order-independent sum of doubles, for the histogram and cutflow
+// accumulators. Values are added to a 192-bit fixed-point integer with the
+// binary point at bit 96, so integer addition makes the sum associative:
+// filling the same weights in any order, or merging partial sums of any
+// split of the events, gives the same bits. That is what keeps the output of
+// runEventLoop independent of the number of threads.
+//
+// Every double in [2^-44, 2^94) is added exactly; smaller magnitudes are
+// truncated to a multiple of 2^-96 (the same way whatever the order). Inf and
+// NaN are summed separately and dominate the result; totals must stay below
+// 2^95 in magnitude.
+class ExactSum {
+public:
+    ExactSum() = default;
+    explicit ExactSum(double x) { add(x); }
+
+    void add(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int exp = static_cast<int>(bits >> 52) & 0x7ff;
+        if (exp == 0x7ff) {
+            special_ += x;
+            return;
+        }
+        uint64_t mant = bits & ((uint64_t(1) << 52) - 1);
+        if (exp != 0) mant |= uint64_t(1) << 52;
+        else exp = 1;
+        int p = exp - 1075 + kFracBits; // bit of the mantissa's lowest bit
+        if (p < 0) {
+            if (p <= -53) return;
+            mant >>= -p;
+            p = 0;
+        }
+        // The shifted mantissa as 192 bits: lo (128) + hi (64)
+        Limb lo;
+        uint64_t hi;
+        if (p < 128) {
+            lo = static_cast<Limb>(mant) << p;
+            hi = p > 75 ? mant >> (128 - p) : 0;
+        } else if (p < 128 + 10) {
+            lo = 0;
+            hi = mant << (p - 128);
+        } else {
+            special_ += std::copysign(HUGE_VAL, x); // out of range
+            return;
+        }
+        if (bits >> 63) {
+            hi_ -= hi + (lo_ < lo);
+            lo_ -= lo;
+        } else {
+            Limb s = lo_ + lo;
+            hi_ += hi + (s < lo_);
+            lo_ = s;
+        }
+    }
+
+    void add(const ExactSum& other) {
+        Limb s = lo_ + other.lo_;
+        hi_ += other.hi_ + (s < lo_);
+        lo_ = s;
+        special_ += other.special_;
+    }
+
+    ExactSum& operator+=(double x) {
+        add(x);
+        return *this;
+    }
+    ExactSum& operator+=(const ExactSum& other) {
+        add(other);
+        return *this;
+    }
+
+    // The sum rounded to the nearest double
+    double value() const {
+        if (special_ != 0) return special_; // also NaN
+        bool neg = static_cast<int64_t>(hi_) < 0;
+        Limb lo = lo_;
+        uint64_t hi = hi_;
+        if (neg) { // two's complement negation over 192 bits
+            lo = ~lo + 1;
+            hi = ~hi + (lo == 0);
+        }
+        uint64_t w[3] = {static_cast<uint64_t>(lo), static_cast<uint64_t>(lo >> 64), hi};
+        int top = 2;
+        while (top > 0 && w[top] == 0) --top;
+        if (w[top] == 0) return 0.0;
+        // Leading 64 bits; the bits below fold into the last one (sticky), so
+        // the conversion to double rounds correctly
+        int lz = __builtin_clzll(w[top]);
+        uint64_t m = w[top] << lz;
+        bool sticky = false;
+        if (top > 0) {
+            if (lz) m |= w[top - 1] >> (64 - lz);
+            sticky = (lz ? w[top - 1] << lz : w[top - 1]) != 0;
+            if (top > 1) sticky = sticky || w[0] != 0;
+        }
+        double v = std::ldexp(static_cast<double>(m | uint64_t(sticky)), 64 * top - lz - kFracBits);
+        return neg ? -v : v;
+    }
+
+    bool operator==(const ExactSum& other) const {
+        return lo_ == other.lo_ && hi_ == other.hi_ &&
+               std::memcmp(&special_, &other.special_, sizeof(special_)) == 0;
+    }
+
+private:
+    using Limb = unsigned __int128;
+    static constexpr int kFracBits = 96;
+
+    Limb     lo_ = 0;
+    uint64_t hi_ = 0;      // two's complement with lo_
+    double   special_ = 0; // inf / NaN terms
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef FASTHIST_H
+#define FASTHIST_H
+
+#include "ExactSum.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Fixed-binning histograms for the event loop. Plain value types: sum of
+// weights and sum of squared weights in flat arrays that include the
+// under/overflow bins, no virtual calls and no global state. Every thread can
+// fill its own copy; copies with the same binning merge with add(). The sums
+// are ExactSum accumulators, so the contents do not depend on how the events
+// were split between copies or in which order the copies are added.
+// Plotter converts them to TH1D / TH2D for drawing.
+
+// Bin of x on a uniform axis, same arithmetic as TAxis::FindBin: 0 is the
+// underflow, nbins + 1 the overflow (also NaN)
+inline int fastHistBin(double x, int nbins, double xmin, double xmax) {
+    if (x < xmin)    return 0;
+    if (!(x < xmax)) return nbins + 1;
+    return 1 + static_cast<int>(nbins * (x - xmin) / (xmax - xmin));
+}
+
+// a[i] += b[i]. One 192-bit ExactSum add per bin: the carry chain keeps this
+// scalar, where the plain double loop it replaced vectorized. The exact,
+// thread-count independent sums were chosen over that; merges run once per
+// work unit and histogram, not per event, so the loop is not on the hot path.
+inline void fastHistAdd(ExactSum* __restrict a, const ExactSum* __restrict b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) a[i] += b[i];
+}
+
+inline std::vector<double> fastHistValues(const std::vector<ExactSum>& sums) {
+    std::vector<double> v(sums.size());
+    for (std::size_t i = 0; i < sums.size(); ++i) v[i] = sums[i].value();
+    return v;
+}
+
+inline std::vector<ExactSum> fastHistSums(const std::vector<double>& values) {
+    return std::vector<ExactSum>(values.begin(), values.end());
+}
+
+class FastHist1D {
+public:
+    FastHist1D() = default;
+    FastHist1D(const std::string& name, const std::string& title, int nbins, double xmin, double xmax)
+        : name_(name), title_(title), nbins_(nbins), xmin_(xmin), xmax_(xmax),
+          sumw_(nbins + 2), sumw2_(nbins + 2) {}
+
+    void fill(double x, double w = 1.0) {
+        int bin = fastHistBin(x, nbins_, xmin_, xmax_);
+        sumw_[bin]  += w;
+        sumw2_[bin] += w * w;
+        ++entries_;
+    }
+
+    // Bin-by-bin sum of a histogram with the same binning
+    void add(const FastHist1D& other) {
+        fastHistAdd(sumw_.data(), other.sumw_.data(), sumw_.size());
+        fastHistAdd(sumw2_.data(), other.sumw2_.data(), sumw2_.size());
+        entries_ += other.entries_;
+    }
+
+    void reset() {
+        sumw_.assign(sumw_.size(), ExactSum());
+        sumw2_.assign(sumw2_.size(), ExactSum());
+        entries_ = 0;
+    }
+
+    // Replace the content (e.g. from a cache); false if the sizes differ
+    bool setContents(const std::vector<double>& sumw, const std::vector<double>& sumw2,
+                     long long entries) {
+        if (sumw.size() != sumw_.size() || sumw2.size() != sumw2_.size()) return false;
+        sumw_ = fastHistSums(sumw);
+        sumw2_ = fastHistSums(sumw2);
+        entries_ = entries;
+        return true;
+    }
+    bool setContents(std::vector<ExactSum> sumw, std::vector<ExactSum> sumw2, long long entries) {
+        if (sumw.size() != sumw_.size() || sumw2.size() != sumw2_.size()) return false;
+        sumw_ = std::move(sumw);
+        sumw2_ = std::move(sumw2);
+        entries_ = entries;
+        return true;
+    }
+
+    // Copy with the same binning and no content
+    FastHist1D cloneEmpty() const {
+        return FastHist1D(name_, title_, nbins_, xmin_, xmax_);
+    }
+
+    const std::string& getName() const { return name_; }
+    const std::string& getTitle() const { return title_; }
+    int getNbins() const { return nbins_; }
+    double getXmin() const { return xmin_; }
+    double getXmax() const { return xmax_; }
+    long long getEntries() const { return entries_; }
+    // Index 0 is the underflow, getNbins() + 1 the overflow
+    std::vector<double> getSumw() const { return fastHistValues(sumw_); }
+    std::vector<double> getSumw2() const { return fastHistValues(sumw2_); }
+
+private:
+    std::string name_, title_;
+    int nbins_ = 0;
+    double xmin_ = 0, xmax_ = 0;
+    std::vector<ExactSum> sumw_, sumw2_;
+    long long entries_ = 0;
+};
+
+// 2D version; cell (bx, by) is at bx + (nx + 2) * by, the TH2 global bin
+// layout, so conversion is a plain copy
+class FastHist2D {
+public:
+    FastHist2D() = default;
+    FastHist2D(const std::string& name, const std::string& title,
+               int nx, double xmin, double xmax, int ny, double ymin, double ymax)
+        : name_(name), title_(title), nx_(nx), ny_(ny),
+          xmin_(xmin), xmax_(xmax), ymin_(ymin), ymax_(ymax),
+          sumw_((nx + 2) * (ny + 2)), sumw2_((nx + 2) * (ny + 2)) {}
+
+    void fill(double x, double y, double w = 1.0) {
+        int cell = fastHistBin(x, nx_, xmin_, xmax_) + (nx_ + 2) * fastHistBin(y, ny_, ymin_, ymax_);
+        sumw_[cell]  += w;
+        sumw2_[cell] += w * w;
+        ++entries_;
+    }
+
+    void add(const FastHist2D& other) {
+        fastHistAdd(sumw_.data(), other.sumw_.data(), sumw_.size());
+        fastHistAdd(sumw2_.data(), other.sumw2_.data(), sumw2_.size());
+        entries_ += other.entries_;
+    }
+
+    void reset() {
+        sumw_.assign(sumw_.size(), ExactSum());
+        sumw2_.assign(sumw2_.size(), ExactSum());
+        entries_ = 0;
+    }
+
+    bool setContents(const std::vector<double>& sumw, const std::vector<double>& sumw2,
+                     long long entries) {
+        if (sumw.size() != sumw_.size() || sumw2.size() != sumw2_.size()) return false;
+        sumw_ = fastHistSums(sumw);
+        sumw2_ = fastHistSums(sumw2);
+        entries_ = entries;
+        return true;
+    }
+    bool setContents(std::vector<ExactSum> sumw, std::vector<ExactSum> sumw2, long long entries) {
+        if (sumw.size() != sumw_.size() || sumw2.size() != sumw2_.size()) return false;
+        sumw_ = std::move(sumw);
+        sumw2_ = std::move(sumw2);
+        entries_ = entries;
+        return true;
+    }
+
+    FastHist2D cloneEmpty() const {
+        return FastHist2D(name_, title_, nx_, xmin_, xmax_, ny_, ymin_, ymax_);
+    }
+
+    const std::string& getName() const { return name_; }
+    const std::string& getTitle() const { return title_; }
+    int getNbinsX() const { return nx_; }
+    int getNbinsY() const { return ny_; }
+    double getXmin() const { return xmin_; }
+    double getXmax() const { return xmax_; }
+    double getYmin() const { return ymin_; }
+    double getYmax() const { return ymax_; }
+    long long getEntries() const { return entries_; }
+    std::vector<double> getSumw() const { return fastHistValues(sumw_); }
+    std::vector<double> getSumw2() const { return fastHistValues(sumw2_); }
+
+private:
+    std::string name_, title_;
+    int nx_ = 0, ny_ = 0;
+    double xmin_ = 0, xmax_ = 0, ymin_ = 0, ymax_ = 0;
+    std::vector<ExactSum> sumw_, sumw2_;
+    long long entries_ = 0;
+};
+
+#endif
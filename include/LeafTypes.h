@@ -0,0 +1,37 @@
+#ifndef LEAFTYPES_H
+#define LEAFTYPES_H
+
+#include <cstddef>
+
+// ROOT leaf type codes (D F L l I i S s B b O) and value conversion between
+// them. No ROOT dependency: shared by DataLoader, the Parquet reader, the
+// schema tools and the exporters.
+
+// Type code of a C++ type
+template <typename T> constexpr char leafTypeCode();
+template <> constexpr char leafTypeCode<double>()             { return 'D'; }
+template <> constexpr char leafTypeCode<float>()              { return 'F'; }
+template <> constexpr char leafTypeCode<long long>()          { return 'L'; }
+template <> constexpr char leafTypeCode<unsigned long long>() { return 'l'; }
+template <> constexpr char leafTypeCode<int>()                { return 'I'; }
+template <> constexpr char leafTypeCode<unsigned int>()       { return 'i'; }
+template <> constexpr char leafTypeCode<short>()              { return 'S'; }
+template <> constexpr char leafTypeCode<unsigned short>()     { return 's'; }
+template <> constexpr char leafTypeCode<char>()               { return 'B'; }
+template <> constexpr char leafTypeCode<unsigned char>()      { return 'b'; }
+template <> constexpr char leafTypeCode<bool>()               { return 'O'; }
+
+// Bytes of a type code, 0 if unknown
+std::size_t leafTypeSize(char type);
+// ROOT type name ("Double_t", "UChar_t", ...), "?" if unknown
+const char* leafTypeName(char type);
+
+// Store the value at src (of type srcType) at dst as dstType, clamped to the
+// range of dstType. Returns false if the stored value differs from the source
+// (SENTINEL in an unsigned or 8-bit type, for one): callers must report it.
+bool convertLeafValue(const void* src, char srcType, void* dst, char dstType);
+
+// Whether a type stores v exactly (SENTINEL needs D, F, L, I or S)
+bool leafTypeHolds(char type, double v);
+
+#endif
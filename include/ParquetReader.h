@@ -0,0 +1,67 @@
+#ifndef PARQUETREADER_H
+#define PARQUETREADER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// Column-projected reader for flat Parquet files, used by DataLoader for
+// *.parquet inputs. Only columns that are asked for are ever decoded, one row
+// group at a time: reading entry i of a column decodes the row group holding i
+// on first access and keeps it until an entry of another row group is read.
+//
+// Needs Apache Arrow C++ (make ARROW=1); without it every file fails to open
+// with an explanatory error.
+class ParquetReader {
+public:
+    explicit ParquetReader(const std::string& path);
+    ~ParquetReader();
+    ParquetReader(const ParquetReader&) = delete;
+    ParquetReader& operator=(const ParquetReader&) = delete;
+
+    bool isOpen() const { return open_; }
+    const std::string& getError() const { return error_; }
+
+    long long getEntries() const { return nEntries_; }
+    // First entry of every row group, then the number of entries
+    const std::vector<long long>& getRowGroupBounds() const { return bounds_; }
+
+    // Column of a name, -1 if the file has no such (single-value) column
+    int findColumn(const std::string& name) const;
+    int getColumnCount() const { return static_cast<int>(columns_.size()); }
+    const std::string& getColumnName(int column) const { return columns_[column].name; }
+    // leafTypeCode of the stored values
+    char getColumnType(int column) const { return columns_[column].type; }
+
+    // Store entry `entry` of a column at dst as dstType. Returns the bytes
+    // decoded to serve the call (0 if the row group was already loaded), or
+    // -1 if the row group cannot be read: dst is then left alone and
+    // getError() says why. Null values read as SENTINEL; *exact is cleared
+    // when dstType cannot hold the value (see convertLeafValue).
+    long long read(int column, long long entry, void* dst, char dstType, bool* exact = nullptr);
+
+private:
+    struct Column {
+        std::string name;
+        int   field = -1;        // index in the Arrow schema
+        char  type = 0;          // leafTypeCode
+        int   loadedGroup = -1;
+        // Type of data: type, or D when the group has nulls and type
+        // cannot hold SENTINEL
+        char  loadedType = 0;
+        std::vector<char> data;  // values of the loaded row group
+    };
+    struct Impl;
+
+    // Decoded bytes, -1 on a read error
+    long long loadGroup(Column& c, int group);
+
+    std::unique_ptr<Impl> impl_;
+    bool open_ = false;
+    std::string error_;
+    long long nEntries_ = 0;
+    std::vector<long long> bounds_;
+    std::vector<Column> columns_;
+};
+
+#endif
@@ -2,32 +2,67 @@
 #define PLOTTER_H
 
 #include "Config.h"
+#include "Selection.h"
+#include "FastHist.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <functional>
+#include <cstdint>
 #include <TH1D.h>
 #include <TH2D.h>
 #include <TCanvas.h>
 #include <TStyle.h>
 
+// How draw* calls turn into output files
+//   Serial:   render each plot immediately (PDF + PNG)
+//   None:     no rendering; finish() writes every histogram to one ROOT file
+//   Parallel: queue the plots, finish() renders them in worker processes
+//   Lazy:     queue the plots, finish() renders only those whose content
+//             changed since the last run (per-plot hash in a manifest)
+enum class RenderMode { Serial, None, Parallel, Lazy };
+bool parseRenderMode(const std::string& text, RenderMode& mode);
+
+struct RenderReport {
+    int nRendered = 0;
+    int nUnchanged = 0;  // lazy: skipped, output up to date
+    int nWritten = 0;    // none: histograms written to the ROOT file
+    int nFailedWorkers = 0;
+    std::string rootFile;
+};
+
 class Plotter {
 public:
     Plotter(const std::string& outputDir, double lumi = LUMI_RUN3, double sqrtS = SQRT_S);
     ~Plotter();
 
     // Histogram booking
+    static std::string axisTitle(const PlotDef& def); // ";x [units];Events / width"
     TH1D* bookTH1(const std::string& name, const PlotDef& def);
     TH2D* bookTH2(const std::string& name, int nx, double xmin, double xmax,
                    int ny, double ymin, double ymax,
                    const std::string& xlabel = "", const std::string& ylabel = "");
 
+    // ROOT copies of event-loop histograms (owned by the plotter)
+    TH1D* toTH1(const FastHist1D& h);
+    TH2D* toTH2(const FastHist2D& h);
+
     // Drawing
     void draw1D(TH1D* h, double blindLow = -1, double blindHigh = -1);
+    void draw1D(const FastHist1D& h, double blindLow = -1, double blindHigh = -1);
     void drawCompare(const std::vector<TH1D*>& hists, const std::vector<std::string>& labels,
                      bool normalize = true);
     void draw2DMassPlane(TH2D* h, bool blind = true);
-    void drawCutflow(const std::map<std::string, int>& cuts, const std::string& schemeName);
+    void draw2DMassPlane(const FastHist2D& h, bool blind = true);
+    void drawCutflow(const Cutflow& cf, bool weighted = true);
+
+    // Rendering mode; jobs is the number of worker processes (Parallel and
+    // Lazy), 0 = one per core
+    void setRenderMode(RenderMode mode, int jobs = 0);
+    RenderMode getRenderMode() const { return mode_; }
+    // Render / write everything queued by the draw* calls (no-op in Serial)
+    RenderReport finish();
 
     // Saving
     void save(TCanvas* c, const std::string& name);
@@ -37,11 +72,32 @@ public:
     void drawCMSLabel(TCanvas* c, const std::string& extra = "Preliminary");
 
 private:
+    // One plot: its output name, a hash of everything that affects the
+    // picture, the histograms to store in None mode and the drawing code
+    struct PlotJob {
+        std::string name;
+        uint64_t hash = 0;
+        std::vector<TH1*> objects;
+        std::function<void()> render;
+    };
+
+    void submit(PlotJob job);
+    uint64_t hashHist(const TH1* h, uint64_t seed) const;
+    bool renderInWorkers(const std::vector<size_t>& todo, int nWorkers);
+    void render1D(TH1D* h, double blindLow, double blindHigh);
+    void renderCompare(const std::vector<TH1D*>& hists, const std::vector<std::string>& labels,
+                       bool normalize);
+    void render2DMassPlane(TH2D* h, bool blind);
+    void renderCutflow(TH1D* h, const std::string& name);
+
     std::string outputDir_;
     double lumi_;
     double sqrtS_;
     std::vector<std::unique_ptr<TH1D>> ownedTH1_;
     std::vector<std::unique_ptr<TH2D>> ownedTH2_;
+    RenderMode mode_ = RenderMode::Serial;
+    int renderJobs_ = 0;
+    std::vector<PlotJob> jobs_;
 };
 
 #endif
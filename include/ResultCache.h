@@ -0,0 +1,115 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "Config.h"
+#include "Analysis.h"
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <functional>
+#include <cstdint>
+
+// Identity of one input file: path, size, modification time and the ROOT
+// file UUID (empty if the file cannot be opened)
+struct InputFingerprint {
+    std::string path;
+    long long size  = -1;
+    long long mtime = -1;
+    std::string uuid;
+
+    uint64_t hash(uint64_t seed) const;
+};
+
+InputFingerprint fingerprintFile(const std::string& path);
+uint64_t fingerprintInputs(const std::vector<std::string>& files);
+uint64_t hashCuts(const SelectionCuts& cuts);
+
+// Binary (de)serialisation of the parts of a HistogramSet. A part is read
+// back only if its histogram names and binnings match what is booked in the
+// target set; on failure the target is left unchanged.
+//   common: all common histograms
+//   scheme: cutflow of one scheme, plus its histograms and mass plane when
+//           they are booked (cutflow-only runs book none), then its sparse
+//           store and unbinned events when booked
+void writeCommon(std::ostream& out, const HistogramSet& hists);
+bool readCommon(std::istream& in, HistogramSet& hists);
+void writeScheme(std::ostream& out, const HistogramSet& hists, const std::string& schemeKey);
+bool readScheme(std::istream& in, HistogramSet& hists, const std::string& schemeKey);
+// Every booked part of a set (common if booked, then each cutflow's scheme)
+void writeHistogramSet(std::ostream& out, const HistogramSet& hists);
+bool readHistogramSet(std::istream& in, HistogramSet& hists);
+
+// Write a file through a temporary in the same directory and rename it, so
+// readers never see a partial file. Returns false (and reports) on errors.
+bool writeFileAtomic(const std::string& path, const std::function<void(std::ostream&)>& write);
+
+// Persistent cache of event-loop results, one file per part in dir:
+//   common part: keyed by the input fingerprint and the blinding flag
+//   scheme part: keyed by the input fingerprint, SelectionCuts, blinding,
+//                the scheme key and the --bdt models (RunOptions::modelKey)
+// Parts are independent, so a run can take some schemes from the cache and
+// process only the others.
+//
+// run_analysis uses it only with --cache (.hhbbgg_cache) or --cache-dir DIR.
+// Entries (.hhc) are never evicted. A scheme part holds its histograms and,
+// when booked, the sparse store and unbinned events, so each entry can be as
+// large as those outputs, and a new one is written for every change of
+// inputs, cuts or models. The directory holds nothing else: remove it
+// (rm -rf DIR) to reclaim the space.
+class ResultCache {
+public:
+    ResultCache(const std::string& dir, const std::vector<std::string>& files,
+                const SelectionCuts& cuts, bool doBlind, uint64_t modelKey = 0);
+
+    bool loadCommon(HistogramSet& hists) const;
+    bool loadScheme(const std::string& schemeKey, HistogramSet& hists) const;
+
+    // Written to a temporary file and renamed, so concurrent runs never see
+    // a partial entry. Returns false on I/O errors.
+    bool storeCommon(const HistogramSet& hists) const;
+    bool storeScheme(const std::string& schemeKey, const HistogramSet& hists) const;
+
+    const std::string& getDir() const { return dir_; }
+
+private:
+    std::string entryPath(uint64_t key) const;
+    uint64_t commonKey() const;
+    uint64_t schemeKey(const std::string& key) const;
+    bool load(uint64_t key, const std::function<bool(std::istream&)>& read) const;
+    bool store(uint64_t key, const std::function<void(std::ostream&)>& write) const;
+
+    std::string dir_;
+    uint64_t inputKey_ = 0;
+    uint64_t cutsKey_  = 0;
+    uint64_t modelKey_ = 0;
+    bool doBlind_      = true;
+};
+
+// ---------------------------------------------------------------------------
+// Incremental runs
+// ---------------------------------------------------------------------------
+// A state directory holds the results of every input file folded in so far
+// (one part file each), their sum and an index with one record per file.
+// A file is reused while its size, ROOT UUID and checksum are unchanged.
+struct StateFileRecord {
+    InputFingerprint fp;
+    uint64_t    checksum = 0;  // see checksumFile()
+    std::string part;          // file name of its results in the state dir
+};
+
+// Content checksum of an input. ROOT files: the size, modification date and
+// every key (name, cycle, date, position, length) of the file, which ROOT
+// rewrites whenever an object changes; only the header and key list are
+// read, so remote files work too. Parquet files, which have no such stamps:
+// the whole file (0 for remote ones). 0 if the file cannot be read.
+uint64_t checksumFile(const std::string& path);
+
+// Bring the state in dir up to date with opts.files and return the totals in
+// hists: only new or changed files go through the event loop, files no
+// longer listed are dropped. Failed files are not recorded, so the next run
+// retries them. A state made with other cuts, blinding, schemes, booking or
+// models is discarded and rebuilt.
+RunReport runIncremental(const std::string& dir, const RunOptions& opts,
+                         const EventSelector& selector, HistogramSet& hists);
+
+#endif
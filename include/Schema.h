@@ -0,0 +1,34 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+// Stored type (leafTypeCode) per column name. The file format is the one of
+// data/branch_list.txt, so that file is a valid schema:
+//   Branches: N            (optional header lines ending in ':')
+//   name : name/T
+// "name/T" and "name T" lines are accepted too; '#' starts a comment.
+using ColumnTypes = std::map<std::string, char>;
+
+bool readSchema(const std::string& path, ColumnTypes& types);
+// Columns in the given order; those missing from types are written as /D
+bool writeSchema(const std::string& path, const std::vector<std::string>& names,
+                 const ColumnTypes& types);
+
+// Range and exactness of the values of one column, for schema inference
+struct ColumnStats {
+    long long n = 0;
+    bool integral = true;     // every value is a finite integer
+    bool floatExact = true;   // every value survives a round trip through float
+    double min = 0, max = 0;
+
+    void add(double v);
+    void merge(const ColumnStats& other);
+    // Narrowest type that holds every value seen exactly: the smallest
+    // integer type covering [min, max] for integral columns, else F or D
+    char narrowestType() const;
+};
+
+#endif
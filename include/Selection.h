@@ -3,15 +3,64 @@
 
 #include "Config.h"
 #include "DataLoader.h"
+#include "ExactSum.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
+#include <cstddef>
+
+// One row of a cutflow table
+struct CutflowStep {
+    std::string label;
+    long long nEvents = 0; // unweighted
+    ExactSum sumW;         // order-independent, see ExactSum
+    ExactSum sumW2;
+};
+
+// Per-scheme cutflow, accumulated inside the main event loop
+struct Cutflow {
+    std::string schemeKey;
+    std::vector<CutflowStep> steps;
+
+    void record(size_t step, double w) {
+        CutflowStep& s = steps[step];
+        s.nEvents++;
+        s.sumW  += w;
+        s.sumW2 += w * w;
+    }
+    void add(const Cutflow& other);
+    void reset();
+};
+
+// Column views for batch selection: element i of every array is event i,
+// in the types EventData / SchemeData bind them (e.g. ColumnStore columns).
+// Scheme columns (flag, dijet, b-jets) may be left null to evaluate only the
+// event-level cuts.
+struct SelectionColumns {
+    std::size_t n = 0;
+    const double* mass          = nullptr;
+    const double* lead_pt       = nullptr;
+    const double* sublead_pt    = nullptr;
+    const double* lead_mvaID    = nullptr;
+    const double* sublead_mvaID = nullptr;
+    const unsigned char* schemeFlag = nullptr; // is_<scheme>
+    const double* dijet_mass      = nullptr;
+    const double* lead_bjet_pt    = nullptr;
+    const double* sublead_bjet_pt = nullptr;
+};
+
+// Instruction set used by the batch selection
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+const char* simdLevelName(SimdLevel level);
 
 class EventSelector {
 public:
     explicit EventSelector(const SelectionCuts& cuts = SelectionCuts{});
 
-    // Individual cut methods
+    // Individual cut methods. Methods taking a scheme come in two flavours:
+    // the SchemeId ones are for the event loop (one table lookup), the string
+    // ones resolve the key first and reject unknown schemes.
     bool passDiphotonMass(const EventData& evt) const;
     bool passPhotonPt(const EventData& evt) const;
     bool passPhotonMvaId(const EventData& evt) const;
@@ -19,19 +68,77 @@ public:
     bool passBjetPt(const SchemeData& sd) const;
     bool passBtagMultiplicity(const EventData& evt) const;
     bool passSchemeFlag(const EventData& evt, const std::string& schemeKey) const;
+    bool passSchemeFlag(const EventData& evt, SchemeId id) const {
+        return evt.*kSchemeFlags[static_cast<int>(id)] != 0;
+    }
     bool passSideband(const EventData& evt) const;
     bool passSignalRegion(const EventData& evt) const;
+    // Same for a blinded window other than [BLIND_LOW, BLIND_HIGH]
+    bool passSideband(const EventData& evt, double blindLow, double blindHigh) const;
+    bool passSignalRegion(const EventData& evt, double blindLow, double blindHigh) const;
+
+    // Event-level part of the preselection (scheme flag, mgg window, photon
+    // pT/mgg and MVA ID); only needs DataLoader::getSelectionEntry
+    bool passCommonCuts(const EventData& evt, const std::string& schemeKey) const;
+    bool passCommonCuts(const EventData& evt, SchemeId id) const;
+    // Scheme-level part (mjj window, b-jet pT); needs getSchemeEntry
+    bool passSchemeCuts(const SchemeData& sd) const;
 
     // Combined preselection
     bool passPreselection(const EventData& evt, const SchemeData& sd,
                           const std::string& schemeKey) const;
+    bool passPreselection(const EventData& evt, const SchemeData& sd, SchemeId id) const;
+
+    // Batch preselection over a block of events: bit (i % 64) of
+    // mask[i / 64] is set when event i passes, identical to passPreselection.
+    // mask must hold (cols.n + 63) / 64 words. The widest instruction set the
+    // CPU supports is picked at runtime unless a level is forced.
+    void passPreselectionBatch(const SelectionColumns& cols, uint64_t* mask) const;
+    void passPreselectionBatch(const SelectionColumns& cols, uint64_t* mask,
+                               SimdLevel level) const;
+    static SimdLevel detectSimdLevel();
+
+    // Cutflow with the preselection steps of a scheme, all counts zero
+    Cutflow makeCutflow(const std::string& schemeKey) const;
+
+    // Same decision as passPreselection, recording every step the event
+    // passes (including "Total events") in the cutflow with weight w
+    bool fillCutflow(Cutflow& cf, const EventData& evt, const SchemeData& sd,
+                     const std::string& schemeKey, double w) const;
+    bool fillCutflow(Cutflow& cf, const EventData& evt, const SchemeData& sd,
+                     SchemeId id, double w) const;
 
-    // Cutflow: runs its own event loop, prints table
-    void printCutflow(DataLoader& loader, const std::string& schemeKey) const;
+    // The two stages of fillCutflow, for staged branch reading: call
+    // fillCutflowScheme only for events that passed fillCutflowCommon
+    bool fillCutflowCommon(Cutflow& cf, const EventData& evt,
+                           const std::string& schemeKey, double w) const;
+    bool fillCutflowCommon(Cutflow& cf, const EventData& evt, SchemeId id, double w) const;
+    bool fillCutflowScheme(Cutflow& cf, const SchemeData& sd, double w) const;
+
+    // Column-wise versions of the two stages, for a block of events with
+    // weights w: every step each event passes is recorded, events in entry
+    // order. fillCutflowCommonBatch ignores the dijet / b-jet columns and
+    // sets the events passing the event-level cuts in mask (layout as in
+    // passPreselectionBatch). fillCutflowSchemeBatch takes that mask and
+    // leaves the events passing every cut; it runs the kernels over the whole
+    // block, so the scheme columns must be readable for every row (a
+    // ColumnStore zero-fills the rows it did not load), and records steps
+    // only for the events in the mask. Counts are identical to the per-event
+    // methods.
+    void fillCutflowCommonBatch(Cutflow& cf, const SelectionColumns& cols, const double* w,
+                                uint64_t* mask) const;
+    void fillCutflowSchemeBatch(Cutflow& cf, const SelectionColumns& cols, const double* w,
+                                uint64_t* mask) const;
+
+    // Print table
+    void printCutflow(const Cutflow& cf) const;
 
     const SelectionCuts& getCuts() const { return cuts_; }
 
 private:
+    // Cutflow steps [0, kFirstSchemeStep) are event-level, the rest scheme-level
+    static constexpr size_t kFirstSchemeStep = 5;
+
     SelectionCuts cuts_;
 };
 
@@ -0,0 +1,106 @@
+#ifndef SIDEBANDFIT_H
+#define SIDEBANDFIT_H
+
+#include "Config.h"
+#include "UnbinnedExport.h"
+#include <string>
+#include <vector>
+
+// Unbinned maximum-likelihood fit of the mgg background to the sidebands
+// (the fit range minus the blinded window, as EventSelector::passSideband),
+// and the background it predicts in any mgg window. Used by
+// tools/sideband_fit on the files of run_analysis --export-unbinned.
+//
+// Shapes, on t = (mgg - fitLow) / (fitHigh - fitLow) in [0, 1]:
+//   exp      exp(a t)
+//   pow      (mgg / fitLow)^a
+//   bernN    sum_k c_k B_k,N(t), c_0 = 1, c_k = exp(p_k)  (N free parameters)
+// The likelihood is normalised over the sidebands only, so the blinded
+// events never enter. Gradients are analytic and minimisation is BFGS.
+enum class BkgShape { Exponential, PowerLaw, Bernstein };
+
+struct BkgModel {
+    BkgShape shape = BkgShape::Exponential;
+    int order = 0; // Bernstein only, 1..8
+
+    int nParams() const { return shape == BkgShape::Bernstein ? order : 1; }
+};
+
+// "exp", "pow", "bern1" ... "bern8"
+bool parseBkgModel(const std::string& name, BkgModel& model);
+std::string bkgModelName(const BkgModel& model);
+
+struct SidebandFitOptions {
+    double fitLow    = SelectionCuts{}.mggMin;
+    double fitHigh   = SelectionCuts{}.mggMax;
+    double blindLow  = BLIND_LOW;
+    double blindHigh = BLIND_HIGH;
+    int threads      = 1;     // likelihood evaluation threads (Bernstein)
+    int maxIterations = 200;
+    double tolerance = 1e-7;  // on max |gradient| / sum of weights
+};
+
+struct SidebandFitResult {
+    BkgModel model;
+    bool converged = false;
+    int iterations = 0;
+    int evaluations = 0;   // likelihood + gradient evaluations
+    double nll = 0;
+    std::vector<double> params;
+    std::vector<double> errors;                   // sqrt of the covariance diagonal
+    std::vector<std::vector<double>> covariance;  // inverse Hessian of the NLL
+    double seconds = 0;
+};
+
+// Background in an mgg window from a fit: value = sideband yield x the
+// fraction of the shape in the window
+struct WindowYield {
+    double lo = 0, hi = 0;
+    double expected = 0;
+    double statError = 0;   // sideband yield (sqrt of sum w^2)
+    double shapeError = 0;  // fit parameters, through the covariance
+    double observed = 0;    // sum of weights of the fitted (sideband) events in the window
+    bool blinded = false;   // window overlaps the blinded region: observed is partial
+};
+
+class SidebandFitter {
+public:
+    // Keeps the events of mgg inside the sidebands; weight may be empty
+    // (unit weights). The spans are copied, so they may go away afterwards.
+    SidebandFitter(ColumnSpan<double> mgg, ColumnSpan<double> weight,
+                   const SidebandFitOptions& opts = SidebandFitOptions{});
+
+    SidebandFitResult fit(const BkgModel& model) const;
+    // Windows are clipped to the fit range
+    WindowYield yield(const SidebandFitResult& result, double lo, double hi) const;
+    // Integral of the fitted shape over [lo, hi] divided by its integral over
+    // the sidebands (lo, hi inside the fit range)
+    double fraction(const SidebandFitResult& result, double lo, double hi) const;
+
+    std::size_t getEvents() const { return t_.size(); }
+    double getSumW() const { return sumW_; }
+    const SidebandFitOptions& getOptions() const { return opts_; }
+
+private:
+    struct Evaluation {
+        double nll = 0;
+        std::vector<double> grad;
+    };
+
+    Evaluation evaluate(const BkgModel& model, const std::vector<double>& params,
+                        const std::vector<std::vector<double>>& basis) const;
+    // Integral of the unnormalised shape over [t1, t2] and its gradient
+    double integral(const BkgModel& model, const std::vector<double>& params, double t1, double t2,
+                    std::vector<double>* grad) const;
+    double sidebandIntegral(const BkgModel& model, const std::vector<double>& params,
+                            std::vector<double>* grad) const;
+    double toT(double mgg) const { return (mgg - opts_.fitLow) / (opts_.fitHigh - opts_.fitLow); }
+
+    SidebandFitOptions opts_;
+    std::vector<double> t_, w_;
+    double sumW_ = 0, sumW2_ = 0;
+    double sumWT_ = 0, sumWLogU_ = 0; // sufficient statistics of exp / pow
+    double tBlindLow_ = 0, tBlindHigh_ = 0;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SKIM_H
+#define SKIM_H
+
+#include "Config.h"
+#include "Selection.h"
+#include "TreeLayout.h"
+#include <string>
+#include <vector>
+
+// Skim: a copy of the input tree holding only the events that pass the
+// preselection of at least one chosen scheme, and only the listed branches.
+// run_analysis reads the result like any other input.
+struct SkimOptions {
+    std::string outputFile;
+    std::string treeName = "data";
+    // Branch names, '*' / '?' wildcards allowed. Empty: every branch bound
+    // for EventData and the chosen schemes' SchemeData
+    std::vector<std::string> branches;
+    // Branches keep the type the input stores them as. With narrow, flags
+    // and counts stored as Double_t are written as the type skimNarrowType
+    // gives them (UChar_t); values that do not fit count in nInexact.
+    bool narrow = true;
+    // Compression, cluster and basket sizes. With no hot branches the bound
+    // (analysis) branches are created first.
+    TreeLayout layout;
+};
+
+struct SkimReport {
+    Long64_t nRead = 0;
+    Long64_t nWritten = 0;
+    int nBranches = 0;
+    int nFilesOk = 0;
+    Long64_t nInexact = 0;              // narrowed values that did not fit
+    std::vector<std::string> failures;  // one per failed file; none of its events are written
+};
+
+// Name of the per-scheme pass bitmask branch (UChar_t, bit = SchemeId)
+constexpr const char* SKIM_MASK_BRANCH = "skim_pass";
+
+// Type a double branch is narrowed to, 0 to keep it as is: flags (0/1) and
+// counts (up to 255) get what ColumnStats::narrowestType infers for those
+// values, UChar_t. Values that do not fit (the -999 sentinel) are clamped and
+// counted in SkimReport::nInexact.
+char skimNarrowType(const std::string& branch);
+
+SkimReport runSkim(const SkimOptions& opts, const std::vector<std::string>& files,
+                   const std::vector<std::string>& schemeKeys, const EventSelector& selector);
+
+#endif
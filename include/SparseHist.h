@@ -0,0 +1,98 @@
+#ifndef SPARSEHIST_H
+#define SPARSEHIST_H
+
+#include "FastHist.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <iosfwd>
+#include <cstdint>
+
+// Uniform axis with under/overflow bins, same binning rules as FastHist1D
+struct SparseAxis {
+    std::string name;
+    int nbins = 0;
+    double xmin = 0, xmax = 0;
+};
+
+// Range cut for projections. Bins are kept whole: a bin passes if its centre
+// lies in [lo, hi); the underflow counts as -inf and the overflow as +inf.
+struct SparseCut {
+    int axis = 0;
+    double lo = 0, hi = 0;
+};
+
+// N-dimensional histogram that stores only its occupied cells (sum of
+// weights, sum of squared weights and entries, keyed by the packed bin
+// indices), so memory grows with the cells events actually land in, not with
+// the product of the axis sizes. Filled once in the event loop; any 1D / 2D
+// projection with range cuts on the other axes is then one pass over the
+// occupied cells.
+class SparseHist {
+public:
+    SparseHist() = default;
+    SparseHist(const std::string& name, const std::vector<SparseAxis>& axes);
+
+    // x holds one value per axis
+    void fill(const double* x, double w = 1.0) {
+        Cell& c = cells_[key(x)];
+        c.sumw  += w;
+        c.sumw2 += w * w;
+        ++c.entries;
+        ++entries_;
+    }
+
+    // Cell-by-cell sum of a store with the same axes
+    void add(const SparseHist& other);
+    SparseHist cloneEmpty() const { return SparseHist(name_, axes_); }
+    bool sameAxes(const SparseHist& other) const;
+
+    FastHist1D project1D(int axis, const std::vector<SparseCut>& cuts = {}) const;
+    FastHist2D project2D(int xAxis, int yAxis, const std::vector<SparseCut>& cuts = {}) const;
+
+    const std::string& getName() const { return name_; }
+    const std::vector<SparseAxis>& getAxes() const { return axes_; }
+    int findAxis(const std::string& name) const; // -1 if none
+    long long getEntries() const { return entries_; }
+    std::size_t getOccupiedCells() const { return cells_.size(); }
+    std::size_t getMemoryBytes() const;          // approximate, hash table included
+
+    void write(std::ostream& out) const;
+    // Replace the content; false (and unchanged) on a malformed stream
+    bool read(std::istream& in);
+
+private:
+    struct Cell {
+        ExactSum sumw, sumw2;
+        long long entries = 0;
+    };
+
+    uint64_t key(const double* x) const {
+        uint64_t k = 0;
+        for (std::size_t a = 0; a < axes_.size(); ++a) {
+            const SparseAxis& ax = axes_[a];
+            k += stride_[a] * static_cast<uint64_t>(fastHistBin(x[a], ax.nbins, ax.xmin, ax.xmax));
+        }
+        return k;
+    }
+    int binOf(uint64_t key, std::size_t axis) const {
+        return static_cast<int>(key / stride_[axis] % static_cast<uint64_t>(axes_[axis].nbins + 2));
+    }
+    // Per-axis pass flags of every bin, for the cuts of a projection
+    std::vector<std::vector<char>> cutMasks(const std::vector<SparseCut>& cuts) const;
+    bool passes(uint64_t key, const std::vector<std::vector<char>>& masks) const;
+
+    std::string name_;
+    std::vector<SparseAxis> axes_;
+    std::vector<uint64_t> stride_;
+    std::unordered_map<uint64_t, Cell> cells_;
+    long long entries_ = 0;
+};
+
+// One store per scheme in a single binary file (run_analysis --sparse,
+// tools/sparse_query)
+bool saveSparseStores(const std::string& path, const std::map<std::string, SparseHist>& stores);
+bool loadSparseStores(const std::string& path, std::map<std::string, SparseHist>& stores);
+
+#endif
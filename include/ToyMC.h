@@ -0,0 +1,81 @@
+#ifndef TOYMC_H
+#define TOYMC_H
+
+#include "SidebandFit.h"
+#include "Selection.h"
+#include "FastHist.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Pseudo-experiments on the passing events of a scheme (held in memory:
+// UnbinnedEvents or a mapped UnbinnedFile, never the tree). Every toy gets
+// its own RNG stream seeded from (seed, toy index), and toys are handed to
+// threads in small blocks from a shared counter, so any thread count gives
+// the same toys.
+//
+//   model:     mgg drawn from the sideband fit of the data over the whole fit
+//              range (SidebandFit.h), a Poisson-distributed number of
+//              events, each with a weight drawn from the data sideband
+//              weights: the toys sum weights like the data, and their
+//              expected sum of weights is the fitted yield
+//   bootstrap: the passing events resampled with replacement
+//
+// Each toy is counted like the data: EventSelector signal region and
+// sidebands (inside the mgg window) of the fit's blinded window, and the
+// study window. The test statistic is the
+// count in the study window, or with Excess that count minus the background
+// a fit to the toy's own sidebands predicts there. A toy whose fit does not
+// converge is marked failed and left out of the p-value, the quantiles and
+// the histogram; nFailed says how many.
+enum class ToyMode { Model, Bootstrap };
+enum class ToyStatistic { Count, Excess };
+
+bool parseToyMode(const std::string& name, ToyMode& mode);
+bool parseToyStatistic(const std::string& name, ToyStatistic& statistic);
+
+struct ToyOptions {
+    ToyMode mode = ToyMode::Model;
+    ToyStatistic statistic = ToyStatistic::Count;
+    long long nToys = 10000;
+    uint64_t seed = 1;
+    int threads = 0;              // 0 → one per core
+    int blockSize = 64;           // toys taken from the shared counter at a time
+    double windowLow  = BLIND_LOW;
+    double windowHigh = BLIND_HIGH;
+    BkgModel model;               // Model toys and Excess
+    SidebandFitOptions fit;       // fit range and blinding; threads ignored
+};
+
+// One toy (or the data)
+struct ToyOutcome {
+    double statistic = 0;
+    double window = 0;        // sum of weights in the study window
+    double signalRegion = 0;  // passSignalRegion of fit.blindLow / blindHigh
+    double sidebands = 0;     // passSideband of the same and passDiphotonMass
+    bool failed = false;      // Excess: the sideband fit did not converge
+};
+
+struct ToyResult {
+    bool ok = false;
+    std::string error;
+    ToyOutcome data;                  // the input itself (blinded window: partial)
+    std::vector<ToyOutcome> toys;     // in toy order, failed ones included
+    long long nFailed = 0;            // toys with failed set
+    SidebandFitResult dataFit;        // Model / Excess: fit to the data sidebands
+    double seconds = 0;
+    double toysPerSecond = 0;
+
+    // Toys not failed
+    long long nUsable() const { return static_cast<long long>(toys.size()) - nFailed; }
+    // Fraction of usable toys with a statistic >= observed
+    double pValue(double observed) const;
+    // Statistic value below which a fraction q of the usable toys lie
+    double quantile(double q) const;
+    FastHist1D histogram(int nbins) const;
+};
+
+ToyResult runToys(const ToyOptions& opts, ColumnSpan<double> mgg, ColumnSpan<double> weight,
+                  const EventSelector& selector);
+
+#endif
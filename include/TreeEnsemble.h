@@ -0,0 +1,123 @@
+#ifndef TREEENSEMBLE_H
+#define TREEENSEMBLE_H
+
+#include "Config.h"
+#include "Selection.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+// Boosted decision trees for inference in the event loop, loaded from an
+// XGBoost JSON model (gbtree or dart, numerical splits) or a TMVA BDT weight
+// file (AdaBoost or Grad, classification or multiclass).
+//
+// All trees are flattened into one node array. Each tree is stored breadth
+// first with the two children of a node next to each other, so a step is
+//     node = left + (x[feature] >= threshold)
+// Leaves point to themselves with a NaN threshold, so every event walks a
+// tree for exactly its depth with no data-dependent branch. predict() walks
+// a block of events through one tree at a time, interleaving their
+// independent node loads, eight events per AVX2 gather where available.
+class TreeEnsemble {
+public:
+    // How the summed leaf values become outputs
+    enum class Transform {
+        Raw,          // sum + base score
+        Sigmoid,      // XGBoost binary:logistic
+        Softmax,      // XGBoost multi:softprob, TMVA multiclass Grad
+        TmvaGrad,     // 2 / (1 + exp(-2 sum)) - 1
+        TmvaAdaBoost  // sum of boost weight x leaf / sum of boost weights
+    };
+
+    // .json: XGBoost, .xml: TMVA. Returns false and sets getError() on failure.
+    bool load(const std::string& path);
+    const std::string& getError() const { return error_; }
+
+    int getNumFeatures() const { return static_cast<int>(featureNames_.size()); }
+    int getNumOutputs() const { return nOutputs_; }
+    const std::vector<std::string>& getFeatureNames() const { return featureNames_; }
+    // TMVA spectators (the TMVA::Reader needs them declared); empty for XGBoost
+    const std::vector<std::string>& getSpectatorNames() const { return spectators_; }
+    std::size_t getNumTrees() const { return roots_.size(); }
+    std::size_t getNumNodes() const { return nodes_.size(); }
+    int getMaxDepth() const;
+    Transform getTransform() const { return transform_; }
+    // Range of the outputs, for booking histograms
+    void getOutputRange(double& lo, double& hi) const;
+    // Smallest / largest split threshold of every feature (benchmark inputs)
+    std::vector<std::pair<float, float>> getSplitRanges() const;
+
+    // rows: n events x getNumFeatures() values, row-major (NaN = missing);
+    // out: n x getNumOutputs(). The instruction set is picked at runtime
+    // (EventSelector::detectSimdLevel) unless a level is forced; all levels
+    // give identical outputs.
+    void predict(const float* rows, std::size_t n, float* out) const;
+    void predict(const float* rows, std::size_t n, float* out, SimdLevel level) const;
+
+private:
+    // 16 bytes: four nodes per cache line
+    struct Node {
+        float    threshold = 0; // NaN for leaves
+        int32_t  left = 0;      // right child is left + 1; leaves: own index
+        float    value = 0;     // leaf value
+        uint16_t feature = 0;
+        uint8_t  missingRight = 0; // NaN inputs go right
+        uint8_t  pad = 0;
+    };
+
+    // One tree as read from the file, before flattening: node 0 is the root,
+    // left < 0 marks a leaf
+    struct RawTree {
+        std::vector<int> left, right, feature;
+        std::vector<float> threshold, value;
+        std::vector<char> missingRight;
+        int output = 0;
+        float weight = 1;
+    };
+
+    bool loadXGBoost(const std::string& text);
+    bool loadTmva(const std::string& text);
+    bool addTree(const RawTree& tree);
+    // Advance idx[j] (node of event j, rows x) by depth levels
+    static void walkScalar(const Node* nodes, const float* x, std::size_t nf, int32_t* idx,
+                           std::size_t begin, std::size_t end, int depth);
+    static void walkAVX2(const Node* nodes, const float* x, std::size_t nf, int32_t* idx,
+                         std::size_t m, int depth);
+
+    std::vector<Node> nodes_;
+    std::vector<int32_t> roots_;
+    std::vector<int> depth_, treeOutput_;
+    std::vector<float> treeWeight_;
+    std::vector<float> baseScore_;  // per output
+    std::vector<std::string> featureNames_, spectators_;
+    int nOutputs_ = 1;
+    Transform transform_ = Transform::Raw;
+    double weightSum_ = 0;          // TmvaAdaBoost normalisation
+    bool yesNoLeaf_ = true;         // TMVA leaves are +-1 rather than purities
+    std::string error_;
+};
+
+// A model evaluated in the event loop (run_analysis --bdt NAME=FILE). Its
+// outputs become per-scheme histograms next to the getSchemePlotDefs() ones:
+// NAME for single-output models, NAME_0, NAME_1, ... otherwise.
+struct BdtVariable {
+    std::string name;
+    std::shared_ptr<const TreeEnsemble> model;
+    std::vector<FieldRef> features; // one per model feature
+    int nbins = 50;
+    double xmin = 0, xmax = 1;
+
+    std::string plotName(int output) const;
+    PlotDef plotDef(int output) const;
+};
+
+// Load a model and resolve its feature names against the fields of
+// getPlotDefs() / getSchemePlotDefs() (a scheme prefix such as "nonRes_" is
+// ignored). Returns false and sets error if a feature is unknown.
+bool makeBdtVariable(const std::string& name, const std::string& path, BdtVariable& var,
+                     std::string& error);
+
+#endif
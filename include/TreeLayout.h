@@ -0,0 +1,47 @@
+#ifndef TREELAYOUT_H
+#define TREELAYOUT_H
+
+#include <TFile.h>
+#include <TTree.h>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// On-disk layout of the trees the converters write (csv_to_root, --skim).
+// Zero / negative defaults keep ROOT's own settings.
+struct TreeLayout {
+    // ROOT::RCompressionSetting::EAlgorithm: 1 ZLIB, 2 LZMA, 4 LZ4, 5 ZSTD;
+    // -1 keeps the file default, 0 with level 0 stores uncompressed
+    int algorithm = -1;
+    int level = 0;
+    // TTree::SetAutoFlush: > 0 entries per cluster, < 0 compressed bytes per
+    // cluster, 0 keeps ROOT's default (30 MB)
+    Long64_t autoFlush = 0;
+    // Bytes per basket, 0: ROOT's 32000. This is only the starting size:
+    // when autoFlush is set (or by default), TTree::Fill calls
+    // OptimizeBaskets at the first cluster and resizes every branch's
+    // baskets from its share of the bytes, so later clusters do not keep it.
+    Int_t basketSize = 0;
+    // Branches created first ('*' / '?' wildcards allowed). ROOT writes the
+    // baskets of a cluster in branch order, so the branches the analysis
+    // reads end up next to each other in the file.
+    std::vector<std::string> hotBranches;
+};
+
+// "zstd", "lz4:4", "zlib:6", "lzma:9" or "none"; the level defaults to 5
+// (4 for LZ4). Returns false for an unknown algorithm.
+bool parseCompression(const std::string& spec, TreeLayout& layout);
+// Inverse of parseCompression, "default" when ROOT's setting is kept
+std::string compressionName(const TreeLayout& layout);
+
+// Compression settings: call before the tree is created
+void applyFileLayout(TFile* file, const TreeLayout& layout);
+// Cluster and (starting) basket sizes: call after every branch is created
+void applyTreeLayout(TTree* tree, const TreeLayout& layout);
+
+// Order in which to create the branches: hot branches first (in hot-list
+// order), then the rest in their original order
+std::vector<std::size_t> hotFirstOrder(const std::vector<std::string>& names,
+                                       const std::vector<std::string>& hot);
+
+#endif
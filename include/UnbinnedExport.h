@@ -0,0 +1,114 @@
+#ifndef UNBINNEDEXPORT_H
+#define UNBINNEDEXPORT_H
+
+#include "EventData.h"
+#include "LeafTypes.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Unbinned export of the events passing the preselection of a scheme
+// (run_analysis --export-unbinned), for fits outside the event loop.
+//
+// File layout (native byte order, every offset a multiple of 64):
+//   UnbinnedHeader        64 bytes: magic "HHUB", version, events, columns, scheme
+//   UnbinnedColumnEntry   64 bytes per column: name, leafTypeCode, offset, bytes
+//   column arrays         raw values, one array per column, 64-byte aligned
+// so a reader maps the file and points straight into it: no copy, no parsing.
+
+// Values collected by the event loop for one scheme, in entry order
+struct UnbinnedEvents {
+    std::vector<double> mgg, mjj, weight;
+    std::vector<unsigned char> category; // see bdtCategory
+
+    void push(double m, double j, double w, unsigned char c) {
+        mgg.push_back(m);
+        mjj.push_back(j);
+        weight.push_back(w);
+        category.push_back(c);
+    }
+    void append(const UnbinnedEvents& other);
+    void clear();
+    std::size_t size() const { return mgg.size(); }
+};
+
+// MultiBDT category of an event: index of the largest MultiBDT_output score
+// (0 is the highest-purity class)
+unsigned char bdtCategory(const EventData& evt);
+// Same from the four scores
+unsigned char bdtCategory(const float* scores);
+
+// Write events to path (through a temporary and a rename). Returns false
+// and reports on errors.
+bool writeUnbinnedFile(const std::string& path, const std::string& schemeKey,
+                       const UnbinnedEvents& events);
+
+// Contiguous read-only view of n values (C++17 stand-in for std::span)
+template <typename T>
+class ColumnSpan {
+public:
+    ColumnSpan() = default;
+    ColumnSpan(const T* data, std::size_t n) : data_(data), size_(n) {}
+
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    ColumnSpan subspan(std::size_t offset, std::size_t n) const {
+        return ColumnSpan(data_ + offset, n);
+    }
+
+private:
+    const T* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// Memory-mapped unbinned file. Spans stay valid while the object lives.
+class UnbinnedFile {
+public:
+    explicit UnbinnedFile(const std::string& path);
+    ~UnbinnedFile();
+    UnbinnedFile(const UnbinnedFile&) = delete;
+    UnbinnedFile& operator=(const UnbinnedFile&) = delete;
+
+    bool isOpen() const { return data_ != nullptr; }
+    const std::string& getError() const { return error_; }
+    const std::string& getScheme() const { return scheme_; }
+    std::size_t size() const { return nEvents_; }
+
+    // Empty span if the column does not exist or T does not match its type
+    template <typename T>
+    ColumnSpan<T> column(const std::string& name) const {
+        for (auto& c : columns_) {
+            if (c.name == name && c.type == leafTypeCode<T>()) {
+                return ColumnSpan<T>(reinterpret_cast<const T*>(data_ + c.offset), nEvents_);
+            }
+        }
+        return ColumnSpan<T>();
+    }
+    ColumnSpan<double> mgg() const { return column<double>("mgg"); }
+    ColumnSpan<double> mjj() const { return column<double>("mjj"); }
+    ColumnSpan<double> weight() const { return column<double>("weight"); }
+    ColumnSpan<unsigned char> category() const { return column<unsigned char>("category"); }
+
+    std::vector<std::string> getColumnNames() const;
+
+private:
+    struct ColumnInfo {
+        std::string name;
+        char type = 0;
+        std::size_t offset = 0;
+    };
+
+    const char* data_ = nullptr;
+    std::size_t bytes_ = 0;
+    std::size_t nEvents_ = 0;
+    std::string scheme_;
+    std::vector<ColumnInfo> columns_;
+    std::string error_;
+};
+
+#endif
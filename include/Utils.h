@@ -2,9 +2,34 @@
 #define UTILS_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 
 std::string schemeBranch(const std::string& prefix, const std::string& suffix);
 void ensureDirectory(const std::string& path);
+bool fileExists(const std::string& path);
 bool isSentinel(double val, double sentinel = -999.0);
 
+// 64-bit FNV-1a hash of a byte range; pass a previous result as h to chain
+constexpr uint64_t kHashSeed = 14695981039346656037ULL;
+uint64_t hashBytes(const void* data, std::size_t n, uint64_t h = kHashSeed);
+inline uint64_t hashString(const std::string& s, uint64_t h = kHashSeed) {
+    return hashBytes(s.data(), s.size(), h);
+}
+template <typename T>
+uint64_t hashValue(const T& v, uint64_t h = kHashSeed) { return hashBytes(&v, sizeof(T), h); }
+
+// Expand input specs into an ordered, de-duplicated list of files. Each spec is
+// a file, a glob pattern, a directory (all *.root / *.parquet inside) or a file list
+// (*.txt / *.list, one spec per line, '#' comments). Specs that match nothing
+// are appended to `unmatched` when given.
+std::vector<std::string> expandInputs(const std::vector<std::string>& specs,
+                                      std::vector<std::string>* unmatched = nullptr);
+
+// Branch list from a spec: a file with one name per line ('#' comments; the
+// "name : name/T" lines of data/branch_list.txt work too) or a comma-separated
+// list of names
+std::vector<std::string> parseBranchList(const std::string& spec);
+
 #endif
@@ -3,12 +3,22 @@
 #include "Selection.h"
 #include "Plotter.h"
 #include "Utils.h"
+#include "Analysis.h"
+#include "ResultCache.h"
+#include "Skim.h"
+#include "EventIndex.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <chrono>
+#include <iomanip>
 #include <TH1D.h>
 #include <TH2D.h>
 
@@ -16,35 +26,123 @@
 // CLI argument parsing
 // ---------------------------------------------------------------------------
 struct CLIArgs {
-    std::string input      = "data/all_data_full.root";
+    std::vector<std::string> inputs;  // files, globs, directories, lists; empty → default
     std::string outputDir  = "plots";
     std::vector<std::string> schemes; // empty → all
     bool noBlind           = false;
     bool cutflowOnly       = false;
+    int  threads           = 1;
+    bool inMemory          = false;
+    long memoryBudgetMB    = 2048;
+    std::string spillDir   = "/tmp";
+    long readCacheMB       = 64;  // TTreeCache per worker; 0 → off
+    bool prefetch          = false;
+    RenderMode render      = RenderMode::Serial;
+    int  renderJobs        = 0;   // 0 → one per core
+    std::string cacheDir;         // non-empty → result cache (--cache, --cache-dir)
+    std::string stateDir;         // non-empty → incremental run
+    std::string skimFile;         // non-empty → write a skim and exit
+    std::string skimBranches;     // file or comma-separated list; empty → bound branches
+    bool skimKeepTypes     = false;
+    TreeLayout skimLayout;        // --skim-compression / --skim-cluster-mb
+    std::string pickEvents;       // non-empty → print these run:lumi:event and exit
+    std::string indexDir;         // event index sidecars; empty → next to each input
+    bool sparse            = false; // fill and save the per-scheme sparse store
+    std::string unbinnedDir;      // non-empty → write <scheme>.hhub unbinned exports here
+    std::vector<std::pair<std::string, std::string>> bdt; // --bdt NAME=FILE, in order
 };
 
 CLIArgs parseArgs(int argc, char** argv) {
     CLIArgs args;
     for (int i = 1; i < argc; ++i) {
         std::string a = argv[i];
-        if (a == "--input" && i + 1 < argc)          { args.input = argv[++i]; }
+        if (a == "--input") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                args.inputs.push_back(argv[++i]);
+            }
+        }
         else if (a == "--output-dir" && i + 1 < argc) { args.outputDir = argv[++i]; }
         else if (a == "--no-blind")                    { args.noBlind = true; }
         else if (a == "--cutflow-only")                { args.cutflowOnly = true; }
+        else if (a == "--threads" && i + 1 < argc)     { args.threads = std::max(1, std::atoi(argv[++i])); }
+        else if (a == "--in-memory")                   { args.inMemory = true; }
+        else if (a == "--memory-budget" && i + 1 < argc) { args.memoryBudgetMB = std::atol(argv[++i]); }
+        else if (a == "--spill-dir" && i + 1 < argc)   { args.spillDir = argv[++i]; }
+        else if (a == "--read-cache" && i + 1 < argc)  { args.readCacheMB = std::max(0L, std::atol(argv[++i])); }
+        else if (a == "--prefetch")                    { args.prefetch = true; }
+        else if (a == "--render" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (!parseRenderMode(mode, args.render)) {
+                std::cerr << "ERROR: Unknown render mode '" << mode
+                          << "' (serial, none, parallel, lazy)" << std::endl;
+                std::exit(1);
+            }
+        }
+        else if (a == "--cache")                       { args.cacheDir = ".hhbbgg_cache"; }
+        else if (a == "--cache-dir" && i + 1 < argc)   { args.cacheDir = argv[++i]; }
+        else if (a == "--no-cache")                    { args.cacheDir.clear(); }
+        else if (a == "--state" && i + 1 < argc)       { args.stateDir = argv[++i]; }
+        else if (a == "--skim" && i + 1 < argc)        { args.skimFile = argv[++i]; }
+        else if (a == "--skim-branches" && i + 1 < argc) { args.skimBranches = argv[++i]; }
+        else if (a == "--skim-keep-types")             { args.skimKeepTypes = true; }
+        else if (a == "--skim-compression" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            if (!parseCompression(spec, args.skimLayout)) {
+                std::cerr << "ERROR: Unknown compression '" << spec
+                          << "' (zlib, lzma, lz4, zstd or none, optionally :LEVEL)" << std::endl;
+                std::exit(1);
+            }
+        }
+        else if (a == "--skim-cluster-mb" && i + 1 < argc) {
+            args.skimLayout.autoFlush = -(std::max(1L, std::atol(argv[++i])) << 20);
+        }
+        else if (a == "--pick-events" && i + 1 < argc) { args.pickEvents = argv[++i]; }
+        else if (a == "--index-dir" && i + 1 < argc)   { args.indexDir = argv[++i]; }
+        else if (a == "--sparse")                      { args.sparse = true; }
+        else if (a == "--export-unbinned" && i + 1 < argc) { args.unbinnedDir = argv[++i]; }
+        else if (a == "--bdt" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            std::size_t eq = spec.find('=');
+            if (eq == 0 || eq == std::string::npos || eq + 1 == spec.size()) {
+                std::cerr << "ERROR: Bad --bdt '" << spec << "' (expected NAME=MODEL.json|MODEL.xml)"
+                          << std::endl;
+                std::exit(1);
+            }
+            args.bdt.emplace_back(spec.substr(0, eq), spec.substr(eq + 1));
+        }
+        else if (a == "--render-jobs" && i + 1 < argc) { args.renderJobs = std::max(0, std::atoi(argv[++i])); }
         else if (a == "--schemes") {
             while (i + 1 < argc && argv[i + 1][0] != '-') {
                 args.schemes.push_back(argv[++i]);
             }
         } else {
             std::cerr << "Unknown argument: " << a << "\n"
-                      << "Usage: run_analysis [--input FILE] [--output-dir DIR] "
-                         "[--schemes s1 s2 ...] [--no-blind] [--cutflow-only]\n";
+                      << "Usage: run_analysis [--input FILE|GLOB|DIR|LIST ...] [--output-dir DIR] "
+                         "[--schemes s1 s2 ...] [--no-blind] [--cutflow-only] [--threads N]\n"
+                         "       [--in-memory] [--memory-budget MB] [--spill-dir DIR]\n"
+                         "       [--read-cache MB] [--prefetch]\n"
+                         "       [--render serial|none|parallel|lazy] [--render-jobs N]\n"
+                         "       [--cache | --cache-dir DIR] [--state DIR] [--sparse]\n"
+                         "       [--export-unbinned DIR] [--bdt NAME=MODEL.json|MODEL.xml ...]\n"
+                         "       [--skim FILE [--skim-branches FILE|LIST] [--skim-keep-types]\n"
+                         "        [--skim-compression ALG[:LEVEL]] [--skim-cluster-mb MB]]\n"
+                         "       [--pick-events run:lumi:event,...|FILE [--index-dir DIR]]\n";
             std::exit(1);
         }
     }
+    if (args.inputs.empty()) args.inputs.push_back("data/all_data_full.root");
     return args;
 }
 
+// Hash of a whole --bdt model file (checksumFile is meant for ROOT and
+// Parquet inputs, and retrained models often keep their size)
+static uint64_t hashModelFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    return hashString(oss.str());
+}
+
 // ---------------------------------------------------------------------------
 // Main
 // ---------------------------------------------------------------------------
@@ -68,160 +166,315 @@ int main(int argc, char** argv) {
         }
     }
 
+    // Resolve input files
+    std::vector<std::string> unmatched;
+    std::vector<std::string> inputFiles = expandInputs(args.inputs, &unmatched);
+    for (auto& spec : unmatched) {
+        std::cerr << "WARNING: Input '" << spec << "' matched no files" << std::endl;
+    }
+    if (inputFiles.empty()) {
+        std::cerr << "ERROR: No input files" << std::endl;
+        return 1;
+    }
+
     std::cout << "=== HH->bbgg Analysis ===" << std::endl;
-    std::cout << "Input:   " << args.input << std::endl;
+    if (inputFiles.size() == 1) {
+        std::cout << "Input:   " << inputFiles[0] << std::endl;
+    } else {
+        std::cout << "Input:   " << inputFiles.size() << " files (" << inputFiles.front()
+                  << " ...)" << std::endl;
+    }
     std::cout << "Output:  " << args.outputDir << std::endl;
     std::cout << "Schemes:";
     for (auto& s : schemeKeys) std::cout << " " << s;
     std::cout << std::endl;
     std::cout << "Blind:   " << (args.noBlind ? "OFF" : "ON") << std::endl;
-
-    // Open data
-    DataLoader loader(args.input);
-    EventData evt;
-    loader.setupBranches(evt);
-
-    // Setup scheme data — one SchemeData per scheme, all connected to the same TTree
-    std::map<std::string, SchemeData> schemeDatas;
-    for (auto& key : schemeKeys) {
-        schemeDatas[key] = SchemeData{};
-        loader.setupSchemeBranches(schemeDatas[key], key);
-    }
+    std::cout << "Threads: " << args.threads << std::endl;
 
     // Selection
     EventSelector selector;
 
-    // ----- Cutflow-only mode -----
-    if (args.cutflowOnly) {
-        for (auto& key : schemeKeys) {
-            selector.printCutflow(loader, key);
+    // ----- Pick-events mode -----
+    // Find the requested events through the per-file event indexes, print
+    // them and stop
+    if (!args.pickEvents.empty()) {
+        std::vector<EventId> ids = parseEventList(args.pickEvents);
+        if (ids.empty()) {
+            std::cerr << "ERROR: No valid event in '" << args.pickEvents << "'" << std::endl;
+            return 1;
         }
-        return 0;
+        std::cout << "\nPicking " << ids.size() << " event(s)..." << std::endl;
+        auto t0 = std::chrono::steady_clock::now();
+        int nBuilt = 0;
+        std::vector<EventLocation> found = locateEvents(inputFiles, ids, args.indexDir, &nBuilt);
+        auto t1 = std::chrono::steady_clock::now();
+        if (nBuilt > 0) std::cout << "Built the event index of " << nBuilt << " file(s)" << std::endl;
+
+        std::cout << "\n" << std::left << std::setw(28) << "run:lumi:event" << std::setw(10) << "entry"
+                  << std::setw(10) << "mass" << std::setw(8) << "n_jets" << std::setw(9) << "nBLoose"
+                  << "preselection  file" << std::right << std::endl;
+        std::unique_ptr<DataLoader> loader;
+        EventData evt;
+        std::vector<SchemeData> sds(N_SCHEMES); // sized once: addresses are bound
+        for (auto& loc : found) {
+            const std::string& file = inputFiles[loc.fileIndex];
+            if (!loader || loader->getFileName() != file) {
+                loader = std::make_unique<DataLoader>(file);
+                loader->setupBranches(evt);
+                for (auto& key : schemeKeys) loader->setupSchemeBranches(sds[schemeIndex(key)], key);
+            }
+            if (!loader->isOpen()) continue;
+            loader->getEntry(loc.entry);
+            std::string passing;
+            for (auto& key : schemeKeys) {
+                int s = schemeIndex(key);
+                if (selector.passPreselection(evt, sds[s], static_cast<SchemeId>(s))) {
+                    passing += (passing.empty() ? "" : ",") + key;
+                }
+            }
+            std::cout << std::left << std::setw(28) << formatEventId(loc.id) << std::setw(10) << loc.entry
+                      << std::setw(10) << evt.mass << std::setw(8) << static_cast<int>(evt.n_jets)
+                      << std::setw(9) << static_cast<int>(evt.nBLoose)
+                      << (passing.empty() ? "-" : passing) << "  " << file << std::right << std::endl;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        int nMissing = 0;
+        for (auto& id : ids) {
+            bool seen = std::any_of(found.begin(), found.end(),
+                                    [&](const EventLocation& l) { return l.id == id; });
+            if (!seen) {
+                std::cerr << "WARNING: Event " << formatEventId(id) << " not found" << std::endl;
+                ++nMissing;
+            }
+        }
+        std::cout << "\nFound " << ids.size() - nMissing << "/" << ids.size() << " event(s) in "
+                  << inputFiles.size() << " file(s): lookup "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, read "
+                  << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms" << std::endl;
+        return nMissing == static_cast<int>(ids.size()) ? 1 : 0;
     }
 
-    // ----- Book histograms -----
-    Plotter plotter(args.outputDir);
-    auto commonDefs = getPlotDefs();
-    auto schemeDefs = getSchemePlotDefs();
-
-    // Common histograms
-    std::map<std::string, TH1D*> hCommon;
-    for (auto& [varName, def] : commonDefs) {
-        hCommon[varName] = plotter.bookTH1(varName, def);
+    // ----- Skim mode -----
+    // Write the preselected events to a new tree and stop
+    if (!args.skimFile.empty()) {
+        SkimOptions skimOpts;
+        skimOpts.outputFile = args.skimFile;
+        if (!args.skimBranches.empty()) skimOpts.branches = parseBranchList(args.skimBranches);
+        skimOpts.narrow = !args.skimKeepTypes;
+        skimOpts.layout = args.skimLayout;
+
+        std::cout << "\nSkimming " << inputFiles.size() << " file(s) into " << args.skimFile
+                  << "..." << std::endl;
+        SkimReport skim = runSkim(skimOpts, inputFiles, schemeKeys, selector);
+        for (auto& msg : skim.failures) std::cerr << "WARNING: " << msg << std::endl;
+        if (skim.nFilesOk == 0) {
+            std::cerr << "ERROR: No input file could be skimmed" << std::endl;
+            return 1;
+        }
+        std::cout << "Kept " << skim.nWritten << " of " << skim.nRead << " events, "
+                  << skim.nBranches << " branches" << std::endl;
+        if (skim.nInexact > 0) {
+            std::cerr << "WARNING: " << skim.nInexact << " narrowed value(s) did not fit their "
+                      << "type; use --skim-keep-types to keep doubles" << std::endl;
+        }
+        return 0;
     }
 
-    // Per-scheme histograms
-    std::map<std::string, std::map<std::string, TH1D*>> hScheme;
-    std::map<std::string, TH2D*> h2D_massPlane;
-    for (auto& key : schemeKeys) {
-        for (auto& [varName, def] : schemeDefs) {
-            std::string hname = key + "_" + varName;
-            hScheme[key][varName] = plotter.bookTH1(hname, def);
+    // ----- Models -----
+    // Evaluated in the event loop (not in cutflow-only mode); their files
+    // are part of the cache key
+    std::vector<BdtVariable> bdtVars;
+    uint64_t modelKey = 0;
+    if (!args.bdt.empty() && !args.cutflowOnly) {
+        auto schemeDefs = getSchemePlotDefs();
+        modelKey = hashString("bdt");
+        for (auto& [name, path] : args.bdt) {
+            BdtVariable var;
+            std::string error;
+            if (!makeBdtVariable(name, path, var, error)) {
+                std::cerr << "ERROR: " << error << std::endl;
+                return 1;
+            }
+            for (int k = 0; k < var.model->getNumOutputs(); ++k) {
+                bool taken = schemeDefs.count(var.plotName(k)) > 0;
+                for (auto& other : bdtVars) {
+                    for (int o = 0; o < other.model->getNumOutputs(); ++o) {
+                        taken = taken || other.plotName(o) == var.plotName(k);
+                    }
+                }
+                if (taken) {
+                    std::cerr << "ERROR: --bdt name '" << var.plotName(k) << "' is already a histogram"
+                              << std::endl;
+                    return 1;
+                }
+            }
+            std::cout << "BDT:     " << var.name << " = " << path << " (" << var.model->getNumTrees()
+                      << " trees, depth " << var.model->getMaxDepth() << ", "
+                      << var.model->getNumFeatures() << " features, " << var.model->getNumOutputs()
+                      << " output(s))" << std::endl;
+            modelKey = hashString(name, modelKey);
+            modelKey = hashValue(hashModelFile(path), modelKey);
+            bdtVars.push_back(std::move(var));
         }
-        // 2D: mgg vs mjj
-        std::string h2name = key + "_mgg_vs_mjj";
-        h2D_massPlane[key] = plotter.bookTH2(h2name, 40, 100, 180, 40, 0, 300,
-                                              "m_{#gamma#gamma} [GeV]", "m_{jj} [GeV]");
     }
 
-    // ----- Event loop -----
-    Long64_t nEntries = loader.getEntries();
-    std::cout << "\nProcessing " << nEntries << " events..." << std::endl;
-
+    // ----- Book histograms -----
+    // Cutflow-only mode books nothing and runs the same single pass
+    std::unique_ptr<Plotter> plotter;
+    HistogramSet histSet;
+    if (!args.cutflowOnly) {
+        plotter = std::make_unique<Plotter>(args.outputDir);
+        plotter->setRenderMode(args.render, args.renderJobs);
+        histSet.book(schemeKeys);
+        if (args.sparse) histSet.bookSparse(schemeKeys);
+        if (!args.unbinnedDir.empty()) histSet.bookUnbinned(schemeKeys);
+        if (!bdtVars.empty()) histSet.bookBdt(bdtVars, schemeKeys);
+    }
+    histSet.initCutflows(selector, schemeKeys);
+    auto& hCommon = histSet.common;
+    auto& hScheme = histSet.scheme;
+    auto& h2D_massPlane = histSet.massPlane;
+
+    // ----- Result cache -----
+    // Opt-in (--cache, --cache-dir): parts found in the cache are not
+    // recomputed; the event loop runs only for the missing schemes (and the
+    // common histograms if missing). Incremental runs keep their own per-file
+    // state instead.
     bool doBlind = !args.noBlind;
-
-    for (Long64_t i = 0; i < nEntries; ++i) {
-        loader.getEntry(i);
-
-        double w = evt.weight;
-
-        // Fill common histograms (no scheme requirement)
-        bool blindVeto = doBlind && (evt.mass >= BLIND_LOW && evt.mass <= BLIND_HIGH);
-
-        if (!blindVeto) hCommon["mass"]->Fill(evt.mass, w);
-        hCommon["pt"]->Fill(evt.pt, w);
-        hCommon["eta"]->Fill(evt.eta, w);
-        hCommon["phi"]->Fill(evt.phi, w);
-
-        hCommon["lead_pt"]->Fill(evt.lead_pt, w);
-        hCommon["lead_eta"]->Fill(evt.lead_eta, w);
-        hCommon["lead_mvaID"]->Fill(evt.lead_mvaID, w);
-        hCommon["lead_r9"]->Fill(evt.lead_r9, w);
-
-        hCommon["sublead_pt"]->Fill(evt.sublead_pt, w);
-        hCommon["sublead_eta"]->Fill(evt.sublead_eta, w);
-        hCommon["sublead_mvaID"]->Fill(evt.sublead_mvaID, w);
-        hCommon["sublead_r9"]->Fill(evt.sublead_r9, w);
-
-        hCommon["MultiBDT_output_0"]->Fill(evt.MultiBDT_output[0], w);
-        hCommon["MultiBDT_output_1"]->Fill(evt.MultiBDT_output[1], w);
-        hCommon["MultiBDT_output_2"]->Fill(evt.MultiBDT_output[2], w);
-        hCommon["MultiBDT_output_3"]->Fill(evt.MultiBDT_output[3], w);
-
-        hCommon["n_jets"]->Fill(evt.n_jets, w);
-        hCommon["nBLoose"]->Fill(evt.nBLoose, w);
-        hCommon["nBMedium"]->Fill(evt.nBMedium, w);
-        hCommon["nBTight"]->Fill(evt.nBTight, w);
-
-        hCommon["puppiMET_pt"]->Fill(evt.puppiMET_pt, w);
-        hCommon["puppiMET_phi"]->Fill(evt.puppiMET_phi, w);
-
-        hCommon["sigma_m_over_m"]->Fill(evt.sigma_m_over_m, w);
-
-        hCommon["alpha"]->Fill(evt.alpha, w);
-        hCommon["beta"]->Fill(evt.beta, w);
-        hCommon["gamma"]->Fill(evt.gamma, w);
-        hCommon["D_ttH"]->Fill(evt.D_ttH, w);
-        hCommon["D_qcd"]->Fill(evt.D_qcd, w);
-
-        // Per-scheme histograms
+    bool incremental = !args.stateDir.empty();
+    std::unique_ptr<ResultCache> cache;
+    bool commonDone = args.cutflowOnly; // nothing common to fill in cutflow-only mode
+    std::vector<std::string> missingSchemes = schemeKeys;
+    bool cacheHits = false;
+    if (!args.cacheDir.empty() && !incremental) {
+        cache = std::make_unique<ResultCache>(args.cacheDir, inputFiles, selector.getCuts(), doBlind,
+                                              modelKey);
+        if (!commonDone) commonDone = cacheHits = cache->loadCommon(histSet);
+        missingSchemes.clear();
         for (auto& key : schemeKeys) {
-            SchemeData& sd = schemeDatas[key];
-
-            if (!selector.passSchemeFlag(evt, key)) continue;
-            if (!selector.passPreselection(evt, sd, key)) continue;
-
-            auto& hs = hScheme[key];
-            hs["dijet_mass"]->Fill(sd.dijet_mass, w);
-            hs["dijet_mass_DNNreg"]->Fill(sd.dijet_mass_DNNreg, w);
-            hs["dijet_pt"]->Fill(sd.dijet_pt, w);
-
-            hs["lead_bjet_pt"]->Fill(sd.lead_bjet_pt, w);
-            hs["lead_bjet_eta"]->Fill(sd.lead_bjet_eta, w);
-            hs["lead_bjet_btagPNetB"]->Fill(sd.lead_bjet_btagPNetB, w);
-            hs["lead_bjet_btagUParTAK4B"]->Fill(sd.lead_bjet_btagUParTAK4B, w);
+            if (!cache->loadScheme(key, histSet)) missingSchemes.push_back(key);
+            else cacheHits = true;
+        }
+        std::cout << "Cache:   " << (schemeKeys.size() - missingSchemes.size()) << "/"
+                  << schemeKeys.size() << " scheme(s)";
+        if (!args.cutflowOnly) std::cout << ", common histograms " << (commonDone ? "hit" : "miss");
+        std::cout << " (" << cache->getDir() << ")" << std::endl;
+    }
 
-            hs["sublead_bjet_pt"]->Fill(sd.sublead_bjet_pt, w);
-            hs["sublead_bjet_eta"]->Fill(sd.sublead_bjet_eta, w);
-            hs["sublead_bjet_btagPNetB"]->Fill(sd.sublead_bjet_btagPNetB, w);
-            hs["sublead_bjet_btagUParTAK4B"]->Fill(sd.sublead_bjet_btagUParTAK4B, w);
+    // ----- Event loop -----
+    if (incremental || !missingSchemes.empty() || !commonDone) {
+        RunOptions runOpts;
+        runOpts.files      = inputFiles;
+        runOpts.schemeKeys = missingSchemes;
+        runOpts.doBlind    = doBlind;
+        runOpts.threads    = args.threads;
+        runOpts.fillHistograms = !args.cutflowOnly;
+        runOpts.fillCommon = !commonDone;
+        runOpts.inMemory   = args.inMemory;
+        runOpts.columnStore.memoryBudget = static_cast<std::size_t>(std::max(0L, args.memoryBudgetMB)) << 20;
+        runOpts.columnStore.spillDir     = args.spillDir;
+        runOpts.readCache.cacheBytes = static_cast<Long64_t>(args.readCacheMB) << 20;
+        runOpts.readCache.prefetch   = args.prefetch;
+        runOpts.modelKey   = modelKey;
+
+        RunReport report;
+        if (incremental) {
+            std::cout << std::endl;
+            report = runIncremental(args.stateDir, runOpts, selector, histSet);
+        } else {
+            std::cout << "\nProcessing " << inputFiles.size() << " file(s)";
+            if (args.threads > 1) std::cout << " on " << args.threads << " threads";
+            std::cout << "..." << std::endl;
+            report = runEventLoop(runOpts, selector, histSet);
+        }
 
-            hs["HHbbggCandidate_mass"]->Fill(sd.HHbbggCandidate_mass, w);
-            hs["HHbbggCandidate_pt"]->Fill(sd.HHbbggCandidate_pt, w);
+        std::cout << "Processed " << report.nEvents << " events from " << report.nFilesOk
+                  << " file(s), " << report.bytesRead / (1024.0 * 1024.0) << " MB unpacked";
+        if (incremental) std::cout << ", " << report.nFilesReused << " file(s) from the saved state";
+        std::cout << std::endl;
+        if (report.readCalls > 0) {
+            std::cout << "I/O: " << report.readCalls << " read calls, "
+                      << report.fileBytesRead / (1024.0 * 1024.0) << " MB from disk";
+            if (report.prefetchEfficiency >= 0) {
+                std::cout << ", TTreeCache prefetch efficiency " << 100 * report.prefetchEfficiency << "%";
+            } else {
+                std::cout << ", no TTreeCache";
+            }
+            std::cout << std::endl;
+        }
+        if (!report.failures.empty()) {
+            std::cerr << "WARNING: " << report.failures.size() << " file(s) failed and were skipped:"
+                      << std::endl;
+            for (auto& msg : report.failures) std::cerr << "  " << msg << std::endl;
+        }
+        if (report.nFilesOk + report.nFilesReused == 0) {
+            std::cerr << "ERROR: No input file could be processed" << std::endl;
+            return 1;
+        }
+        std::cout << "Event loop complete." << std::endl;
+
+        // Cached parts cover every input file: with a file missing from the
+        // fresh parts the two would not describe the same events
+        if (cacheHits && !report.failures.empty()) {
+            std::cerr << "ERROR: Cached results cover all input files but " << report.failures.size()
+                      << " file(s) failed in this run; not merging a partial result "
+                      << "(fix the input, or rerun without --cache)" << std::endl;
+            return 1;
+        }
+        // Only complete results go into the cache
+        if (cache && report.failures.empty()) {
+            if (!commonDone) cache->storeCommon(histSet);
+            for (auto& key : missingSchemes) cache->storeScheme(key, histSet);
+        } else if (cache) {
+            std::cerr << "WARNING: Results not cached because some files failed" << std::endl;
+        }
+    } else {
+        std::cout << "\nAll results loaded from cache, event loop skipped." << std::endl;
+    }
 
-            hs["CosThetaStar_CS"]->Fill(sd.CosThetaStar_CS, w);
-            hs["DeltaR_jg_min"]->Fill(sd.DeltaR_jg_min, w);
-            hs["M_X"]->Fill(sd.M_X, w);
-            hs["chi_t0"]->Fill(sd.chi_t0, w);
-            hs["chi_t1"]->Fill(sd.chi_t1, w);
-            hs["pholead_PtOverM"]->Fill(sd.pholead_PtOverM, w);
-            hs["phosublead_PtOverM"]->Fill(sd.phosublead_PtOverM, w);
+    // ----- Sparse store -----
+    // Queried afterwards with tools/sparse_query, no event loop needed
+    if (!histSet.sparse.empty()) {
+        ensureDirectory(args.outputDir);
+        std::string path = args.outputDir + "/sparse_store.hhsp";
+        if (saveSparseStores(path, histSet.sparse)) {
+            std::size_t cells = 0, bytes = 0;
+            for (auto& [key, store] : histSet.sparse) {
+                cells += store.getOccupiedCells();
+                bytes += store.getMemoryBytes();
+            }
+            std::cout << "Sparse store: " << cells << " occupied cells, " << bytes / (1024.0 * 1024.0)
+                      << " MB in memory, saved to " << path << std::endl;
+        }
+    }
 
-            // 2D mass plane (apply blinding on mgg axis)
-            if (!blindVeto) {
-                h2D_massPlane[key]->Fill(evt.mass, sd.dijet_mass, w);
+    // ----- Unbinned export -----
+    // One memory-mappable file per scheme, read back with UnbinnedFile
+    if (!histSet.unbinned.empty()) {
+        ensureDirectory(args.unbinnedDir);
+        for (auto& [key, events] : histSet.unbinned) {
+            std::string path = args.unbinnedDir + "/" + key + ".hhub";
+            if (writeUnbinnedFile(path, key, events)) {
+                std::cout << "Unbinned: " << events.size() << " events of " << key << " written to "
+                          << path << std::endl;
             }
         }
     }
-    std::cout << "Event loop complete." << std::endl;
+
+    // ----- Cutflow-only mode -----
+    if (args.cutflowOnly) {
+        for (auto& key : schemeKeys) selector.printCutflow(histSet.cutflows[key]);
+        return 0;
+    }
 
     // ----- Draw & save common histograms -----
     std::cout << "Drawing common histograms..." << std::endl;
     for (auto& [varName, h] : hCommon) {
         if (varName == "mass" && doBlind) {
-            plotter.draw1D(h, BLIND_LOW, BLIND_HIGH);
+            plotter->draw1D(h, BLIND_LOW, BLIND_HIGH);
         } else {
-            plotter.draw1D(h);
+            plotter->draw1D(h);
         }
     }
 
@@ -229,9 +482,9 @@ int main(int argc, char** argv) {
     for (auto& key : schemeKeys) {
         std::cout << "Drawing histograms for scheme: " << key << std::endl;
         for (auto& [varName, h] : hScheme[key]) {
-            plotter.draw1D(h);
+            plotter->draw1D(h);
         }
-        plotter.draw2DMassPlane(h2D_massPlane[key], doBlind);
+        plotter->draw2DMassPlane(h2D_massPlane[key], doBlind);
     }
 
     // ----- Cross-scheme comparison plots -----
@@ -246,12 +499,12 @@ int main(int argc, char** argv) {
             std::vector<std::string> labels;
             for (auto& key : schemeKeys) {
                 if (hScheme[key].count(varName)) {
-                    hists.push_back(hScheme[key][varName]);
+                    hists.push_back(plotter->toTH1(hScheme[key][varName]));
                     labels.push_back(allSchemes.at(key).name);
                 }
             }
             if (hists.size() > 1) {
-                plotter.drawCompare(hists, labels, true);
+                plotter->drawCompare(hists, labels, true);
             }
         }
     }
@@ -259,7 +512,26 @@ int main(int argc, char** argv) {
     // ----- Cutflow tables -----
     std::cout << "\n--- Cutflow Tables ---" << std::endl;
     for (auto& key : schemeKeys) {
-        selector.printCutflow(loader, key);
+        selector.printCutflow(histSet.cutflows[key]);
+        plotter->drawCutflow(histSet.cutflows[key]);
+    }
+
+    // ----- Deferred rendering -----
+    if (args.render != RenderMode::Serial) {
+        RenderReport render = plotter->finish();
+        if (args.render == RenderMode::None) {
+            if (render.rootFile.empty()) return 1;
+            std::cout << "\nWrote " << render.nWritten << " histograms to " << render.rootFile
+                      << " (no plots rendered)" << std::endl;
+            return 0;
+        }
+        std::cout << "\nRendered " << render.nRendered << " plot(s)";
+        if (args.render == RenderMode::Lazy) std::cout << ", " << render.nUnchanged << " unchanged";
+        std::cout << std::endl;
+        if (render.nFailedWorkers > 0) {
+            std::cerr << "ERROR: A render worker failed; some plots may be missing" << std::endl;
+            return 1;
+        }
     }
 
     std::cout << "\nDone! Plots saved to " << args.outputDir << "/" << std::endl;
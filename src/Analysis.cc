@@ -0,0 +1,580 @@
+#include "Analysis.h"
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <cstddef>
+#include <TROOT.h>
+#include <TEnv.h>
+
+// ---------------------------------------------------------------------------
+// HistogramSet
+// ---------------------------------------------------------------------------
+void HistogramSet::book(const std::vector<std::string>& schemeKeys) {
+    // Common histograms
+    for (auto& [varName, def] : getPlotDefs()) {
+        common[varName] = FastHist1D(varName, Plotter::axisTitle(def), def.nbins, def.xmin, def.xmax);
+    }
+
+    // Per-scheme histograms
+    auto schemeDefs = getSchemePlotDefs();
+    for (auto& key : schemeKeys) {
+        for (auto& [varName, def] : schemeDefs) {
+            std::string hname = key + "_" + varName;
+            scheme[key][varName] = FastHist1D(hname, Plotter::axisTitle(def),
+                                              def.nbins, def.xmin, def.xmax);
+        }
+        // 2D: mgg vs mjj
+        std::string h2name = key + "_mgg_vs_mjj";
+        massPlane[key] = FastHist2D(h2name, ";m_{#gamma#gamma} [GeV];m_{jj} [GeV]",
+                                    40, 100, 180, 40, 0, 300);
+    }
+}
+
+void HistogramSet::bookSparse(const std::vector<std::string>& schemeKeys) {
+    std::vector<SparseAxis> axes;
+    for (auto& def : getSparseAxisDefs()) axes.push_back({def.name, def.nbins, def.xmin, def.xmax});
+    for (auto& key : schemeKeys) sparse[key] = SparseHist(key, axes);
+}
+
+void HistogramSet::bookUnbinned(const std::vector<std::string>& schemeKeys) {
+    for (auto& key : schemeKeys) unbinned[key] = UnbinnedEvents();
+}
+
+void HistogramSet::bookBdt(const std::vector<BdtVariable>& vars,
+                           const std::vector<std::string>& schemeKeys) {
+    bdt = vars;
+    for (auto& key : schemeKeys) {
+        for (auto& var : vars) {
+            for (int k = 0; k < var.model->getNumOutputs(); ++k) {
+                PlotDef def = var.plotDef(k);
+                std::string varName = var.plotName(k);
+                scheme[key][varName] = FastHist1D(key + "_" + varName, Plotter::axisTitle(def),
+                                                  def.nbins, def.xmin, def.xmax);
+            }
+        }
+    }
+}
+
+void HistogramSet::initCutflows(const EventSelector& selector,
+                                const std::vector<std::string>& schemeKeys) {
+    for (auto& key : schemeKeys) cutflows[key] = selector.makeCutflow(key);
+}
+
+std::unique_ptr<HistogramSet> HistogramSet::cloneEmpty() const {
+    auto copy = std::make_unique<HistogramSet>();
+    for (auto& [varName, h] : common) copy->common[varName] = h.cloneEmpty();
+    for (auto& [key, hs] : scheme) {
+        for (auto& [varName, h] : hs) copy->scheme[key][varName] = h.cloneEmpty();
+    }
+    for (auto& [key, h] : massPlane) copy->massPlane[key] = h.cloneEmpty();
+    for (auto& [key, h] : sparse) copy->sparse[key] = h.cloneEmpty();
+    for (auto& [key, u] : unbinned) copy->unbinned[key] = UnbinnedEvents();
+    copy->bdt = bdt;
+    for (auto& [key, cf] : cutflows) {
+        copy->cutflows[key] = cf;
+        copy->cutflows[key].reset();
+    }
+    return copy;
+}
+
+void HistogramSet::add(const HistogramSet& other) {
+    for (auto& [varName, h] : common) h.add(other.common.at(varName));
+    for (auto& [key, hs] : scheme) {
+        const auto& ohs = other.scheme.at(key);
+        for (auto& [varName, h] : hs) h.add(ohs.at(varName));
+    }
+    for (auto& [key, h] : massPlane) h.add(other.massPlane.at(key));
+    for (auto& [key, h] : sparse) h.add(other.sparse.at(key));
+    for (auto& [key, u] : unbinned) u.append(other.unbinned.at(key));
+    for (auto& [key, cf] : cutflows) cf.add(other.cutflows.at(key));
+}
+
+// ---------------------------------------------------------------------------
+// AnalysisWorker
+// ---------------------------------------------------------------------------
+// Events per model evaluation: enough to amortise the walk over the trees,
+// small enough that the buffered rows stay in L1/L2
+static constexpr std::size_t kBdtBatch = 256;
+
+AnalysisWorker::AnalysisWorker(const std::string& filename,
+                               const std::vector<std::string>& schemeKeys,
+                               const EventSelector& selector, bool doBlind,
+                               const ReadCacheOptions& readCache)
+    : AnalysisWorker(std::make_unique<DataLoader>(filename), schemeKeys, selector, doBlind,
+                     readCache) {}
+
+AnalysisWorker::AnalysisWorker(std::unique_ptr<DataLoader> loader,
+                               const std::vector<std::string>& schemeKeys,
+                               const EventSelector& selector, bool doBlind,
+                               const ReadCacheOptions& readCache)
+    : loader_(std::move(loader)), selector_(selector), doBlind_(doBlind) {
+    // Slots are created before binding: the vector must not reallocate
+    slots_.resize(schemeKeys.size());
+    for (size_t s = 0; s < schemeKeys.size(); ++s) {
+        int idx = schemeIndex(schemeKeys[s]);
+        if (idx < 0) {
+            std::cerr << "ERROR: Unknown scheme '" << schemeKeys[s] << "'" << std::endl;
+            continue;
+        }
+        slots_[s].id  = static_cast<SchemeId>(idx);
+        slots_[s].key = schemeKeys[s];
+    }
+    slots_.erase(std::remove_if(slots_.begin(), slots_.end(),
+                                [](const SchemeSlot& slot) { return slot.key.empty(); }),
+                 slots_.end());
+
+    if (!loader_->isOpen()) return;
+    loader_->setupBranches(evt_);
+
+    // One SchemeData per scheme, all connected to the same TTree
+    for (auto& slot : slots_) loader_->setupSchemeBranches(slot.sd, slot.key);
+    loader_->setupReadCache(readCache);
+}
+
+bool AnalysisWorker::cacheColumns(Long64_t begin, Long64_t end, const ColumnStoreOptions& opts) {
+    store_ = std::make_unique<ColumnStore>(opts);
+    if (!store_->load(*loader_, begin, end)) {
+        store_.reset();
+        return false;
+    }
+    return true;
+}
+
+AnalysisWorker::ValueSource AnalysisWorker::source(const FieldRef& field,
+                                                   const void* structBase) const {
+    ValueSource v;
+    v.base = static_cast<const char*>(structBase);
+    v.field = field;
+    return v;
+}
+
+void AnalysisWorker::resolveTargets(HistogramSet& hists, bool fillHistograms, bool fillCommon) {
+    commonFills_.clear();
+    schemeNeedsEvent_ = false;
+    mass_ = source(FieldRef::of<double>(FieldRef::Event, offsetof(EventData, mass)), &evt_);
+    for (int k = 0; k < 4; ++k) {
+        bdtScores_[k] = source(FieldRef::of<float>(FieldRef::Event,
+                                                   offsetof(EventData, MultiBDT_output) +
+                                                       k * sizeof(float)),
+                               &evt_);
+    }
+    for (auto& slot : slots_) {
+        slot.cutflow = &hists.cutflows.at(slot.key);
+        slot.fills.clear();
+        slot.massPlane = nullptr;
+        slot.mjj = source(FieldRef::of<double>(FieldRef::Scheme, offsetof(SchemeData, dijet_mass)),
+                          &slot.sd);
+        slot.sparse = nullptr;
+        slot.sparseAxes.clear();
+        slot.unbinned = nullptr;
+        slot.bdt.clear();
+    }
+    if (!fillHistograms) return;
+
+    // Every PlotDef with a field becomes one slot, in PlotDef order
+    for (auto& [varName, def] : getPlotDefs()) {
+        if (!fillCommon || def.field.source != FieldRef::Event) continue;
+        commonFills_.push_back({&hists.common.at(varName), source(def.field, &evt_), def.blinded});
+    }
+    auto schemeDefs = getSchemePlotDefs();
+    for (auto& slot : slots_) {
+        auto& hs = hists.scheme.at(slot.key);
+        for (auto& [varName, def] : schemeDefs) {
+            if (def.field.source != FieldRef::Scheme) continue;
+            slot.fills.push_back({&hs.at(varName), source(def.field, &slot.sd), def.blinded});
+        }
+        slot.massPlane = &hists.massPlane.at(slot.key);
+
+        auto ub = hists.unbinned.find(slot.key);
+        if (ub != hists.unbinned.end()) {
+            slot.unbinned = &ub->second;
+            schemeNeedsEvent_ = true; // bdtCategory reads MultiBDT_output
+        }
+
+        for (auto& var : hists.bdt) {
+            BdtSlot b;
+            b.var = &var;
+            for (auto& f : var.features) {
+                b.features.push_back(source(f, f.source == FieldRef::Scheme
+                                                   ? static_cast<const void*>(&slot.sd)
+                                                   : static_cast<const void*>(&evt_)));
+                if (f.source == FieldRef::Event && !inSelectionGroup(f)) schemeNeedsEvent_ = true;
+            }
+            for (int k = 0; k < var.model->getNumOutputs(); ++k) b.hists.push_back(&hs.at(var.plotName(k)));
+            slot.bdt.push_back(std::move(b));
+        }
+
+        auto sp = hists.sparse.find(slot.key);
+        if (sp == hists.sparse.end()) continue;
+        slot.sparse = &sp->second;
+        for (auto& def : getSparseAxisDefs()) {
+            const void* base = def.field.source == FieldRef::Scheme ? static_cast<const void*>(&slot.sd)
+                                                                    : static_cast<const void*>(&evt_);
+            slot.sparseAxes.push_back(source(def.field, base));
+        }
+        slot.sparseX.resize(slot.sparseAxes.size());
+    }
+    // Selection-group fields are always read; anything else of EventData
+    // (the MultiBDT scores) needs the event group too
+    if (hists.sparse.empty()) return;
+    for (auto& def : getSparseAxisDefs()) {
+        if (def.field.source == FieldRef::Event && !inSelectionGroup(def.field)) schemeNeedsEvent_ = true;
+    }
+}
+
+bool AnalysisWorker::inSelectionGroup(const FieldRef& field) const {
+    const char* address = reinterpret_cast<const char*>(&evt_) + field.offset;
+    for (auto& b : loader_->getSelectionBindings()) {
+        if (static_cast<const char*>(b.address) == address) return true;
+    }
+    return false;
+}
+
+void AnalysisWorker::bindColumn(ValueSource& v) const {
+    const ColumnStore::Column* c = store_->find(v.base + v.field.offset);
+    // Fields without a branch keep reading the (never filled) struct member
+    if (!c) return;
+    v.base = c->data;
+    v.field.offset = 0;
+    v.stride = c->elemSize;
+}
+
+void AnalysisWorker::bindColumns() {
+    bindColumn(mass_);
+    for (auto& v : bdtScores_) bindColumn(v);
+    for (auto& f : commonFills_) bindColumn(f.value);
+    for (auto& slot : slots_) {
+        for (auto& f : slot.fills) bindColumn(f.value);
+        bindColumn(slot.mjj);
+        for (auto& v : slot.sparseAxes) bindColumn(v);
+        for (auto& b : slot.bdt) {
+            for (auto& v : b.features) bindColumn(v);
+        }
+    }
+}
+
+inline void AnalysisWorker::fill(std::vector<FillSlot>& fills, Long64_t row, double w,
+                                 bool blindVeto) {
+    for (auto& f : fills) {
+        if (f.blinded && blindVeto) continue;
+        f.hist->fill(f.value.read(row), w);
+    }
+}
+
+void AnalysisWorker::flushBdt(BdtSlot& b) {
+    const std::size_t n = b.weights.size();
+    if (n == 0) return;
+    const std::size_t nOut = b.hists.size();
+    b.out.resize(n * nOut);
+    b.var->model->predict(b.rows.data(), n, b.out.data());
+    for (std::size_t j = 0; j < n; ++j) {
+        for (std::size_t k = 0; k < nOut; ++k) b.hists[k]->fill(b.out[j * nOut + k], b.weights[j]);
+    }
+    b.rows.clear();
+    b.weights.clear();
+}
+
+inline void AnalysisWorker::fillScheme(SchemeSlot& slot, Long64_t row, double w, bool blindVeto) {
+    fill(slot.fills, row, w, blindVeto);
+    // 2D mass plane, sparse store, unbinned export and model outputs:
+    // blinded on mgg
+    if (blindVeto) return;
+    double mgg = mass_.read(row);
+    slot.massPlane->fill(mgg, slot.mjj.read(row), w);
+    if (slot.unbinned) {
+        float scores[4];
+        for (int k = 0; k < 4; ++k) scores[k] = static_cast<float>(bdtScores_[k].read(row));
+        slot.unbinned->push(mgg, slot.mjj.read(row), w, bdtCategory(scores));
+    }
+    if (slot.sparse) {
+        for (size_t a = 0; a < slot.sparseAxes.size(); ++a) slot.sparseX[a] = slot.sparseAxes[a].read(row);
+        slot.sparse->fill(slot.sparseX.data(), w);
+    }
+    // Model inputs wait for a full batch
+    for (auto& b : slot.bdt) {
+        for (auto& f : b.features) b.rows.push_back(static_cast<float>(f.read(row)));
+        b.weights.push_back(w);
+        if (b.weights.size() == kBdtBatch) flushBdt(b);
+    }
+}
+
+bool AnalysisWorker::process(Long64_t begin, Long64_t end, HistogramSet& hists,
+                             bool fillHistograms, bool fillCommon) {
+    const EventData& evt = evt_;
+    resolveTargets(hists, fillHistograms, fillCommon);
+    fillCommon = fillCommon && fillHistograms;
+
+    bool done = store_ && store_->contains(begin) && end <= store_->getEnd() &&
+                processColumns(begin, end, fillHistograms, fillCommon);
+    if (!done) {
+        for (Long64_t i = begin; i < end && !loader_->hasReadError(); ++i) {
+            // Stage 1: only what the event-level cuts need
+            loader_->getSelectionEntry(i);
+
+            double w = evt.weight;
+            bool blindVeto = doBlind_ && (evt.mass >= BLIND_LOW && evt.mass <= BLIND_HIGH);
+
+            bool eventLoaded = false;
+            if (fillCommon) {
+                loader_->getEventEntry(i);
+                eventLoaded = true;
+                fill(commonFills_, 0, w, blindVeto);
+            }
+
+            // Stage 2: scheme branches only for events passing the common cuts
+            for (auto& slot : slots_) {
+                if (!selector_.fillCutflowCommon(*slot.cutflow, evt, slot.id, w)) continue;
+
+                loader_->getSchemeEntry(i, slot.id);
+                if (!selector_.fillCutflowScheme(*slot.cutflow, slot.sd, w)) continue;
+                if (!fillHistograms) continue;
+
+                if (schemeNeedsEvent_ && !blindVeto && !eventLoaded) {
+                    loader_->getEventEntry(i);
+                    eventLoaded = true;
+                }
+                fillScheme(slot, 0, w, blindVeto);
+            }
+        }
+    }
+    if (loader_->hasReadError()) return false;
+    for (auto& slot : slots_) {
+        for (auto& b : slot.bdt) flushBdt(b);
+    }
+    return true;
+}
+
+bool AnalysisWorker::processColumns(Long64_t begin, Long64_t end, bool fillHistograms,
+                                    bool fillCommon) {
+    ColumnStore& store = *store_;
+    const std::size_t n = static_cast<std::size_t>(end - begin);
+    const Long64_t first = begin - store.getBegin(); // row of entry begin
+
+    SelectionColumns cols;
+    cols.n = n;
+    const double* weight = store.column(&evt_.weight);
+    cols.mass          = store.column(&evt_.mass);
+    cols.lead_pt       = store.column(&evt_.lead_pt);
+    cols.sublead_pt    = store.column(&evt_.sublead_pt);
+    cols.lead_mvaID    = store.column(&evt_.lead_mvaID);
+    cols.sublead_mvaID = store.column(&evt_.sublead_mvaID);
+    if (!weight || !cols.mass || !cols.lead_pt || !cols.sublead_pt || !cols.lead_mvaID ||
+        !cols.sublead_mvaID) return false;
+    for (auto& slot : slots_) {
+        if (!store.column(&(evt_.*kSchemeFlags[static_cast<int>(slot.id)])) ||
+            !store.column(&slot.sd.dijet_mass) || !store.column(&slot.sd.lead_bjet_pt) ||
+            !store.column(&slot.sd.sublead_bjet_pt)) return false;
+    }
+    weight += first;
+    cols.mass += first;
+    cols.lead_pt += first;
+    cols.sublead_pt += first;
+    cols.lead_mvaID += first;
+    cols.sublead_mvaID += first;
+    bindColumns();
+
+    auto blinded = [&](std::size_t i) {
+        return doBlind_ && (cols.mass[i] >= BLIND_LOW && cols.mass[i] <= BLIND_HIGH);
+    };
+
+    if (fillCommon) {
+        store.loadEventRows(*loader_, begin, end, nullptr);
+        for (std::size_t i = 0; i < n; ++i) fill(commonFills_, first + i, weight[i], blinded(i));
+    }
+
+    // Per scheme: event-level cuts on the selection columns, the scheme
+    // group only for the events passing them, then the scheme cuts
+    std::vector<uint64_t> mask((n + 63) / 64);
+    for (auto& slot : slots_) {
+        cols.schemeFlag = store.column(&(evt_.*kSchemeFlags[static_cast<int>(slot.id)])) + first;
+        cols.dijet_mass = cols.lead_bjet_pt = cols.sublead_bjet_pt = nullptr;
+        selector_.fillCutflowCommonBatch(*slot.cutflow, cols, weight, mask.data());
+
+        store.loadSchemeRows(*loader_, slot.id, begin, end, mask.data());
+        cols.dijet_mass      = store.column(&slot.sd.dijet_mass) + first;
+        cols.lead_bjet_pt    = store.column(&slot.sd.lead_bjet_pt) + first;
+        cols.sublead_bjet_pt = store.column(&slot.sd.sublead_bjet_pt) + first;
+        selector_.fillCutflowSchemeBatch(*slot.cutflow, cols, weight, mask.data());
+        if (!fillHistograms) continue;
+
+        if (schemeNeedsEvent_ && !fillCommon) store.loadEventRows(*loader_, begin, end, mask.data());
+        for (std::size_t wd = 0; wd < mask.size(); ++wd) {
+            for (uint64_t bits = mask[wd]; bits; bits &= bits - 1) {
+                std::size_t i = wd * 64 + __builtin_ctzll(bits);
+                fillScheme(slot, first + i, weight[i], blinded(i));
+            }
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Event loop driver
+// ---------------------------------------------------------------------------
+// Files opened here to split them are kept in opened[fileIndex] and handed to
+// the first worker that reads them, so no input is opened twice
+static std::vector<WorkUnit> planWorkUnits(const RunOptions& opts,
+                                           std::vector<std::string>& failures,
+                                           std::vector<std::unique_ptr<DataLoader>>& opened) {
+    std::vector<WorkUnit> units;
+    size_t nFiles = opts.files.size();
+    opened.clear();
+    opened.resize(nFiles);
+
+    // Enough files to keep every thread busy: one unit per file, no need to
+    // open anything up front
+    if (opts.threads <= 1 || nFiles >= static_cast<size_t>(opts.threads)) {
+        for (size_t f = 0; f < nFiles; ++f) units.push_back({f, 0, -1});
+        return units;
+    }
+
+    // Fewer files than threads: split each file on cluster boundaries
+    int chunksPerFile = (opts.threads + static_cast<int>(nFiles) - 1) / static_cast<int>(nFiles);
+    for (size_t f = 0; f < nFiles; ++f) {
+        auto loader = std::make_unique<DataLoader>(opts.files[f]);
+        if (!loader->isOpen()) {
+            failures.push_back(loader->getError());
+            continue;
+        }
+        for (auto& [b, e] : loader->splitEntryRange(chunksPerFile)) units.push_back({f, b, e});
+        opened[f] = std::move(loader);
+    }
+    return units;
+}
+
+RunReport runEventLoop(const RunOptions& opts, const EventSelector& selector,
+                       HistogramSet& hists,
+                       std::vector<std::unique_ptr<HistogramSet>>* perFile) {
+    RunReport report;
+    // Both must be set before the first file is opened
+    if (opts.threads > 1) ROOT::EnableThreadSafety();
+    if (opts.readCache.prefetch && opts.readCache.cacheBytes != 0) {
+        gEnv->SetValue("TFile.AsyncPrefetching", 1);
+    }
+    std::vector<std::unique_ptr<DataLoader>> opened;
+    std::vector<WorkUnit> units = planWorkUnits(opts, report.failures, opened);
+    int nThreads = std::max(1, std::min<int>(opts.threads, static_cast<int>(units.size())));
+
+    std::vector<std::unique_ptr<HistogramSet>> partials(units.size());
+    std::vector<Long64_t> unitEvents(units.size(), 0);
+    std::vector<Long64_t> unitBytes(units.size(), 0);
+    std::vector<char> fileFailed(opts.files.size(), 0);
+    std::atomic<size_t> nextUnit{0};
+    std::mutex mtx; // guards report, fileFailed, progress output
+    size_t nDone = 0;
+
+    // Each thread holds at most one unit in memory at a time
+    ColumnStoreOptions storeOpts = opts.columnStore;
+    storeOpts.memoryBudget /= static_cast<std::size_t>(nThreads);
+
+    // One empty partial set per unit, allocated before the threads start
+    for (auto& p : partials) p = hists.cloneEmpty();
+
+    // I/O counters of a worker, added when it closes its file
+    double weightedEfficiency = 0;
+    Long64_t cachedBytes = 0;
+    auto retire = [&](std::unique_ptr<AnalysisWorker>& worker) {
+        if (!worker) return;
+        ReadStats stats = worker->getLoader().getReadStats();
+        std::lock_guard<std::mutex> lock(mtx);
+        report.readCalls += stats.readCalls;
+        report.fileBytesRead += stats.fileBytes;
+        if (stats.prefetchEfficiency >= 0) {
+            weightedEfficiency += stats.prefetchEfficiency * stats.fileBytes;
+            cachedBytes += stats.fileBytes;
+        }
+        worker.reset();
+    };
+
+    auto runThread = [&]() {
+        std::unique_ptr<AnalysisWorker> worker;
+        for (size_t u = nextUnit++; u < units.size(); u = nextUnit++) {
+            const WorkUnit& unit = units[u];
+            const std::string& file = opts.files[unit.fileIndex];
+
+            // Reuse the open file when consecutive units come from the same input
+            if (!worker || worker->getLoader().getFileName() != file) {
+                retire(worker);
+                std::unique_ptr<DataLoader> loader;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    loader = std::move(opened[unit.fileIndex]);
+                }
+                if (loader) {
+                    worker = std::make_unique<AnalysisWorker>(std::move(loader), opts.schemeKeys,
+                                                              selector, opts.doBlind, opts.readCache);
+                } else {
+                    worker = std::make_unique<AnalysisWorker>(file, opts.schemeKeys, selector,
+                                                              opts.doBlind, opts.readCache);
+                }
+            }
+
+            Long64_t end = unit.end;
+            bool ok = worker->isOpen();
+            if (ok) {
+                if (end < 0) end = worker->getLoader().getEntries();
+                worker->getLoader().setCacheRange(unit.begin, end);
+                Long64_t bytesBefore = worker->getLoader().getBytesRead();
+                if (opts.inMemory && !worker->cacheColumns(unit.begin, end, storeOpts)) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    std::cerr << "WARNING: Column cache failed for " << file
+                              << ", reading from ROOT" << std::endl;
+                }
+                ok = worker->process(unit.begin, end, *partials[u], opts.fillHistograms,
+                                     opts.fillCommon);
+                unitEvents[u] = end - unit.begin;
+                unitBytes[u] = worker->getLoader().getBytesRead() - bytesBefore;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            ++nDone;
+            if (!ok) {
+                if (!fileFailed[unit.fileIndex]) {
+                    fileFailed[unit.fileIndex] = 1;
+                    report.failures.push_back(worker->getLoader().getError());
+                }
+                std::cerr << "  [" << nDone << "/" << units.size() << "] FAILED "
+                          << worker->getLoader().getError() << std::endl;
+            } else {
+                std::cout << "  [" << nDone << "/" << units.size() << "] " << file
+                          << " entries [" << unit.begin << ", " << end << ")" << std::endl;
+            }
+        }
+        retire(worker);
+    };
+
+    if (nThreads == 1) {
+        runThread();
+    } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; ++t) threads.emplace_back(runThread);
+        for (auto& t : threads) t.join();
+    }
+
+    report.fileEntries.assign(opts.files.size(), 0);
+    if (perFile) {
+        perFile->clear();
+        for (size_t f = 0; f < opts.files.size(); ++f) perFile->push_back(hists.cloneEmpty());
+    }
+    for (size_t u = 0; u < units.size(); ++u) {
+        // A file with a failed unit contributes nothing, like one that
+        // cannot be opened
+        if (fileFailed[units[u].fileIndex]) continue;
+        hists.add(*partials[u]);
+        if (perFile) (*perFile)[units[u].fileIndex]->add(*partials[u]);
+        report.nEvents += unitEvents[u];
+        report.bytesRead += unitBytes[u];
+        report.fileEntries[units[u].fileIndex] += unitEvents[u];
+    }
+    if (cachedBytes > 0) report.prefetchEfficiency = weightedEfficiency / cachedBytes;
+    report.fileOk.assign(opts.files.size(), 0);
+    for (size_t f = 0; f < opts.files.size(); ++f) {
+        bool planned = std::any_of(units.begin(), units.end(),
+                                   [&](const WorkUnit& w) { return w.fileIndex == f; });
+        report.fileOk[f] = planned && !fileFailed[f];
+        if (report.fileOk[f]) report.nFilesOk++;
+    }
+    return report;
+}
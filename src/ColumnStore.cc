@@ -0,0 +1,154 @@
+#include "ColumnStore.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Column arrays are cache-line aligned so batch code can use aligned loads
+static constexpr std::size_t kColumnAlign = 64;
+
+ColumnStore::ColumnStore(const Options& opts) : opts_(opts) {}
+
+ColumnStore::~ColumnStore() {
+    release();
+}
+
+void ColumnStore::release() {
+    for (auto& c : columns_) {
+        if (!c.data) continue;
+        if (c.spilled) munmap(c.data, c.bytes);
+        else std::free(c.data);
+    }
+    columns_.clear();
+    byName_.clear();
+    byTarget_.clear();
+    selection_ = Group{};
+    event_ = Group{};
+    for (auto& g : schemes_) g = Group{};
+    memoryBytes_ = spilledBytes_ = 0;
+    nRows_ = 0;
+}
+
+char* ColumnStore::allocate(std::size_t& bytes, bool& spilled) {
+    // Round up to whole cache lines (and never zero, for empty ranges)
+    bytes = std::max<std::size_t>(1, (bytes + kColumnAlign - 1) / kColumnAlign) * kColumnAlign;
+
+    // Zero-filled (a new spill file reads as zeros): the batch kernels run
+    // over whole blocks, including rows a group never loaded
+    if (memoryBytes_ + bytes <= opts_.memoryBudget) {
+        void* p = std::aligned_alloc(kColumnAlign, bytes);
+        if (p) {
+            std::memset(p, 0, bytes);
+            spilled = false;
+            memoryBytes_ += bytes;
+            return static_cast<char*>(p);
+        }
+    }
+
+    // Over budget: back the column with an anonymous file in spillDir. The
+    // file is unlinked right away, so it disappears with the mapping.
+    std::string path = opts_.spillDir + "/columnstore_XXXXXX";
+    std::vector<char> tmpl(path.begin(), path.end());
+    tmpl.push_back('\0');
+    int fd = mkstemp(tmpl.data());
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot create spill file in " << opts_.spillDir << std::endl;
+        return nullptr;
+    }
+    unlink(tmpl.data());
+    void* p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "ERROR: Cannot map spill file of " << bytes << " bytes" << std::endl;
+        return nullptr;
+    }
+    spilled = true;
+    spilledBytes_ += bytes;
+    return static_cast<char*>(p);
+}
+
+bool ColumnStore::addGroup(const std::vector<BranchBinding>& bindings, Group& group) {
+    for (auto& b : bindings) {
+        Column c;
+        c.name     = b.name;
+        c.type     = b.type;
+        c.elemSize = b.size;
+        c.target   = b.address;
+        c.bytes    = b.size * static_cast<std::size_t>(nRows_);
+        c.data     = allocate(c.bytes, c.spilled);
+        if (!c.data) return false;
+
+        byName_[c.name] = columns_.size();
+        byTarget_[c.target] = columns_.size();
+        group.columns.push_back(columns_.size());
+        columns_.push_back(c);
+    }
+    group.loaded.assign((static_cast<std::size_t>(nRows_) + 63) / 64, 0);
+    return true;
+}
+
+// One staged read per wanted entry, scattered from the bound struct into
+// the columns of the group
+template <typename Read>
+void ColumnStore::loadRows(Group& group, Long64_t begin, Long64_t end, const uint64_t* rows,
+                           Read read) {
+    if (group.columns.empty()) return;
+    for (Long64_t i = 0; i < end - begin; ++i) {
+        if (rows && !((rows[i / 64] >> (i % 64)) & 1)) continue;
+        Long64_t row = begin - begin_ + i;
+        uint64_t& word = group.loaded[row / 64];
+        uint64_t bit = uint64_t(1) << (row % 64);
+        if (word & bit) continue;
+        read(begin + i);
+        for (size_t idx : group.columns) {
+            Column& c = columns_[idx];
+            std::memcpy(c.data + row * c.elemSize, c.target, c.elemSize);
+        }
+        word |= bit;
+    }
+}
+
+bool ColumnStore::load(DataLoader& loader, Long64_t begin, Long64_t end) {
+    release();
+    if (!loader.isOpen()) return false;
+
+    begin_ = begin;
+    nRows_ = std::max<Long64_t>(0, end - begin);
+
+    bool ok = addGroup(loader.getSelectionBindings(), selection_) &&
+              addGroup(loader.getEventBindings(), event_);
+    const auto& schemeBindings = loader.getSchemeBindings();
+    for (size_t s = 0; s < schemeBindings.size(); ++s) {
+        ok = ok && addGroup(schemeBindings[s], schemes_[s]);
+    }
+    if (!ok) {
+        release();
+        return false;
+    }
+
+    loadRows(selection_, begin_, getEnd(), nullptr,
+             [&](Long64_t entry) { loader.getSelectionEntry(entry); });
+    return true;
+}
+
+void ColumnStore::loadEventRows(DataLoader& loader, Long64_t begin, Long64_t end,
+                                const uint64_t* rows) {
+    loadRows(event_, begin, end, rows, [&](Long64_t entry) { loader.getEventEntry(entry); });
+}
+
+void ColumnStore::loadSchemeRows(DataLoader& loader, SchemeId id, Long64_t begin, Long64_t end,
+                                 const uint64_t* rows) {
+    loadRows(schemes_[static_cast<int>(id)], begin, end, rows,
+             [&](Long64_t entry) { loader.getSchemeEntry(entry, id); });
+}
+
+const ColumnStore::Column* ColumnStore::find(const void* target) const {
+    auto it = byTarget_.find(target);
+    return it == byTarget_.end() ? nullptr : &columns_[it->second];
+}
@@ -1,4 +1,15 @@
 #include "Config.h"
+#include "EventData.h"
+#include <iterator>
+#include <iostream>
+#include <cstdlib>
+#include <cstddef>
+#include <type_traits>
+
+// Field accessors for PlotDef: EVT(mass) reads EventData::mass, SD(M_X)
+// reads the SchemeData of the scheme being filled
+#define EVT(f) FieldRef::of<std::decay_t<decltype(EventData::f)>>(FieldRef::Event, offsetof(EventData, f))
+#define SD(f)  FieldRef::of<std::decay_t<decltype(SchemeData::f)>>(FieldRef::Scheme, offsetof(SchemeData, f))
 
 const std::map<std::string, JetPairingScheme>& getSchemes() {
     static const std::map<std::string, JetPairingScheme> schemes = {
@@ -9,75 +20,113 @@ const std::map<std::string, JetPairingScheme>& getSchemes() {
         {"Res",                 {"Resonant",                         "Res_",                 "is_Res",                 true,  false}},
         {"Res_DNNpair",         {"Resonant (DNN pair)",              "Res_DNNpair_",         "is_Res_DNNpair",         true,  false}},
     };
+    // Every SchemeId needs its entry, and nothing else: the event loop
+    // indexes per-scheme arrays by SchemeId
+    static const bool consistent = [] {
+        bool ok = schemes.size() == static_cast<size_t>(N_SCHEMES);
+        for (int i = 0; i < N_SCHEMES && ok; ++i) {
+            auto it = schemes.find(kSchemeKeys[i]);
+            ok = it != schemes.end() && it->second.categoryFlag == std::string("is_") + kSchemeKeys[i];
+        }
+        return ok;
+    }();
+    if (!consistent) {
+        std::cerr << "ERROR: getSchemes() does not match HH_SCHEMES in Config.h" << std::endl;
+        std::abort();
+    }
     return schemes;
 }
 
+int schemeIndex(const std::string& key) {
+    for (int i = 0; i < N_SCHEMES; ++i) {
+        if (key == kSchemeKeys[i]) return i;
+    }
+    return -1;
+}
+
+const std::string& schemeKeyOf(SchemeId id) {
+    static const std::vector<std::string> keys(std::begin(kSchemeKeys), std::end(kSchemeKeys));
+    return keys.at(static_cast<size_t>(id));
+}
+
 std::map<std::string, PlotDef> getPlotDefs() {
     return {
         // Diphoton
-        {"mass",                {80, 100, 180, "m_{#gamma#gamma}",          "GeV"}},
-        {"pt",                  {60, 0,   600, "p_{T}^{#gamma#gamma}",     "GeV"}},
-        {"eta",                 {50, -5,  5,   "#eta^{#gamma#gamma}",      ""}},
-        {"phi",                 {50, -3.15, 3.15, "#phi^{#gamma#gamma}",   ""}},
+        {"mass",                {80, 100, 180, "m_{#gamma#gamma}",          "GeV", EVT(mass), true}},
+        {"pt",                  {60, 0,   600, "p_{T}^{#gamma#gamma}",     "GeV", EVT(pt)}},
+        {"eta",                 {50, -5,  5,   "#eta^{#gamma#gamma}",      "", EVT(eta)}},
+        {"phi",                 {50, -3.15, 3.15, "#phi^{#gamma#gamma}",   "", EVT(phi)}},
         // Photons
-        {"lead_pt",             {60, 0,   300, "Lead #gamma p_{T}",        "GeV"}},
-        {"lead_eta",            {50, -3,  3,   "Lead #gamma #eta",         ""}},
-        {"lead_mvaID",          {50, -1,  1,   "Lead #gamma MVA ID",       ""}},
-        {"lead_r9",             {50, 0,   1.2, "Lead #gamma R9",           ""}},
-        {"sublead_pt",          {60, 0,   200, "Sublead #gamma p_{T}",     "GeV"}},
-        {"sublead_eta",         {50, -3,  3,   "Sublead #gamma #eta",      ""}},
-        {"sublead_mvaID",       {50, -1,  1,   "Sublead #gamma MVA ID",    ""}},
-        {"sublead_r9",          {50, 0,   1.2, "Sublead #gamma R9",        ""}},
+        {"lead_pt",             {60, 0,   300, "Lead #gamma p_{T}",        "GeV", EVT(lead_pt)}},
+        {"lead_eta",            {50, -3,  3,   "Lead #gamma #eta",         "", EVT(lead_eta)}},
+        {"lead_mvaID",          {50, -1,  1,   "Lead #gamma MVA ID",       "", EVT(lead_mvaID)}},
+        {"lead_r9",             {50, 0,   1.2, "Lead #gamma R9",           "", EVT(lead_r9)}},
+        {"sublead_pt",          {60, 0,   200, "Sublead #gamma p_{T}",     "GeV", EVT(sublead_pt)}},
+        {"sublead_eta",         {50, -3,  3,   "Sublead #gamma #eta",      "", EVT(sublead_eta)}},
+        {"sublead_mvaID",       {50, -1,  1,   "Sublead #gamma MVA ID",    "", EVT(sublead_mvaID)}},
+        {"sublead_r9",          {50, 0,   1.2, "Sublead #gamma R9",        "", EVT(sublead_r9)}},
         // BDT outputs
-        {"MultiBDT_output_0",   {50, 0, 1, "MultiBDT score 0", ""}},
-        {"MultiBDT_output_1",   {50, 0, 1, "MultiBDT score 1", ""}},
-        {"MultiBDT_output_2",   {50, 0, 1, "MultiBDT score 2", ""}},
-        {"MultiBDT_output_3",   {50, 0, 1, "MultiBDT score 3", ""}},
+        {"MultiBDT_output_0",   {50, 0, 1, "MultiBDT score 0", "", EVT(MultiBDT_output[0])}},
+        {"MultiBDT_output_1",   {50, 0, 1, "MultiBDT score 1", "", EVT(MultiBDT_output[1])}},
+        {"MultiBDT_output_2",   {50, 0, 1, "MultiBDT score 2", "", EVT(MultiBDT_output[2])}},
+        {"MultiBDT_output_3",   {50, 0, 1, "MultiBDT score 3", "", EVT(MultiBDT_output[3])}},
         // Multiplicities
-        {"n_jets",              {15, 0, 15, "N_{jets}",         ""}},
-        {"nBLoose",             {8,  0, 8,  "N_{b-jets} (Loose)", ""}},
-        {"nBMedium",            {8,  0, 8,  "N_{b-jets} (Medium)",""}},
-        {"nBTight",             {8,  0, 8,  "N_{b-jets} (Tight)", ""}},
+        {"n_jets",              {15, 0, 15, "N_{jets}",         "", EVT(n_jets)}},
+        {"nBLoose",             {8,  0, 8,  "N_{b-jets} (Loose)", "", EVT(nBLoose)}},
+        {"nBMedium",            {8,  0, 8,  "N_{b-jets} (Medium)","", EVT(nBMedium)}},
+        {"nBTight",             {8,  0, 8,  "N_{b-jets} (Tight)", "", EVT(nBTight)}},
         // MET
-        {"puppiMET_pt",         {50, 0, 200, "Puppi MET",        "GeV"}},
-        {"puppiMET_phi",        {50, -3.15, 3.15, "Puppi MET #phi", ""}},
+        {"puppiMET_pt",         {50, 0, 200, "Puppi MET",        "GeV", EVT(puppiMET_pt)}},
+        {"puppiMET_phi",        {50, -3.15, 3.15, "Puppi MET #phi", "", EVT(puppiMET_phi)}},
         // Sigma m
-        {"sigma_m_over_m",      {50, 0, 0.05, "#sigma_{m}/m",   ""}},
+        {"sigma_m_over_m",      {50, 0, 0.05, "#sigma_{m}/m",   "", EVT(sigma_m_over_m)}},
         // Discriminants
-        {"alpha",               {50, 0, 1,  "#alpha", ""}},
-        {"beta",                {50, 0, 1,  "#beta",  ""}},
-        {"gamma",               {50, 0, 1,  "#gamma", ""}},
-        {"D_ttH",               {50, 0, 1,  "D_{t#bar{t}H}", ""}},
-        {"D_qcd",               {50, 0, 1,  "D_{QCD}",       ""}},
+        {"alpha",               {50, 0, 1,  "#alpha", "", EVT(alpha)}},
+        {"beta",                {50, 0, 1,  "#beta",  "", EVT(beta)}},
+        {"gamma",               {50, 0, 1,  "#gamma", "", EVT(gamma)}},
+        {"D_ttH",               {50, 0, 1,  "D_{t#bar{t}H}", "", EVT(D_ttH)}},
+        {"D_qcd",               {50, 0, 1,  "D_{QCD}",       "", EVT(D_qcd)}},
     };
 }
 
 std::map<std::string, PlotDef> getSchemePlotDefs() {
     return {
         // Dijet
-        {"dijet_mass",                  {60, 0, 300, "m_{jj}",                           "GeV"}},
-        {"dijet_mass_DNNreg",           {60, 0, 300, "m_{jj} (DNN reg)",                 "GeV"}},
-        {"dijet_pt",                    {60, 0, 400, "p_{T}^{jj}",                       "GeV"}},
+        {"dijet_mass",                  {60, 0, 300, "m_{jj}",                           "GeV", SD(dijet_mass)}},
+        {"dijet_mass_DNNreg",           {60, 0, 300, "m_{jj} (DNN reg)",                 "GeV", SD(dijet_mass_DNNreg)}},
+        {"dijet_pt",                    {60, 0, 400, "p_{T}^{jj}",                       "GeV", SD(dijet_pt)}},
         // Lead b-jet
-        {"lead_bjet_pt",               {60, 0, 300, "Lead b-jet p_{T}",                  "GeV"}},
-        {"lead_bjet_eta",              {50, -3, 3,  "Lead b-jet #eta",                   ""}},
-        {"lead_bjet_btagPNetB",        {50, 0, 1,   "Lead b-jet PNet B score",           ""}},
-        {"lead_bjet_btagUParTAK4B",    {50, 0, 1,   "Lead b-jet UParT AK4 B score",     ""}},
+        {"lead_bjet_pt",               {60, 0, 300, "Lead b-jet p_{T}",                  "GeV", SD(lead_bjet_pt)}},
+        {"lead_bjet_eta",              {50, -3, 3,  "Lead b-jet #eta",                   "", SD(lead_bjet_eta)}},
+        {"lead_bjet_btagPNetB",        {50, 0, 1,   "Lead b-jet PNet B score",           "", SD(lead_bjet_btagPNetB)}},
+        {"lead_bjet_btagUParTAK4B",    {50, 0, 1,   "Lead b-jet UParT AK4 B score",     "", SD(lead_bjet_btagUParTAK4B)}},
         // Sublead b-jet
-        {"sublead_bjet_pt",            {60, 0, 200, "Sublead b-jet p_{T}",               "GeV"}},
-        {"sublead_bjet_eta",           {50, -3, 3,  "Sublead b-jet #eta",                ""}},
-        {"sublead_bjet_btagPNetB",     {50, 0, 1,   "Sublead b-jet PNet B score",        ""}},
-        {"sublead_bjet_btagUParTAK4B", {50, 0, 1,   "Sublead b-jet UParT AK4 B score",  ""}},
+        {"sublead_bjet_pt",            {60, 0, 200, "Sublead b-jet p_{T}",               "GeV", SD(sublead_bjet_pt)}},
+        {"sublead_bjet_eta",           {50, -3, 3,  "Sublead b-jet #eta",                "", SD(sublead_bjet_eta)}},
+        {"sublead_bjet_btagPNetB",     {50, 0, 1,   "Sublead b-jet PNet B score",        "", SD(sublead_bjet_btagPNetB)}},
+        {"sublead_bjet_btagUParTAK4B", {50, 0, 1,   "Sublead b-jet UParT AK4 B score",  "", SD(sublead_bjet_btagUParTAK4B)}},
         // HH candidate
-        {"HHbbggCandidate_mass",       {60, 200, 1400, "m_{bb#gamma#gamma}",             "GeV"}},
-        {"HHbbggCandidate_pt",         {60, 0, 500,    "p_{T}^{bb#gamma#gamma}",         "GeV"}},
+        {"HHbbggCandidate_mass",       {60, 200, 1400, "m_{bb#gamma#gamma}",             "GeV", SD(HHbbggCandidate_mass)}},
+        {"HHbbggCandidate_pt",         {60, 0, 500,    "p_{T}^{bb#gamma#gamma}",         "GeV", SD(HHbbggCandidate_pt)}},
         // Angular / kinematic
-        {"CosThetaStar_CS",            {50, -1, 1,   "cos#theta*_{CS}",                  ""}},
-        {"DeltaR_jg_min",              {50, 0, 6,    "#DeltaR_{jg}^{min}",               ""}},
-        {"M_X",                        {60, 200, 1400, "M_{X}",                          "GeV"}},
-        {"chi_t0",                     {50, 0, 50,   "#chi_{t0}",                        ""}},
-        {"chi_t1",                     {50, 0, 50,   "#chi_{t1}",                        ""}},
-        {"pholead_PtOverM",            {50, 0, 3,    "Lead #gamma p_{T}/m_{#gamma#gamma}",""}},
-        {"phosublead_PtOverM",         {50, 0, 2,    "Sublead #gamma p_{T}/m_{#gamma#gamma}",""}},
+        {"CosThetaStar_CS",            {50, -1, 1,   "cos#theta*_{CS}",                  "", SD(CosThetaStar_CS)}},
+        {"DeltaR_jg_min",              {50, 0, 6,    "#DeltaR_{jg}^{min}",               "", SD(DeltaR_jg_min)}},
+        {"M_X",                        {60, 200, 1400, "M_{X}",                          "GeV", SD(M_X)}},
+        {"chi_t0",                     {50, 0, 50,   "#chi_{t0}",                        "", SD(chi_t0)}},
+        {"chi_t1",                     {50, 0, 50,   "#chi_{t1}",                        "", SD(chi_t1)}},
+        {"pholead_PtOverM",            {50, 0, 3,    "Lead #gamma p_{T}/m_{#gamma#gamma}","", SD(pholead_PtOverM)}},
+        {"phosublead_PtOverM",         {50, 0, 2,    "Sublead #gamma p_{T}/m_{#gamma#gamma}","", SD(phosublead_PtOverM)}},
+    };
+}
+
+std::vector<SparseAxisDef> getSparseAxisDefs() {
+    // Finer than the plots: range cuts on a projection act on whole bins
+    return {
+        {"mass",                 160, 100,  180,  EVT(mass)},
+        {"dijet_mass",           120, 0,    300,  SD(dijet_mass)},
+        {"MultiBDT_output_0",    100, 0,    1,    EVT(MultiBDT_output[0])},
+        {"HHbbggCandidate_mass", 120, 200,  1400, SD(HHbbggCandidate_mass)},
+        {"M_X",                  120, 200,  1400, SD(M_X)},
+        {"weight",               80,  -1,   3,    EVT(weight)},
     };
 }
@@ -0,0 +1,319 @@
+#include "CsvConverter.h"
+#include "DataLoader.h"
+#include <TFile.h>
+#include <TTree.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+static inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Field [b, e) without surrounding blanks and quotes
+static inline void trimField(const char*& b, const char*& e) {
+    while (b < e && isBlank(*b)) ++b;
+    while (e > b && isBlank(e[-1])) --e;
+    if (e - b >= 2 && *b == '"' && e[-1] == '"') {
+        ++b;
+        --e;
+    }
+}
+
+static inline bool isBlankLine(const char* b, const char* e) {
+    for (; b < e; ++b) {
+        if (!isBlank(*b)) return false;
+    }
+    return true;
+}
+
+// Value of one field; false (and 0) if it is not a number
+static inline bool parseField(const char* b, const char* e, double& v) {
+    trimField(b, e);
+    v = 0;
+    if (b == e) return true;
+    if (*b == '+') ++b;
+    auto r = std::from_chars(b, e, v);
+    if (r.ec == std::errc() && r.ptr == e) return true;
+    std::size_t n = static_cast<std::size_t>(e - b);
+    if ((n == 4 && (std::memcmp(b, "True", 4) == 0 || std::memcmp(b, "true", 4) == 0))) {
+        v = 1;
+        return true;
+    }
+    if ((n == 5 && (std::memcmp(b, "False", 5) == 0 || std::memcmp(b, "false", 5) == 0))) {
+        v = 0;
+        return true;
+    }
+    v = 0;
+    return false;
+}
+
+std::vector<std::string> parseCsvHeader(const char* begin, const char* end, char delimiter) {
+    std::vector<std::string> names;
+    const char* p = begin;
+    for (;;) {
+        const char* q = static_cast<const char*>(std::memchr(p, delimiter, end - p));
+        const char* b = p;
+        const char* e = q ? q : end;
+        trimField(b, e);
+        names.emplace_back(b, e);
+        if (!q) break;
+        p = q + 1;
+    }
+    return names;
+}
+
+void parseCsvBlock(const char* begin, const char* end, std::size_t nColumns, char delimiter,
+                   CsvColumnChunk& chunk) {
+    // Count the rows first so every column is one contiguous array
+    std::size_t nRows = 0;
+    for (const char* p = begin; p < end;) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* le = nl ? nl : end;
+        if (!isBlankLine(p, le)) ++nRows;
+        p = le + 1;
+    }
+    chunk.nRows = nRows;
+    chunk.values.assign(nColumns * nRows, 0.0);
+    chunk.parseErrors = 0;
+
+    double* values = chunk.values.data();
+    std::size_t r = 0;
+    for (const char* p = begin; p < end;) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* le = nl ? nl : end;
+        if (!isBlankLine(p, le)) {
+            const char* f = p;
+            for (std::size_t c = 0; c < nColumns; ++c) {
+                const char* q = static_cast<const char*>(std::memchr(f, delimiter, le - f));
+                const char* fe = q ? q : le;
+                if (!parseField(f, fe, values[c * nRows + r])) ++chunk.parseErrors;
+                if (!q) break;
+                f = q + 1;
+            }
+            ++r;
+        }
+        p = le + 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Conversion
+// ---------------------------------------------------------------------------
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_ = static_cast<std::size_t>(st.st_size);
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const char*>(p);
+                madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+using CsvBlocks = std::vector<std::pair<const char*, const char*>>;
+
+// Header names and the body cut into blocks of whole lines
+static CsvBlocks splitCsv(const MappedFile& csv, const CsvConvertOptions& opts,
+                          std::vector<std::string>& names) {
+    const char* end = csv.data() + csv.size();
+    const char* nl = static_cast<const char*>(std::memchr(csv.data(), '\n', csv.size()));
+    const char* body = nl ? nl + 1 : end;
+    names = parseCsvHeader(csv.data(), nl ? nl : end, opts.delimiter);
+
+    CsvBlocks blocks;
+    std::size_t blockBytes = std::max<std::size_t>(opts.blockBytes, 1);
+    for (const char* p = body; p < end;) {
+        const char* stop = p + std::min<std::size_t>(blockBytes, end - p);
+        if (stop < end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(stop, '\n', end - stop));
+            stop = lineEnd ? lineEnd + 1 : end;
+        }
+        blocks.emplace_back(p, stop);
+        p = stop;
+    }
+    return blocks;
+}
+
+static int parseThreadCount(const CsvConvertOptions& opts) {
+    return opts.threads > 0 ? opts.threads
+                            : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+bool inferCsvSchema(const CsvConvertOptions& opts, std::vector<std::string>& names,
+                    ColumnTypes& types) {
+    MappedFile csv(opts.input);
+    if (!csv.data()) {
+        std::cerr << "ERROR: Cannot map input file " << opts.input << " (missing or empty)" << std::endl;
+        return false;
+    }
+    CsvBlocks blocks = splitCsv(csv, opts, names);
+    const std::size_t nColumns = names.size();
+
+    // Every thread keeps its own statistics; they are merged at the end
+    int nThreads = parseThreadCount(opts);
+    std::vector<std::vector<ColumnStats>> stats(nThreads, std::vector<ColumnStats>(nColumns));
+    std::atomic<std::size_t> nextBlock{0};
+    auto scanThread = [&](int t) {
+        CsvColumnChunk chunk;
+        for (std::size_t b; (b = nextBlock++) < blocks.size();) {
+            parseCsvBlock(blocks[b].first, blocks[b].second, nColumns, opts.delimiter, chunk);
+            for (std::size_t c = 0; c < nColumns; ++c) {
+                const double* v = chunk.values.data() + c * chunk.nRows;
+                for (std::size_t r = 0; r < chunk.nRows; ++r) stats[t][c].add(v[r]);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) threads.emplace_back(scanThread, t);
+    for (auto& th : threads) th.join();
+
+    types.clear();
+    for (std::size_t c = 0; c < nColumns; ++c) {
+        for (int t = 1; t < nThreads; ++t) stats[0][c].merge(stats[t][c]);
+        types[names[c]] = stats[0][c].narrowestType();
+    }
+    return true;
+}
+
+CsvConvertReport convertCsvToRoot(const CsvConvertOptions& opts) {
+    CsvConvertReport report;
+    auto t0 = std::chrono::steady_clock::now();
+
+    MappedFile csv(opts.input);
+    if (!csv.data()) {
+        report.error = "Cannot map input file " + opts.input + " (missing or empty)";
+        return report;
+    }
+    report.inputBytes = csv.size();
+
+    std::vector<std::string> names;
+    CsvBlocks blocks = splitCsv(csv, opts, names);
+    std::size_t nColumns = names.size();
+    report.columns = static_cast<int>(nColumns);
+
+    std::unique_ptr<TFile> out(TFile::Open(opts.output.c_str(), "RECREATE"));
+    if (!out || out->IsZombie()) {
+        report.error = "Cannot create ROOT file " + opts.output;
+        return report;
+    }
+    applyFileLayout(out.get(), opts.layout);
+    out->cd();
+    TTree* tree = new TTree(opts.treeName.c_str(), opts.treeName.c_str()); // owned by out
+    // One 8-byte word per column holds the value in its schema type
+    std::vector<uint64_t> row(nColumns, 0);
+    std::vector<char> type(nColumns, 'D');
+    for (std::size_t c = 0; c < nColumns; ++c) {
+        auto it = opts.schema.find(names[c]);
+        if (it != opts.schema.end()) type[c] = it->second;
+    }
+    for (std::size_t c : hotFirstOrder(names, opts.layout.hotBranches)) {
+        tree->Branch(names[c].c_str(), &row[c], (names[c] + "/" + type[c]).c_str());
+    }
+    applyTreeLayout(tree, opts.layout);
+
+    // Workers parse up to maxAhead blocks past the one being filled
+    int nThreads = parseThreadCount(opts);
+    std::size_t maxAhead = 2 * static_cast<std::size_t>(nThreads);
+    std::vector<std::unique_ptr<CsvColumnChunk>> chunks(blocks.size());
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::size_t nextBlock = 0, nFilled = 0;
+
+    auto parseThread = [&]() {
+        for (;;) {
+            std::size_t b;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return nextBlock >= blocks.size() || nextBlock < nFilled + maxAhead; });
+                if (nextBlock >= blocks.size()) return;
+                b = nextBlock++;
+            }
+            auto chunk = std::make_unique<CsvColumnChunk>();
+            parseCsvBlock(blocks[b].first, blocks[b].second, nColumns, opts.delimiter, *chunk);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                chunks[b] = std::move(chunk);
+            }
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) threads.emplace_back(parseThread);
+
+    // Fill in block order
+    std::size_t reportEvery = std::max<std::size_t>(1, blocks.size() / 10);
+    for (std::size_t b = 0; b < blocks.size(); ++b) {
+        std::unique_ptr<CsvColumnChunk> chunk;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return chunks[b] != nullptr; });
+            chunk = std::move(chunks[b]);
+        }
+        const std::size_t nRows = chunk->nRows;
+        const double* values = chunk->values.data();
+        for (std::size_t r = 0; r < nRows; ++r) {
+            for (std::size_t c = 0; c < nColumns; ++c) {
+                const double v = values[c * nRows + r];
+                if (type[c] == 'D') {
+                    std::memcpy(&row[c], &v, sizeof(double));
+                } else if (!convertLeafValue(&v, 'D', &row[c], type[c])) {
+                    ++report.inexact;
+                }
+            }
+            tree->Fill();
+        }
+        report.rows += static_cast<long long>(nRows);
+        report.parseErrors += chunk->parseErrors;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            nFilled = b + 1;
+        }
+        cv.notify_all();
+        if ((b + 1) % reportEvery == 0 && b + 1 < blocks.size()) {
+            std::cout << "  " << report.rows << " entries ("
+                      << 100 * (blocks[b].second - csv.data()) / csv.size() << "%)" << std::endl;
+        }
+    }
+    for (auto& t : threads) t.join();
+
+    out->cd();
+    tree->Write();
+    out->Close();
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    report.ok = true;
+    return report;
+}
@@ -1,19 +1,44 @@
 #include "DataLoader.h"
+#include "ParquetReader.h"
 #include "Config.h"
 #include "Utils.h"
+#include <TLeaf.h>
+#include <TObjArray.h>
+#include <TTreeCache.h>
+#include <TTreeCacheUnzip.h>
 #include <iostream>
-#include <cstdlib>
+#include <algorithm>
+#include <cstring>
 
-DataLoader::DataLoader(const std::string& filename, const std::string& treeName) {
+bool isParquetPath(const std::string& path) {
+    for (const std::string ext : {".parquet", ".pq"}) {
+        if (path.size() >= ext.size() &&
+            path.compare(path.size() - ext.size(), ext.size(), ext) == 0) return true;
+    }
+    return false;
+}
+
+DataLoader::DataLoader(const std::string& filename, const std::string& treeName)
+    : filename_(filename) {
+    if (isParquetPath(filename)) {
+        auto reader = std::make_unique<ParquetReader>(filename);
+        if (!reader->isOpen()) {
+            error_ = reader->getError();
+            return;
+        }
+        parquet_ = std::move(reader);
+        return;
+    }
     file_.reset(TFile::Open(filename.c_str(), "READ"));
     if (!file_ || file_->IsZombie()) {
-        std::cerr << "ERROR: Cannot open file " << filename << std::endl;
-        std::exit(1);
+        error_ = "Cannot open file " + filename;
+        file_.reset();
+        return;
     }
     tree_ = dynamic_cast<TTree*>(file_->Get(treeName.c_str()));
     if (!tree_) {
-        std::cerr << "ERROR: Cannot find TTree '" << treeName << "' in " << filename << std::endl;
-        std::exit(1);
+        error_ = "Cannot find TTree '" + treeName + "' in " + filename;
+        return;
     }
     // Disable all branches by default, enable only what we need
     tree_->SetBranchStatus("*", 0);
@@ -21,75 +46,175 @@ DataLoader::DataLoader(const std::string& filename, const std::string& treeName)
 
 DataLoader::~DataLoader() = default;
 
+// ---------------------------------------------------------------------------
+// Leaf types
+// ---------------------------------------------------------------------------
+char branchTypeCode(TBranch* branch) {
+    if (!branch) return 0;
+    TLeaf* leaf = branch->GetLeaf(branch->GetName());
+    if (!leaf || leaf->GetLen() != 1) return 0;
+    for (char type : {'D', 'F', 'L', 'l', 'I', 'i', 'S', 's', 'B', 'b', 'O'}) {
+        if (std::strcmp(leaf->GetTypeName(), leafTypeName(type)) == 0) return type;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// DataLoader
+// ---------------------------------------------------------------------------
+template <typename T>
+void DataLoader::bind(const std::string& name, T* addr, std::vector<BranchBinding>& group) {
+    if (parquet_) {
+        // Projection: only bound columns are ever decoded
+        int column = parquet_->findColumn(name);
+        if (column < 0) {
+            std::cerr << "WARNING: No column " << name << " in " << filename_ << std::endl;
+            return;
+        }
+        BranchBinding b{name, nullptr, addr, sizeof(T), leafTypeCode<T>()};
+        b.column = column;
+        b.storedType = parquet_->getColumnType(column);
+        if (b.storedType != b.type) {
+            // Staged like a ROOT branch, so the file's value stays available
+            // (a skim copies it); nulls need a type that holds SENTINEL
+            staging_.push_back(0);
+            b.source = &staging_.back();
+            b.sourceType = leafTypeHolds(b.storedType, SENTINEL) ? b.storedType : 'D';
+        }
+        group.push_back(b);
+        return;
+    }
+    tree_->SetBranchStatus(name.c_str(), 1);
+    TBranch* br = tree_->GetBranch(name.c_str());
+    if (!br) {
+        tree_->SetBranchAddress(name.c_str(), addr); // let ROOT report it
+        return;
+    }
+    BranchBinding b{name, br, addr, sizeof(T), leafTypeCode<T>()};
+    char stored = branchTypeCode(br);
+    b.storedType = stored != 0 ? stored : b.type;
+    if (stored != 0 && stored != b.type) {
+        // Stored as another type: read into a staging word, convert on read
+        staging_.push_back(0);
+        b.source = &staging_.back();
+        b.sourceType = stored;
+        tree_->SetBranchAddress(name.c_str(), b.source);
+    } else {
+        tree_->SetBranchAddress(name.c_str(), addr);
+    }
+    group.push_back(b);
+}
+
 void DataLoader::setupBranches(EventData& evt) {
-    auto on = [&](const char* name) { tree_->SetBranchStatus(name, 1); };
+    if (!isOpen()) return;
+    selection_.clear();
+    event_.clear();
 
     // Event IDs
-    on("run");   tree_->SetBranchAddress("run",   &evt.run);
-    on("event"); tree_->SetBranchAddress("event", &evt.event);
-    on("lumi");  tree_->SetBranchAddress("lumi",  &evt.lumi);
+    bind("run",                  &evt.run,                  event_);
+    bind("event",                &evt.event,                event_);
+    bind("lumi",                 &evt.lumi,                 event_);
 
     // Weights
-    on("weight");        tree_->SetBranchAddress("weight",        &evt.weight);
-    on("eventWeight");   tree_->SetBranchAddress("eventWeight",   &evt.eventWeight);
-    on("weight_central"); tree_->SetBranchAddress("weight_central", &evt.weight_central);
+    bind("weight",               &evt.weight,               selection_);
+    bind("eventWeight",          &evt.eventWeight,          event_);
+    bind("weight_central",       &evt.weight_central,       event_);
 
     // Diphoton kinematics
-    on("mass"); tree_->SetBranchAddress("mass", &evt.mass);
-    on("pt");   tree_->SetBranchAddress("pt",   &evt.pt);
-    on("eta");  tree_->SetBranchAddress("eta",  &evt.eta);
-    on("phi");  tree_->SetBranchAddress("phi",  &evt.phi);
+    bind("mass",                 &evt.mass,                 selection_);
+    bind("pt",                   &evt.pt,                   event_);
+    bind("eta",                  &evt.eta,                  event_);
+    bind("phi",                  &evt.phi,                  event_);
 
     // Lead photon
-    on("lead_pt");     tree_->SetBranchAddress("lead_pt",     &evt.lead_pt);
-    on("lead_eta");    tree_->SetBranchAddress("lead_eta",    &evt.lead_eta);
-    on("lead_phi");    tree_->SetBranchAddress("lead_phi",    &evt.lead_phi);
-    on("lead_mvaID");  tree_->SetBranchAddress("lead_mvaID",  &evt.lead_mvaID);
-    on("lead_r9");     tree_->SetBranchAddress("lead_r9",     &evt.lead_r9);
+    bind("lead_pt",              &evt.lead_pt,              selection_);
+    bind("lead_eta",             &evt.lead_eta,             event_);
+    bind("lead_phi",             &evt.lead_phi,             event_);
+    bind("lead_mvaID",           &evt.lead_mvaID,           selection_);
+    bind("lead_r9",              &evt.lead_r9,              event_);
 
     // Sublead photon
-    on("sublead_pt");    tree_->SetBranchAddress("sublead_pt",    &evt.sublead_pt);
-    on("sublead_eta");   tree_->SetBranchAddress("sublead_eta",   &evt.sublead_eta);
-    on("sublead_phi");   tree_->SetBranchAddress("sublead_phi",   &evt.sublead_phi);
-    on("sublead_mvaID"); tree_->SetBranchAddress("sublead_mvaID", &evt.sublead_mvaID);
-    on("sublead_r9");    tree_->SetBranchAddress("sublead_r9",    &evt.sublead_r9);
-
-    // Category flags
-    on("is_nonRes");              tree_->SetBranchAddress("is_nonRes",              &evt.is_nonRes);
-    on("is_nonResReg");           tree_->SetBranchAddress("is_nonResReg",           &evt.is_nonResReg);
-    on("is_nonResReg_DNNpair");   tree_->SetBranchAddress("is_nonResReg_DNNpair",   &evt.is_nonResReg_DNNpair);
-    on("is_nonResReg_vbfpair");   tree_->SetBranchAddress("is_nonResReg_vbfpair",   &evt.is_nonResReg_vbfpair);
-    on("is_Res");                 tree_->SetBranchAddress("is_Res",                 &evt.is_Res);
-    on("is_Res_DNNpair");         tree_->SetBranchAddress("is_Res_DNNpair",         &evt.is_Res_DNNpair);
+    bind("sublead_pt",           &evt.sublead_pt,           selection_);
+    bind("sublead_eta",          &evt.sublead_eta,          event_);
+    bind("sublead_phi",          &evt.sublead_phi,          event_);
+    bind("sublead_mvaID",        &evt.sublead_mvaID,        selection_);
+    bind("sublead_r9",           &evt.sublead_r9,           event_);
+
+    // Category flags, in SchemeId order
+    for (int s = 0; s < N_SCHEMES; ++s) {
+        bind(getSchemes().at(kSchemeKeys[s]).categoryFlag, &(evt.*kSchemeFlags[s]), selection_);
+    }
 
     // Multiplicities
-    on("n_jets");   tree_->SetBranchAddress("n_jets",   &evt.n_jets);
-    on("nBLoose");  tree_->SetBranchAddress("nBLoose",  &evt.nBLoose);
-    on("nBMedium"); tree_->SetBranchAddress("nBMedium", &evt.nBMedium);
-    on("nBTight");  tree_->SetBranchAddress("nBTight",  &evt.nBTight);
+    bind("n_jets",               &evt.n_jets,               event_);
+    bind("nBLoose",              &evt.nBLoose,              event_);
+    bind("nBMedium",             &evt.nBMedium,             event_);
+    bind("nBTight",              &evt.nBTight,              event_);
 
     // BDT outputs (Float)
-    on("MultiBDT_output_0"); tree_->SetBranchAddress("MultiBDT_output_0", &evt.MultiBDT_output[0]);
-    on("MultiBDT_output_1"); tree_->SetBranchAddress("MultiBDT_output_1", &evt.MultiBDT_output[1]);
-    on("MultiBDT_output_2"); tree_->SetBranchAddress("MultiBDT_output_2", &evt.MultiBDT_output[2]);
-    on("MultiBDT_output_3"); tree_->SetBranchAddress("MultiBDT_output_3", &evt.MultiBDT_output[3]);
+    bind("MultiBDT_output_0",    &evt.MultiBDT_output[0],   event_);
+    bind("MultiBDT_output_1",    &evt.MultiBDT_output[1],   event_);
+    bind("MultiBDT_output_2",    &evt.MultiBDT_output[2],   event_);
+    bind("MultiBDT_output_3",    &evt.MultiBDT_output[3],   event_);
 
     // Discriminants (Float)
-    on("alpha");  tree_->SetBranchAddress("alpha",  &evt.alpha);
-    on("beta");   tree_->SetBranchAddress("beta",   &evt.beta);
-    on("gamma");  tree_->SetBranchAddress("gamma",  &evt.gamma);
-    on("D_ttH");  tree_->SetBranchAddress("D_ttH",  &evt.D_ttH);
-    on("D_qcd");  tree_->SetBranchAddress("D_qcd",  &evt.D_qcd);
+    bind("alpha",                &evt.alpha,                event_);
+    bind("beta",                 &evt.beta,                 event_);
+    bind("gamma",                &evt.gamma,                event_);
+    bind("D_ttH",                &evt.D_ttH,                event_);
+    bind("D_qcd",                &evt.D_qcd,                event_);
 
     // MET
-    on("puppiMET_pt");  tree_->SetBranchAddress("puppiMET_pt",  &evt.puppiMET_pt);
-    on("puppiMET_phi"); tree_->SetBranchAddress("puppiMET_phi", &evt.puppiMET_phi);
+    bind("puppiMET_pt",          &evt.puppiMET_pt,          event_);
+    bind("puppiMET_phi",         &evt.puppiMET_phi,         event_);
 
     // Sigma m
-    on("sigma_m_over_m"); tree_->SetBranchAddress("sigma_m_over_m", &evt.sigma_m_over_m);
+    bind("sigma_m_over_m",       &evt.sigma_m_over_m,       event_);
+}
+
+void DataLoader::setupEventIdBranches(EventData& evt) {
+    if (!isOpen()) return;
+    selection_.clear();
+    event_.clear();
+    bind("run",   &evt.run,   event_);
+    bind("lumi",  &evt.lumi,  event_);
+    bind("event", &evt.event, event_);
+}
+
+void DataLoader::setupAllBranches(const std::function<bool(const std::string&)>& wanted) {
+    if (!isOpen()) return;
+    selection_.clear();
+    event_.clear();
+    for (auto& group : schemes_) group.clear();
+    if (parquet_) {
+        for (int c = 0; c < parquet_->getColumnCount(); ++c) {
+            if (wanted && !wanted(parquet_->getColumnName(c))) continue;
+            char type = parquet_->getColumnType(c);
+            staging_.push_back(0);
+            BranchBinding b{parquet_->getColumnName(c), nullptr, &staging_.back(), leafTypeSize(type), type};
+            b.column = c;
+            b.storedType = type;
+            event_.push_back(b);
+        }
+        return;
+    }
+    TObjArray* list = tree_->GetListOfBranches();
+    for (int i = 0; i < list->GetEntriesFast(); ++i) {
+        auto* br = static_cast<TBranch*>(list->UncheckedAt(i));
+        if (wanted && !wanted(br->GetName())) continue;
+        char type = branchTypeCode(br);
+        if (type == 0) continue; // arrays, objects
+        staging_.push_back(0);
+        tree_->SetBranchStatus(br->GetName(), 1);
+        tree_->SetBranchAddress(br->GetName(), static_cast<void*>(&staging_.back()));
+        BranchBinding b{br->GetName(), br, &staging_.back(), leafTypeSize(type), type};
+        b.storedType = type;
+        event_.push_back(b);
+    }
 }
 
 void DataLoader::setupSchemeBranches(SchemeData& sd, const std::string& schemeKey) {
+    if (!isOpen()) return;
     const auto& schemes = getSchemes();
     auto it = schemes.find(schemeKey);
     if (it == schemes.end()) {
@@ -98,10 +223,10 @@ void DataLoader::setupSchemeBranches(SchemeData& sd, const std::string& schemeKe
     }
     const std::string& p = it->second.prefix;
 
-    auto setup = [&](const std::string& suffix, double* addr) {
-        std::string bname = schemeBranch(p, suffix);
-        tree_->SetBranchStatus(bname.c_str(), 1);
-        tree_->SetBranchAddress(bname.c_str(), addr);
+    auto& group = schemes_[schemeIndex(schemeKey)];
+    group.clear();
+    auto setup = [&](const std::string& suffix, auto* addr) {
+        bind(schemeBranch(p, suffix), addr, group);
     };
 
     // Dijet
@@ -146,9 +271,159 @@ void DataLoader::setupSchemeBranches(SchemeData& sd, const std::string& schemeKe
 }
 
 Long64_t DataLoader::getEntries() const {
-    return tree_->GetEntries();
+    if (parquet_) return parquet_->getEntries();
+    return tree_ ? tree_->GetEntries() : 0;
 }
 
 void DataLoader::getEntry(Long64_t i) {
-    tree_->GetEntry(i);
+    if (parquet_) {
+        readGroup(i, selection_);
+        readGroup(i, event_);
+        for (auto& group : schemes_) readGroup(i, group);
+        return;
+    }
+    if (!tree_) return;
+    int nb = tree_->GetEntry(i);
+    if (nb < 0) {
+        setReadError("Cannot read", i);
+        return;
+    }
+    bytesRead_ += nb;
+    if (staging_.empty()) return;
+    convertGroup(i, selection_);
+    convertGroup(i, event_);
+    for (auto& group : schemes_) convertGroup(i, group);
+}
+
+void DataLoader::convertGroup(Long64_t i, const std::vector<BranchBinding>& group) {
+    for (auto& b : group) {
+        if (b.source && !convertLeafValue(b.source, b.sourceType, b.address, b.type)) {
+            reportInexact(b, i);
+        }
+    }
+}
+
+void DataLoader::reportInexact(const BranchBinding& b, Long64_t entry) {
+    // One warning per branch: a narrowed flag holding SENTINEL is usually
+    // the same on every entry
+    if (!inexactBranches_.insert(b.name).second) return;
+    double stored = 0;
+    convertLeafValue(b.address, b.type, &stored, 'D');
+    std::cerr << "WARNING: " << b.name << " at entry " << entry << " of " << filename_
+              << " holds a value " << leafTypeName(b.type) << " cannot store (stored as "
+              << stored << "; SENTINEL needs a signed type of 16 bits or more)" << std::endl;
+}
+
+void DataLoader::readGroup(Long64_t i, const std::vector<BranchBinding>& group) {
+    if (parquet_) {
+        for (auto& b : group) {
+            bool exact = true;
+            long long nb = b.source ? parquet_->read(b.column, i, b.source, b.sourceType, &exact)
+                                    : parquet_->read(b.column, i, b.address, b.type, &exact);
+            if (nb < 0) setReadError(parquet_->getError() + ", reading", i);
+            else bytesRead_ += nb;
+            if (b.source && !convertLeafValue(b.source, b.sourceType, b.address, b.type)) exact = false;
+            if (!exact) reportInexact(b, i);
+        }
+        return;
+    }
+    tree_->LoadTree(i);
+    for (auto& b : group) {
+        int nb = b.branch->GetEntry(i);
+        if (nb < 0) setReadError("Cannot read branch " + b.name, i);
+        else bytesRead_ += nb;
+        if (b.source && !convertLeafValue(b.source, b.sourceType, b.address, b.type)) {
+            reportInexact(b, i);
+        }
+    }
+}
+
+void DataLoader::setReadError(const std::string& what, Long64_t entry) {
+    if (readError_) return; // keep the first
+    readError_ = true;
+    error_ = what + " entry " + std::to_string(entry) + " of " + filename_;
+}
+
+// ---------------------------------------------------------------------------
+// Read cache
+// ---------------------------------------------------------------------------
+void DataLoader::setupReadCache(const ReadCacheOptions& opts) {
+    if (!tree_ || opts.cacheBytes == 0) return;
+    // Unzip threads are chosen when the cache is created
+    if (opts.prefetch) tree_->SetParallelUnzip(true);
+    tree_->SetCacheSize(opts.cacheBytes);
+    // The bound branches are known: skip the learning phase, which would
+    // cache whatever the first entries happen to touch
+    tree_->SetCacheLearnEntries(1);
+    auto add = [&](const std::vector<BranchBinding>& group) {
+        for (auto& b : group) tree_->AddBranchToCache(b.branch, false);
+    };
+    add(selection_);
+    add(event_);
+    for (auto& group : schemes_) add(group);
+    tree_->StopCacheLearningPhase();
+}
+
+void DataLoader::setCacheRange(Long64_t begin, Long64_t end) {
+    if (tree_ && tree_->GetReadCache(file_.get())) tree_->SetCacheEntryRange(begin, end);
+}
+
+ReadStats DataLoader::getReadStats() const {
+    ReadStats stats;
+    if (!file_) return stats;
+    stats.readCalls = file_->GetReadCalls();
+    stats.fileBytes = file_->GetBytesRead();
+    if (TTreeCache* cache = tree_ ? tree_->GetReadCache(file_.get()) : nullptr) {
+        stats.prefetchEfficiency = std::min(1.0, cache->GetEfficiency());
+    }
+    return stats;
+}
+
+void DataLoader::getSelectionEntry(Long64_t i) {
+    if (isOpen()) readGroup(i, selection_);
+}
+
+void DataLoader::getEventEntry(Long64_t i) {
+    if (isOpen()) readGroup(i, event_);
+}
+
+void DataLoader::getSchemeEntry(Long64_t i, SchemeId id) {
+    if (isOpen()) readGroup(i, schemes_[static_cast<int>(id)]);
+}
+
+void DataLoader::getSchemeEntry(Long64_t i, const std::string& schemeKey) {
+    int idx = schemeIndex(schemeKey);
+    if (idx >= 0) getSchemeEntry(i, static_cast<SchemeId>(idx));
+}
+
+std::vector<std::pair<Long64_t, Long64_t>> DataLoader::splitEntryRange(int nChunks) const {
+    std::vector<std::pair<Long64_t, Long64_t>> ranges;
+    Long64_t nEntries = getEntries();
+    if (nEntries <= 0) return ranges;
+    if (nChunks < 1) nChunks = 1;
+
+    // Collect cluster (row group) start entries
+    std::vector<Long64_t> bounds;
+    if (parquet_) {
+        for (long long b : parquet_->getRowGroupBounds()) bounds.push_back(b);
+    } else {
+        auto clusterIt = tree_->GetClusterIterator(0);
+        Long64_t start;
+        while ((start = clusterIt()) < nEntries) {
+            bounds.push_back(start);
+        }
+        bounds.push_back(nEntries);
+    }
+
+    // Greedily group clusters into chunks of roughly nEntries / nChunks
+    Long64_t target = (nEntries + nChunks - 1) / nChunks;
+    Long64_t begin = 0;
+    for (size_t c = 1; c < bounds.size(); ++c) {
+        bool last = (c + 1 == bounds.size());
+        if (bounds[c] - begin >= target || last) {
+            ranges.emplace_back(begin, bounds[c]);
+            begin = bounds[c];
+        }
+    }
+    return ranges;
 }
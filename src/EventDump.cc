@@ -0,0 +1,278 @@
+#include "EventDump.h"
+#include "DataLoader.h"
+#include "Config.h"
+#include <fnmatch.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <cctype>
+#include <iostream>
+#include <map>
+
+bool parseDumpFormat(const std::string& name, DumpFormat& format) {
+    if (name == "table")     format = DumpFormat::Table;
+    else if (name == "json") format = DumpFormat::Json;
+    else if (name == "csv")  format = DumpFormat::Csv;
+    else return false;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Branch groups and values
+// ---------------------------------------------------------------------------
+std::string branchGroup(const std::string& branch, std::string* field) {
+    auto done = [&](std::size_t prefixLength, std::string group) {
+        if (field) *field = branch.substr(prefixLength);
+        return group;
+    };
+    // Longest scheme prefix: nonResReg_DNNpair_ before nonResReg_
+    const std::string* scheme = nullptr;
+    std::size_t schemeLength = 0;
+    for (auto& [key, s] : getSchemes()) {
+        if (s.prefix.size() > schemeLength && branch.compare(0, s.prefix.size(), s.prefix) == 0) {
+            scheme = &key;
+            schemeLength = s.prefix.size();
+        }
+    }
+    if (scheme) return done(schemeLength, *scheme);
+
+    for (const char* object : {"lead_", "sublead_", "puppiMET_"}) {
+        std::size_t n = std::strlen(object);
+        if (branch.compare(0, n, object) == 0) return done(n, std::string(object, n - 1));
+    }
+    // Numbered objects: letters, digits, '_' (jet10_pt, fatjet1_mass, ...)
+    std::size_t letters = 0;
+    while (letters < branch.size() && std::isalpha(static_cast<unsigned char>(branch[letters]))) ++letters;
+    std::size_t digits = letters;
+    while (digits < branch.size() && std::isdigit(static_cast<unsigned char>(branch[digits]))) ++digits;
+    if (letters > 0 && digits > letters && digits + 1 < branch.size() && branch[digits] == '_') {
+        return done(digits + 1, branch.substr(0, digits));
+    }
+    return done(0, "event");
+}
+
+template <typename T>
+static std::string formatFloating(T v) {
+    if (std::isnan(v)) return "nan";
+    if (std::isinf(v)) return v > 0 ? "inf" : "-inf";
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    return std::string(buf, r.ptr);
+}
+
+template <typename T>
+static T load(const void* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+std::string formatLeafValue(const void* value, char type) {
+    switch (type) {
+        case 'D': return formatFloating(load<double>(value));
+        case 'F': return formatFloating(load<float>(value));
+        case 'L': return std::to_string(load<long long>(value));
+        case 'l': return std::to_string(load<unsigned long long>(value));
+        case 'I': return std::to_string(load<int>(value));
+        case 'i': return std::to_string(load<unsigned int>(value));
+        case 'S': return std::to_string(load<short>(value));
+        case 's': return std::to_string(load<unsigned short>(value));
+        case 'B': return std::to_string(load<signed char>(value));
+        case 'b': return std::to_string(load<unsigned char>(value));
+        case 'O': return load<bool>(value) ? "1" : "0";
+        default:  return "?";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------
+static bool matchesAny(const std::string& name, const std::vector<std::string>& patterns) {
+    for (auto& p : patterns) {
+        if (fnmatch(p.c_str(), name.c_str(), 0) == 0) return true;
+    }
+    return false;
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string jsonNumber(const std::string& v) {
+    return (v == "nan" || v == "inf" || v == "-inf") ? "null" : v;
+}
+
+static std::string csvField(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// One selected branch of the current file
+struct DumpColumn {
+    const BranchBinding* binding;
+    std::string group;
+    std::string field;
+};
+
+static void writeTable(std::ostream& out, const std::string& file, Long64_t entry,
+                       const std::string& id, const std::vector<DumpColumn>& columns) {
+    constexpr std::size_t kWidth = 100;
+    out << "=== " << id << "  (" << file << ", entry " << entry << ") ===\n";
+    for (std::size_t c = 0; c < columns.size();) {
+        const std::string& group = columns[c].group;
+        out << "  [" << group << "]\n";
+        std::string line = "   ";
+        for (; c < columns.size() && columns[c].group == group; ++c) {
+            std::string item = " " + columns[c].field + "=" +
+                               formatLeafValue(columns[c].binding->address, columns[c].binding->type);
+            if (line.size() + item.size() > kWidth && line.size() > 3) {
+                out << line << "\n";
+                line = "   ";
+            }
+            line += item;
+        }
+        out << line << "\n";
+    }
+    out << "\n";
+}
+
+static void writeJson(std::ostream& out, const std::string& file, Long64_t entry,
+                      const std::vector<DumpColumn>& columns, bool first) {
+    out << (first ? "\n" : ",\n") << "  {\"file\": " << jsonString(file) << ", \"entry\": " << entry
+        << ", \"groups\": {";
+    for (std::size_t c = 0; c < columns.size();) {
+        const std::string& group = columns[c].group;
+        out << (c == 0 ? "\n" : ",\n") << "    " << jsonString(group) << ": {";
+        for (std::size_t k = c; c < columns.size() && columns[c].group == group; ++c) {
+            out << (c == k ? "" : ", ") << jsonString(columns[c].field) << ": "
+                << jsonNumber(formatLeafValue(columns[c].binding->address, columns[c].binding->type));
+        }
+        out << "}";
+    }
+    out << "\n  }}";
+}
+
+DumpReport dumpEvents(const std::vector<std::string>& files, std::vector<EventLocation> picks,
+                      const DumpOptions& opts, std::ostream& out) {
+    DumpReport report;
+    // File by file, entries in increasing order: one forward pass per file
+    std::stable_sort(picks.begin(), picks.end(), [](const EventLocation& a, const EventLocation& b) {
+        return a.fileIndex != b.fileIndex ? a.fileIndex < b.fileIndex : a.entry < b.entry;
+    });
+
+    std::vector<std::string> csvNames; // defined by the first file that opens
+    bool csvHeader = false;
+    if (opts.format == DumpFormat::Json) out << "[";
+
+    for (std::size_t p = 0; p < picks.size();) {
+        std::size_t f = picks[p].fileIndex;
+        std::size_t last = p;
+        while (last < picks.size() && picks[last].fileIndex == f) ++last;
+
+        DataLoader loader(files[f], opts.treeName);
+        if (!loader.isOpen()) {
+            report.failures.push_back(loader.getError());
+            p = last;
+            continue;
+        }
+        // Only the selected branches (and the event id, for the table
+        // header) are enabled and read
+        auto selected = [&](const std::string& name) {
+            return (opts.branches.empty() || matchesAny(name, opts.branches)) &&
+                   (opts.groups.empty() || matchesAny(branchGroup(name), opts.groups));
+        };
+        loader.setupAllBranches([&](const std::string& name) {
+            return name == "run" || name == "lumi" || name == "event" || selected(name);
+        });
+        loader.setupReadCache(ReadCacheOptions{});
+
+        // Selected branches, grouped: "event" first, then the other groups
+        // in the order they first appear
+        std::vector<DumpColumn> columns;
+        std::map<std::string, int> groupRank{{"event", 0}};
+        const BranchBinding* idBranch[3] = {nullptr, nullptr, nullptr}; // run, lumi, event
+        for (auto& b : loader.getEventBindings()) {
+            if (b.name == "run") idBranch[0] = &b;
+            if (b.name == "lumi") idBranch[1] = &b;
+            if (b.name == "event") idBranch[2] = &b;
+            if (!selected(b.name)) continue;
+            DumpColumn c{&b, "", ""};
+            c.group = branchGroup(b.name, &c.field);
+            groupRank.emplace(c.group, static_cast<int>(groupRank.size()));
+            columns.push_back(c);
+        }
+        std::stable_sort(columns.begin(), columns.end(), [&](const DumpColumn& a, const DumpColumn& b) {
+            return groupRank[a.group] < groupRank[b.group];
+        });
+
+        std::vector<const BranchBinding*> csvColumns;
+        if (opts.format == DumpFormat::Csv) {
+            if (!csvHeader) {
+                for (auto& c : columns) csvNames.push_back(c.binding->name);
+                out << "file,entry";
+                for (auto& name : csvNames) out << "," << csvField(name);
+                out << "\n";
+                csvHeader = true;
+            }
+            std::map<std::string, const BranchBinding*> byName;
+            for (auto& c : columns) byName[c.binding->name] = c.binding;
+            for (auto& name : csvNames) {
+                auto it = byName.find(name);
+                csvColumns.push_back(it == byName.end() ? nullptr : it->second);
+            }
+        }
+
+        for (; p < last; ++p) {
+            Long64_t entry = picks[p].entry;
+            if (entry < 0 || entry >= loader.getEntries()) {
+                std::cerr << "WARNING: Entry " << entry << " out of range in " << files[f] << std::endl;
+                continue;
+            }
+            loader.getEventEntry(entry);
+            if (loader.hasReadError()) {
+                // The bound values are stale: report the event, not them
+                report.failures.push_back(loader.getError());
+                loader.clearReadError();
+                continue;
+            }
+            switch (opts.format) {
+                case DumpFormat::Table: {
+                    std::string id;
+                    for (int k = 0; k < 3; ++k) {
+                        id += (k ? ":" : "") + (idBranch[k] ? formatLeafValue(idBranch[k]->address,
+                                                                              idBranch[k]->type)
+                                                            : std::string("?"));
+                    }
+                    writeTable(out, files[f], entry, id, columns);
+                    break;
+                }
+                case DumpFormat::Json:
+                    writeJson(out, files[f], entry, columns, report.nEvents == 0);
+                    break;
+                case DumpFormat::Csv:
+                    out << csvField(files[f]) << "," << entry;
+                    for (auto* b : csvColumns) {
+                        out << "," << (b ? formatLeafValue(b->address, b->type) : std::string());
+                    }
+                    out << "\n";
+                    break;
+            }
+            ++report.nEvents;
+        }
+        report.nFilesOk++;
+    }
+
+    if (opts.format == DumpFormat::Json) out << "\n]\n";
+    return report;
+}
@@ -0,0 +1,214 @@
+#include "EventIndex.h"
+#include "DataLoader.h"
+#include "ResultCache.h"
+#include "Utils.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+// Bump when the record layout changes; old sidecars are then rebuilt
+static constexpr uint32_t kIndexVersion = 1;
+static const char kIndexMagic[4] = {'H', 'H', 'E', 'I'};
+
+// ---------------------------------------------------------------------------
+// Event IDs
+// ---------------------------------------------------------------------------
+bool parseEventId(const std::string& text, EventId& id) {
+    uint64_t v[3];
+    const char* p = text.data();
+    const char* end = p + text.size();
+    for (int k = 0; k < 3; ++k) {
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        auto r = std::from_chars(p, end, v[k]);
+        if (r.ec != std::errc()) return false;
+        p = r.ptr;
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        if (k < 2) {
+            if (p < end && *p == ':') ++p;
+            else if (p == r.ptr) return false; // no separator
+        }
+    }
+    if (p != end || v[0] > UINT32_MAX || v[1] > UINT32_MAX) return false;
+    id.run = static_cast<uint32_t>(v[0]);
+    id.lumi = static_cast<uint32_t>(v[1]);
+    id.event = v[2];
+    return true;
+}
+
+std::vector<EventId> parseEventList(const std::string& spec) {
+    std::vector<std::string> items;
+    if (fileExists(spec)) {
+        std::ifstream in(spec);
+        for (std::string line; std::getline(in, line);) {
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                items.push_back(line.substr(0, line.find_last_not_of(" \t\r") + 1));
+            }
+        }
+    } else {
+        std::istringstream iss(spec);
+        for (std::string item; std::getline(iss, item, ',');) {
+            if (!item.empty()) items.push_back(item);
+        }
+    }
+    std::vector<EventId> ids;
+    for (auto& item : items) {
+        EventId id;
+        if (parseEventId(item, id)) {
+            ids.push_back(id);
+        } else {
+            std::cerr << "WARNING: Cannot parse event '" << item << "' (expected run:lumi:event)"
+                      << std::endl;
+        }
+    }
+    return ids;
+}
+
+std::string formatEventId(const EventId& id) {
+    return std::to_string(id.run) + ":" + std::to_string(id.lumi) + ":" + std::to_string(id.event);
+}
+
+// ---------------------------------------------------------------------------
+// EventIndex
+// ---------------------------------------------------------------------------
+std::string eventIndexPath(const std::string& file, const std::string& indexDir) {
+    if (indexDir.empty()) return file + ".evidx";
+    // Same base name in different directories must not collide
+    std::string base = file.substr(file.find_last_of('/') + 1);
+    std::ostringstream name;
+    name << indexDir << "/" << base << "." << std::hex << std::setw(16) << std::setfill('0')
+         << hashString(file) << ".evidx";
+    return name.str();
+}
+
+// Identity of the input without its path, so a sidecar stays valid when the
+// file and its index are moved together
+static uint64_t indexFingerprint(const std::string& file) {
+    InputFingerprint fp = fingerprintFile(file);
+    uint64_t h = hashValue(fp.size);
+    h = hashValue(fp.mtime, h);
+    return hashString(fp.uuid, h);
+}
+
+EventIndex EventIndex::loadOrBuild(const std::string& file, const std::string& indexDir,
+                                   const std::string& treeName) {
+    EventIndex index;
+    index.sidecar_ = eventIndexPath(file, indexDir);
+    uint64_t fingerprint = indexFingerprint(file);
+    DataLoader loader(file, treeName);
+    if (!loader.isOpen()) {
+        index.error_ = loader.getError();
+        return index;
+    }
+    Long64_t n = loader.getEntries();
+    if (index.load(fingerprint, n)) {
+        index.open_ = true;
+        return index;
+    }
+
+    EventData evt;
+    loader.setupEventIdBranches(evt);
+    loader.setupReadCache(ReadCacheOptions{});
+    index.records_.resize(static_cast<std::size_t>(n));
+    for (Long64_t i = 0; i < n; ++i) {
+        loader.getEventEntry(i);
+        // A failed read leaves stale ids: never save (or use) such an index
+        if (loader.hasReadError()) {
+            index.records_.clear();
+            index.error_ = loader.getError();
+            return index;
+        }
+        index.records_[i] = {{evt.run, evt.lumi, evt.event}, i};
+    }
+    std::sort(index.records_.begin(), index.records_.end(),
+              [](const Record& a, const Record& b) {
+                  return a.id < b.id || (a.id == b.id && a.entry < b.entry);
+              });
+    index.open_ = true;
+    index.built_ = true;
+    if (!indexDir.empty()) ensureDirectory(indexDir);
+    if (!index.save(fingerprint)) {
+        std::cerr << "WARNING: Event index of " << file << " not saved; use --index-dir DIR "
+                  << "to keep it elsewhere" << std::endl;
+    }
+    return index;
+}
+
+bool EventIndex::load(uint64_t fingerprint, Long64_t entries) {
+    std::ifstream in(sidecar_, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    auto fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t fp = 0, n = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&fp), sizeof(fp));
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    if (!in || std::memcmp(magic, kIndexMagic, 4) != 0 || version != kIndexVersion ||
+        fp != fingerprint) {
+        return false;
+    }
+    // One record per entry, filling the rest of the file exactly: a
+    // truncated or corrupt sidecar is rebuilt, never allocated from
+    constexpr uint64_t kHeader = 4 + sizeof(version) + sizeof(fp) + sizeof(n);
+    if (n != static_cast<uint64_t>(entries) || fileSize < kHeader ||
+        (fileSize - kHeader) / sizeof(Record) != n || (fileSize - kHeader) % sizeof(Record) != 0) {
+        return false;
+    }
+    std::vector<Record> records(n);
+    if (!in.read(reinterpret_cast<char*>(records.data()),
+                 static_cast<std::streamsize>(n * sizeof(Record)))) {
+        return false;
+    }
+    for (auto& r : records) {
+        if (r.entry < 0 || r.entry >= entries) return false;
+    }
+    records_ = std::move(records);
+    return true;
+}
+
+bool EventIndex::save(uint64_t fingerprint) const {
+    return writeFileAtomic(sidecar_, [&](std::ostream& out) {
+        uint64_t n = records_.size();
+        out.write(kIndexMagic, 4);
+        out.write(reinterpret_cast<const char*>(&kIndexVersion), sizeof(kIndexVersion));
+        out.write(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        out.write(reinterpret_cast<const char*>(records_.data()),
+                  static_cast<std::streamsize>(n * sizeof(Record)));
+    });
+}
+
+std::vector<EventLocation> locateEvents(const std::vector<std::string>& files,
+                                        const std::vector<EventId>& ids,
+                                        const std::string& indexDir, int* nBuilt) {
+    std::vector<EventLocation> found;
+    if (nBuilt) *nBuilt = 0;
+    for (std::size_t f = 0; f < files.size(); ++f) {
+        EventIndex index = EventIndex::loadOrBuild(files[f], indexDir);
+        if (!index.isOpen()) {
+            std::cerr << "WARNING: No event index for " << files[f] << ": " << index.getError()
+                      << std::endl;
+            continue;
+        }
+        if (index.wasBuilt() && nBuilt) ++*nBuilt;
+        for (auto& id : ids) {
+            for (Long64_t entry : index.find(id)) found.push_back({id, f, entry});
+        }
+    }
+    return found;
+}
+
+std::vector<Long64_t> EventIndex::find(const EventId& id) const {
+    std::vector<Long64_t> entries;
+    auto it = std::lower_bound(records_.begin(), records_.end(), id,
+                               [](const Record& r, const EventId& key) { return r.id < key; });
+    for (; it != records_.end() && it->id == id; ++it) entries.push_back(it->entry);
+    return entries;
+}
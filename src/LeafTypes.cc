@@ -0,0 +1,100 @@
+#include "LeafTypes.h"
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+std::size_t leafTypeSize(char type) {
+    switch (type) {
+        case 'D': case 'L': case 'l': return 8;
+        case 'F': case 'I': case 'i': return 4;
+        case 'S': case 's':           return 2;
+        case 'B': case 'b': case 'O': return 1;
+        default:                      return 0;
+    }
+}
+
+const char* leafTypeName(char type) {
+    switch (type) {
+        case 'D': return "Double_t";
+        case 'F': return "Float_t";
+        case 'L': return "Long64_t";
+        case 'l': return "ULong64_t";
+        case 'I': return "Int_t";
+        case 'i': return "UInt_t";
+        case 'S': return "Short_t";
+        case 's': return "UShort_t";
+        case 'B': return "Char_t";
+        case 'b': return "UChar_t";
+        case 'O': return "Bool_t";
+        default:  return "?";
+    }
+}
+
+// long double holds every double and 64-bit integer exactly on x86
+template <typename T>
+static long double loadAs(const void* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return static_cast<long double>(v);
+}
+
+static long double loadLeaf(const void* p, char type) {
+    switch (type) {
+        case 'D': return loadAs<double>(p);
+        case 'F': return loadAs<float>(p);
+        case 'L': return loadAs<long long>(p);
+        case 'l': return loadAs<unsigned long long>(p);
+        case 'I': return loadAs<int>(p);
+        case 'i': return loadAs<unsigned int>(p);
+        case 'S': return loadAs<short>(p);
+        case 's': return loadAs<unsigned short>(p);
+        case 'B': return loadAs<char>(p);
+        case 'b': return loadAs<unsigned char>(p);
+        case 'O': return loadAs<bool>(p);
+        default:  return 0;
+    }
+}
+
+template <typename T>
+static void storeAs(void* p, long double v) {
+    T out;
+    if constexpr (std::is_floating_point<T>::value) {
+        out = static_cast<T>(v);
+    } else if (v != v) {
+        out = 0;
+    } else {
+        long double lo = static_cast<long double>(std::numeric_limits<T>::lowest());
+        long double hi = static_cast<long double>(std::numeric_limits<T>::max());
+        out = static_cast<T>(v < lo ? lo : (v > hi ? hi : v));
+    }
+    std::memcpy(p, &out, sizeof(T));
+}
+
+static void storeLeaf(void* p, char type, long double v) {
+    switch (type) {
+        case 'D': storeAs<double>(p, v); break;
+        case 'F': storeAs<float>(p, v); break;
+        case 'L': storeAs<long long>(p, v); break;
+        case 'l': storeAs<unsigned long long>(p, v); break;
+        case 'I': storeAs<int>(p, v); break;
+        case 'i': storeAs<unsigned int>(p, v); break;
+        case 'S': storeAs<short>(p, v); break;
+        case 's': storeAs<unsigned short>(p, v); break;
+        case 'B': storeAs<char>(p, v); break;
+        case 'b': storeAs<unsigned char>(p, v); break;
+        case 'O': storeAs<bool>(p, v != 0); break;
+        default:  break;
+    }
+}
+
+bool convertLeafValue(const void* src, char srcType, void* dst, char dstType) {
+    long double v = loadLeaf(src, srcType);
+    storeLeaf(dst, dstType, v);
+    long double back = loadLeaf(dst, dstType);
+    return back == v || (v != v && back != back);
+}
+
+bool leafTypeHolds(char type, double v) {
+    unsigned char scratch[8];
+    return leafTypeSize(type) != 0 && convertLeafValue(&v, 'D', scratch, type);
+}
@@ -0,0 +1,188 @@
+#include "ParquetReader.h"
+#include "LeafTypes.h"
+#include "Config.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef HAVE_ARROW
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+
+struct ParquetReader::Impl {
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+};
+
+// leafTypeCode of an Arrow type, 0 if unsupported
+static char arrowTypeCode(arrow::Type::type id) {
+    switch (id) {
+        case arrow::Type::DOUBLE: return 'D';
+        case arrow::Type::FLOAT:  return 'F';
+        case arrow::Type::INT64:  return 'L';
+        case arrow::Type::UINT64: return 'l';
+        case arrow::Type::INT32:  return 'I';
+        case arrow::Type::UINT32: return 'i';
+        case arrow::Type::INT16:  return 'S';
+        case arrow::Type::UINT16: return 's';
+        case arrow::Type::INT8:   return 'B';
+        case arrow::Type::UINT8:  return 'b';
+        case arrow::Type::BOOL:   return 'O';
+        default:                  return 0;
+    }
+}
+
+ParquetReader::ParquetReader(const std::string& path) : impl_(std::make_unique<Impl>()) {
+    auto file = arrow::io::ReadableFile::Open(path);
+    if (!file.ok()) {
+        error_ = "Cannot open file " + path + ": " + file.status().ToString();
+        return;
+    }
+    parquet::arrow::FileReaderBuilder builder;
+    arrow::Status st = builder.Open(*file);
+    if (st.ok()) st = builder.Build(&impl_->reader);
+    if (!st.ok()) {
+        error_ = "Cannot read Parquet file " + path + ": " + st.ToString();
+        return;
+    }
+    // Decoding happens inside our own worker threads already
+    impl_->reader->set_use_threads(false);
+
+    std::shared_ptr<arrow::Schema> schema;
+    st = impl_->reader->GetSchema(&schema);
+    if (!st.ok()) {
+        error_ = "Cannot read the schema of " + path + ": " + st.ToString();
+        return;
+    }
+    for (int f = 0; f < schema->num_fields(); ++f) {
+        char type = arrowTypeCode(schema->field(f)->type()->id());
+        if (type == 0) continue; // lists, strings, ...: not bindable
+        Column c;
+        c.name = schema->field(f)->name();
+        c.field = f;
+        c.type = type;
+        columns_.push_back(std::move(c));
+    }
+
+    auto meta = impl_->reader->parquet_reader()->metadata();
+    for (int g = 0; g < meta->num_row_groups(); ++g) {
+        bounds_.push_back(nEntries_);
+        nEntries_ += meta->RowGroup(g)->num_rows();
+    }
+    bounds_.push_back(nEntries_);
+    open_ = true;
+}
+
+long long ParquetReader::loadGroup(Column& c, int group) {
+    std::size_t elem = leafTypeSize(c.type);
+    long long nRows = bounds_[group + 1] - bounds_[group];
+    c.data.assign(static_cast<std::size_t>(nRows) * elem, 0);
+    c.loadedGroup = group;
+
+    std::shared_ptr<arrow::ChunkedArray> chunks;
+    arrow::Status st = impl_->reader->RowGroup(group)->Column(c.field)->Read(&chunks);
+    if (!st.ok()) {
+        error_ = "Cannot read column " + c.name + " of row group " + std::to_string(group) + ": " +
+                 st.ToString();
+        c.loadedGroup = -1;
+        return -1;
+    }
+
+    std::size_t row = 0;
+    for (auto& chunk : chunks->chunks()) {
+        std::size_t len = static_cast<std::size_t>(chunk->length());
+        if (row + len > static_cast<std::size_t>(nRows)) {
+            row += len;
+            break;
+        }
+        char* out = c.data.data() + row * elem;
+        if (c.type == 'O') {
+            // Bit-packed: expand to one byte per value
+            const auto& bools = static_cast<const arrow::BooleanArray&>(*chunk);
+            for (std::size_t i = 0; i < len; ++i) out[i] = bools.Value(static_cast<int64_t>(i));
+        } else {
+            // Fixed-width values: buffer 1, starting at the array offset
+            const auto& data = *chunk->data();
+            std::memcpy(out, data.buffers[1]->data() + data.offset * elem, len * elem);
+        }
+        row += len;
+    }
+    if (row != static_cast<std::size_t>(nRows)) {
+        error_ = "Column " + c.name + " of row group " + std::to_string(group) + " has " +
+                 std::to_string(row) + " values, expected " + std::to_string(nRows);
+        c.loadedGroup = -1;
+        return -1;
+    }
+
+    // Nulls read as SENTINEL: a group with nulls in a type that cannot hold
+    // it (flags, counts) is kept as doubles so the sentinel survives
+    c.loadedType = c.type;
+    if (chunks->null_count() > 0) {
+        const double sentinel = SENTINEL;
+        if (!leafTypeHolds(c.type, sentinel)) {
+            std::vector<char> wide(static_cast<std::size_t>(nRows) * sizeof(double));
+            for (long long r = 0; r < nRows; ++r) {
+                convertLeafValue(c.data.data() + r * elem, c.type, wide.data() + r * sizeof(double), 'D');
+            }
+            c.data.swap(wide);
+            c.loadedType = 'D';
+            elem = sizeof(double);
+        }
+        row = 0;
+        for (auto& chunk : chunks->chunks()) {
+            for (int64_t i = 0; i < chunk->length(); ++i) {
+                if (chunk->IsNull(i)) {
+                    convertLeafValue(&sentinel, 'D', c.data.data() + (row + i) * elem, c.loadedType);
+                }
+            }
+            row += static_cast<std::size_t>(chunk->length());
+        }
+    }
+    return static_cast<long long>(c.data.size());
+}
+
+#else
+
+struct ParquetReader::Impl {};
+
+ParquetReader::ParquetReader(const std::string& path) {
+    error_ = "Cannot read " + path + ": Parquet input needs a build with Apache Arrow "
+             "(make ARROW=1)";
+}
+
+long long ParquetReader::loadGroup(Column& c, int group) {
+    c.loadedGroup = group;
+    return 0;
+}
+
+#endif
+
+ParquetReader::~ParquetReader() = default;
+
+int ParquetReader::findColumn(const std::string& name) const {
+    for (std::size_t c = 0; c < columns_.size(); ++c) {
+        if (columns_[c].name == name) return static_cast<int>(c);
+    }
+    return -1;
+}
+
+long long ParquetReader::read(int column, long long entry, void* dst, char dstType, bool* exact) {
+    Column& c = columns_[column];
+    long long bytes = 0;
+    int group = c.loadedGroup;
+    if (group < 0 || entry < bounds_[group] || entry >= bounds_[group + 1]) {
+        group = static_cast<int>(std::upper_bound(bounds_.begin(), bounds_.end(), entry) -
+                                 bounds_.begin()) - 1;
+        if (group < 0 || group + 1 >= static_cast<int>(bounds_.size())) return 0;
+        bytes = loadGroup(c, group);
+        if (bytes < 0) return -1;
+    }
+    std::size_t elem = leafTypeSize(c.loadedType);
+    std::size_t offset = static_cast<std::size_t>(entry - bounds_[group]) * elem;
+    if (offset + elem <= c.data.size() &&
+        !convertLeafValue(c.data.data() + offset, c.loadedType, dst, dstType) && exact) {
+        *exact = false;
+    }
+    return bytes;
+}
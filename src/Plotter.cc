@@ -5,8 +5,16 @@
 #include <TBox.h>
 #include <TLine.h>
 #include <TROOT.h>
+#include <TFile.h>
 #include <iostream>
+#include <fstream>
 #include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
 
 // Color palette for overlays
 static const int kSchemeColors[] = {kBlue+1, kRed+1, kGreen+2, kMagenta+1, kOrange+1, kCyan+2};
@@ -43,7 +51,7 @@ void Plotter::setupCMSStyle() {
     gROOT->ForceStyle();
 }
 
-TH1D* Plotter::bookTH1(const std::string& name, const PlotDef& def) {
+std::string Plotter::axisTitle(const PlotDef& def) {
     std::string title = ";" + def.xlabel;
     if (!def.units.empty()) title += " [" + def.units + "]";
     title += ";Events";
@@ -55,7 +63,11 @@ TH1D* Plotter::bookTH1(const std::string& name, const PlotDef& def) {
         title += " / " + oss.str();
         if (!def.units.empty()) title += " " + def.units;
     }
+    return title;
+}
 
+TH1D* Plotter::bookTH1(const std::string& name, const PlotDef& def) {
+    std::string title = axisTitle(def);
     auto h = std::make_unique<TH1D>(name.c_str(), title.c_str(), def.nbins, def.xmin, def.xmax);
     h->SetLineColor(kBlack);
     h->SetLineWidth(2);
@@ -75,6 +87,40 @@ TH2D* Plotter::bookTH2(const std::string& name, int nx, double xmin, double xmax
     return ptr;
 }
 
+TH1D* Plotter::toTH1(const FastHist1D& fh) {
+    auto h = std::make_unique<TH1D>(fh.getName().c_str(), fh.getTitle().c_str(),
+                                    fh.getNbins(), fh.getXmin(), fh.getXmax());
+    h->SetDirectory(nullptr);
+    h->SetLineColor(kBlack);
+    h->SetLineWidth(2);
+    h->Sumw2();
+    // Same bin layout (under/overflow included): copy the arrays
+    std::vector<double> sumw = fh.getSumw(), sumw2 = fh.getSumw2();
+    std::copy(sumw.begin(), sumw.end(), h->GetArray());
+    std::copy(sumw2.begin(), sumw2.end(), h->GetSumw2()->GetArray());
+    h->ResetStats();
+    h->SetEntries(static_cast<double>(fh.getEntries()));
+    TH1D* ptr = h.get();
+    ownedTH1_.push_back(std::move(h));
+    return ptr;
+}
+
+TH2D* Plotter::toTH2(const FastHist2D& fh) {
+    auto h = std::make_unique<TH2D>(fh.getName().c_str(), fh.getTitle().c_str(),
+                                    fh.getNbinsX(), fh.getXmin(), fh.getXmax(),
+                                    fh.getNbinsY(), fh.getYmin(), fh.getYmax());
+    h->SetDirectory(nullptr);
+    h->Sumw2();
+    std::vector<double> sumw = fh.getSumw(), sumw2 = fh.getSumw2();
+    std::copy(sumw.begin(), sumw.end(), h->GetArray());
+    std::copy(sumw2.begin(), sumw2.end(), h->GetSumw2()->GetArray());
+    h->ResetStats();
+    h->SetEntries(static_cast<double>(fh.getEntries()));
+    TH2D* ptr = h.get();
+    ownedTH2_.push_back(std::move(h));
+    return ptr;
+}
+
 void Plotter::drawCMSLabel(TCanvas* c, const std::string& extra) {
     c->cd();
     TLatex latex;
@@ -103,6 +149,15 @@ void Plotter::drawCMSLabel(TCanvas* c, const std::string& extra) {
 }
 
 void Plotter::draw1D(TH1D* h, double blindLow, double blindHigh) {
+    PlotJob job;
+    job.name = h->GetName();
+    job.hash = hashValue(blindHigh, hashValue(blindLow, hashHist(h, hashString("1D"))));
+    job.objects = {h};
+    job.render = [this, h, blindLow, blindHigh] { render1D(h, blindLow, blindHigh); };
+    submit(std::move(job));
+}
+
+void Plotter::render1D(TH1D* h, double blindLow, double blindHigh) {
     TCanvas c("c", "", 800, 600);
     h->Draw("HIST E");
     drawCMSLabel(&c);
@@ -120,10 +175,26 @@ void Plotter::draw1D(TH1D* h, double blindLow, double blindHigh) {
     save(&c, h->GetName());
 }
 
+void Plotter::draw1D(const FastHist1D& h, double blindLow, double blindHigh) {
+    draw1D(toTH1(h), blindLow, blindHigh);
+}
+
 void Plotter::drawCompare(const std::vector<TH1D*>& hists, const std::vector<std::string>& labels,
                            bool normalize) {
     if (hists.empty()) return;
 
+    PlotJob job;
+    job.name = std::string("compare_") + hists[0]->GetName();
+    job.hash = hashValue(normalize, hashString("compare"));
+    for (size_t i = 0; i < hists.size(); ++i) {
+        job.hash = hashString(labels[i], hashHist(hists[i], job.hash));
+    }
+    job.render = [this, hists, labels, normalize] { renderCompare(hists, labels, normalize); };
+    submit(std::move(job));
+}
+
+void Plotter::renderCompare(const std::vector<TH1D*>& hists,
+                            const std::vector<std::string>& labels, bool normalize) {
     TCanvas c("c_compare", "", 800, 600);
 
     TLegend leg(0.60, 0.70, 0.92, 0.92);
@@ -157,6 +228,15 @@ void Plotter::drawCompare(const std::vector<TH1D*>& hists, const std::vector<std
 }
 
 void Plotter::draw2DMassPlane(TH2D* h, bool blind) {
+    PlotJob job;
+    job.name = h->GetName();
+    job.hash = hashValue(blind, hashHist(h, hashString("2D")));
+    job.objects = {h};
+    job.render = [this, h, blind] { render2DMassPlane(h, blind); };
+    submit(std::move(job));
+}
+
+void Plotter::render2DMassPlane(TH2D* h, bool blind) {
     TCanvas c("c_2d", "", 800, 700);
     c.SetRightMargin(0.15);
     h->Draw("COLZ");
@@ -185,28 +265,52 @@ void Plotter::draw2DMassPlane(TH2D* h, bool blind) {
     save(&c, h->GetName());
 }
 
-void Plotter::drawCutflow(const std::map<std::string, int>& cuts, const std::string& schemeName) {
-    int nCuts = static_cast<int>(cuts.size());
+void Plotter::draw2DMassPlane(const FastHist2D& h, bool blind) {
+    draw2DMassPlane(toTH2(h), blind);
+}
+
+void Plotter::drawCutflow(const Cutflow& cf, bool weighted) {
+    int nCuts = static_cast<int>(cf.steps.size());
     if (nCuts == 0) return;
 
-    TH1D hCut(("cutflow_" + schemeName).c_str(), ";Cut;Events", nCuts, 0, nCuts);
-    hCut.SetFillColor(kAzure + 1);
-    hCut.SetLineColor(kAzure + 2);
+    std::string name = "cutflow_" + cf.schemeKey;
+    auto owned = std::make_unique<TH1D>(name.c_str(), weighted ? ";Cut;#Sigma w" : ";Cut;Events",
+                                        nCuts, 0, nCuts);
+    TH1D* hCut = owned.get();
+    ownedTH1_.push_back(std::move(owned));
+    hCut->SetDirectory(nullptr);
+    hCut->SetFillColor(kAzure + 1);
+    hCut->SetLineColor(kAzure + 2);
 
-    int bin = 1;
-    for (auto& [label, count] : cuts) {
-        hCut.GetXaxis()->SetBinLabel(bin, label.c_str());
-        hCut.SetBinContent(bin, count);
-        bin++;
+    uint64_t labelHash = hashString("cutflow");
+    for (int bin = 1; bin <= nCuts; ++bin) {
+        const CutflowStep& step = cf.steps[bin - 1];
+        hCut->GetXaxis()->SetBinLabel(bin, step.label.c_str());
+        labelHash = hashString(step.label, labelHash);
+        if (weighted) {
+            hCut->SetBinContent(bin, step.sumW.value());
+            hCut->SetBinError(bin, std::sqrt(step.sumW2.value()));
+        } else {
+            hCut->SetBinContent(bin, step.nEvents);
+        }
     }
-    hCut.GetXaxis()->SetLabelSize(0.035);
-    hCut.LabelsOption("v");
+    hCut->GetXaxis()->SetLabelSize(0.035);
+    hCut->LabelsOption("v");
+
+    PlotJob job;
+    job.name = name;
+    job.hash = hashHist(hCut, labelHash);
+    job.objects = {hCut};
+    job.render = [this, hCut, name] { renderCutflow(hCut, name); };
+    submit(std::move(job));
+}
 
+void Plotter::renderCutflow(TH1D* hCut, const std::string& name) {
     TCanvas c("c_cutflow", "", 900, 600);
     c.SetBottomMargin(0.25);
-    hCut.Draw("BAR");
+    hCut->Draw("BAR");
     drawCMSLabel(&c, "Preliminary");
-    save(&c, "cutflow_" + schemeName);
+    save(&c, name);
 }
 
 void Plotter::save(TCanvas* c, const std::string& name) {
@@ -214,3 +318,161 @@ void Plotter::save(TCanvas* c, const std::string& name) {
     c->SaveAs((base + ".pdf").c_str());
     c->SaveAs((base + ".png").c_str());
 }
+
+// ---------------------------------------------------------------------------
+// Deferred rendering
+// ---------------------------------------------------------------------------
+bool parseRenderMode(const std::string& text, RenderMode& mode) {
+    if (text == "serial")   { mode = RenderMode::Serial;   return true; }
+    if (text == "none")     { mode = RenderMode::None;     return true; }
+    if (text == "parallel") { mode = RenderMode::Parallel; return true; }
+    if (text == "lazy")     { mode = RenderMode::Lazy;     return true; }
+    return false;
+}
+
+void Plotter::setRenderMode(RenderMode mode, int jobs) {
+    mode_ = mode;
+    renderJobs_ = jobs;
+    // Worker processes must not try to open a display
+    if (mode_ == RenderMode::Parallel || mode_ == RenderMode::Lazy) gROOT->SetBatch(true);
+}
+
+void Plotter::submit(PlotJob job) {
+    if (mode_ == RenderMode::Serial) {
+        job.render();
+        return;
+    }
+    jobs_.push_back(std::move(job));
+}
+
+// Content, errors, binning and titles: everything draw* puts on the canvas
+uint64_t Plotter::hashHist(const TH1* h, uint64_t seed) const {
+    uint64_t hash = hashString(h->GetName(), seed);
+    hash = hashString(h->GetTitle(), hash);
+    hash = hashValue(lumi_, hashValue(sqrtS_, hash));
+    const TAxis* ax = h->GetXaxis();
+    const TAxis* ay = h->GetYaxis();
+    hash = hashValue(ax->GetXmin(), hashValue(ax->GetXmax(), hash));
+    hash = hashValue(ay->GetXmin(), hashValue(ay->GetXmax(), hash));
+    int nCells = h->GetNcells();
+    for (int bin = 0; bin < nCells; ++bin) {
+        hash = hashValue(h->GetBinContent(bin), hash);
+        hash = hashValue(h->GetBinError(bin), hash);
+    }
+    return hash;
+}
+
+// Jobs todo[k], todo[k + n], ... go to worker k. Returns false if any
+// worker failed; a worker that cannot be started is replaced by rendering
+// its share here.
+bool Plotter::renderInWorkers(const std::vector<size_t>& todo, int nWorkers) {
+    nWorkers = std::max(1, std::min<int>(nWorkers, static_cast<int>(todo.size())));
+    auto renderShare = [&](int k) {
+        for (size_t j = k; j < todo.size(); j += nWorkers) jobs_[todo[j]].render();
+    };
+    if (nWorkers == 1) {
+        renderShare(0);
+        return true;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    std::vector<pid_t> pids;
+    for (int k = 0; k < nWorkers; ++k) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int rc = 0;
+            try {
+                renderShare(k);
+            } catch (...) {
+                rc = 1;
+            }
+            std::cout.flush();
+            std::fflush(nullptr);
+            _exit(rc); // skip ROOT teardown in the child
+        }
+        if (pid < 0) {
+            std::cerr << "WARNING: Cannot start render worker, rendering its plots here" << std::endl;
+            renderShare(k);
+            continue;
+        }
+        pids.push_back(pid);
+    }
+
+    bool ok = true;
+    for (pid_t pid : pids) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+RenderReport Plotter::finish() {
+    RenderReport report;
+    if (jobs_.empty()) return report;
+
+    int nWorkers = renderJobs_ > 0 ? renderJobs_
+                                   : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    if (mode_ == RenderMode::None) {
+        report.rootFile = outputDir_ + "/histograms.root";
+        TFile out(report.rootFile.c_str(), "RECREATE");
+        if (out.IsZombie()) {
+            std::cerr << "ERROR: Cannot create " << report.rootFile << std::endl;
+            report.rootFile.clear();
+        } else {
+            for (auto& job : jobs_) {
+                for (TH1* h : job.objects) {
+                    h->Write();
+                    report.nWritten++;
+                }
+            }
+            out.Close();
+        }
+    } else {
+        std::vector<size_t> todo;
+        std::string manifestPath = outputDir_ + "/.render_manifest";
+        std::map<std::string, uint64_t> manifest;
+
+        if (mode_ == RenderMode::Lazy) {
+            std::ifstream in(manifestPath);
+            std::string name;
+            uint64_t hash;
+            while (in >> name >> std::hex >> hash >> std::dec) manifest[name] = hash;
+        }
+        for (size_t j = 0; j < jobs_.size(); ++j) {
+            const PlotJob& job = jobs_[j];
+            if (mode_ == RenderMode::Lazy) {
+                auto it = manifest.find(job.name);
+                std::string base = outputDir_ + "/" + job.name;
+                bool upToDate = it != manifest.end() && it->second == job.hash &&
+                                fileExists(base + ".pdf") && fileExists(base + ".png");
+                if (upToDate) {
+                    report.nUnchanged++;
+                    continue;
+                }
+            }
+            todo.push_back(j);
+        }
+
+        bool ok = renderInWorkers(todo, nWorkers);
+        if (!ok) report.nFailedWorkers++;
+        report.nRendered = static_cast<int>(todo.size());
+
+        // Record what is on disk now; a failed run must re-render next time
+        if (mode_ == RenderMode::Lazy) {
+            if (ok) {
+                for (auto& job : jobs_) manifest[job.name] = job.hash;
+            } else {
+                for (size_t j : todo) manifest.erase(jobs_[j].name);
+            }
+            std::ofstream out(manifestPath);
+            for (auto& [name, hash] : manifest) out << name << " " << std::hex << hash << std::dec << "\n";
+        }
+    }
+    jobs_.clear();
+    return report;
+}
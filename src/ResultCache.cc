@@ -0,0 +1,658 @@
+#include "ResultCache.h"
+#include "Utils.h"
+#include "BinaryIO.h"
+#include <TFile.h>
+#include <TUUID.h>
+#include <TKey.h>
+#include <TList.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Bump when the entry layout changes; old entries then simply miss
+static constexpr uint32_t kCacheVersion = 3;
+static const char kCacheMagic[4] = {'H', 'H', 'R', 'C'};
+
+// ---------------------------------------------------------------------------
+// Fingerprints
+// ---------------------------------------------------------------------------
+uint64_t InputFingerprint::hash(uint64_t seed) const {
+    uint64_t h = hashString(path, seed);
+    h = hashValue(size, h);
+    h = hashValue(mtime, h);
+    return hashString(uuid, h);
+}
+
+InputFingerprint fingerprintFile(const std::string& path) {
+    InputFingerprint fp;
+    fp.path = path;
+    std::error_code ec;
+    if (path.find("://") == std::string::npos) {
+        auto size = fs::file_size(path, ec);
+        if (!ec) fp.size = static_cast<long long>(size);
+        auto mtime = fs::last_write_time(path, ec);
+        if (!ec) fp.mtime = static_cast<long long>(mtime.time_since_epoch().count());
+    }
+    if (isParquetPath(path)) return fp; // not a ROOT file: no UUID
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+    if (file && !file->IsZombie()) fp.uuid = file->GetUUID().AsString();
+    return fp;
+}
+
+uint64_t fingerprintInputs(const std::vector<std::string>& files) {
+    uint64_t h = hashValue(files.size());
+    for (auto& f : files) h = fingerprintFile(f).hash(h);
+    return h;
+}
+
+uint64_t hashCuts(const SelectionCuts& cuts) {
+    // Field by field: the struct has padding
+    uint64_t h = kHashSeed;
+    for (double v : {cuts.leadPtOverMgg, cuts.subleadPtOverMgg, cuts.mvaIdMin,
+                     cuts.mggMin, cuts.mggMax, cuts.mjjMin, cuts.mjjMax, cuts.bjetPtMin}) {
+        h = hashValue(v, h);
+    }
+    return hashValue(cuts.nBLooseMin, h);
+}
+
+// ---------------------------------------------------------------------------
+// Serialisation
+// ---------------------------------------------------------------------------
+static void putVector(std::ostream& out, const std::vector<double>& v) {
+    put<uint64_t>(out, v.size());
+    out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(double)));
+}
+
+static bool getVector(std::istream& in, std::vector<double>& v) {
+    uint64_t n = 0;
+    if (!get(in, n) || n > (1ull << 28)) return false;
+    v.resize(n);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()),
+                                     static_cast<std::streamsize>(n * sizeof(double))));
+}
+
+static void putBytes(std::ostream& out, const std::vector<unsigned char>& v) {
+    put<uint64_t>(out, v.size());
+    out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size()));
+}
+
+static bool getBytes(std::istream& in, std::vector<unsigned char>& v) {
+    uint64_t n = 0;
+    if (!get(in, n) || n > (1ull << 28)) return false;
+    v.resize(n);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()), static_cast<std::streamsize>(n)));
+}
+
+static void putUnbinned(std::ostream& out, const UnbinnedEvents& u) {
+    putVector(out, u.mgg);
+    putVector(out, u.mjj);
+    putVector(out, u.weight);
+    putBytes(out, u.category);
+}
+
+static bool getUnbinned(std::istream& in, UnbinnedEvents& u) {
+    if (!getVector(in, u.mgg) || !getVector(in, u.mjj) || !getVector(in, u.weight) ||
+        !getBytes(in, u.category)) return false;
+    std::size_t n = u.mgg.size();
+    return u.mjj.size() == n && u.weight.size() == n && u.category.size() == n;
+}
+
+static void putHist(std::ostream& out, const FastHist1D& h) {
+    putString(out, h.getName());
+    put(out, h.getNbins());
+    put(out, h.getXmin());
+    put(out, h.getXmax());
+    put(out, h.getEntries());
+    putVector(out, h.getSumw());
+    putVector(out, h.getSumw2());
+}
+
+// Reads into a copy of `booked`; fails if the binning differs
+static bool getHist(std::istream& in, const FastHist1D& booked, FastHist1D& result) {
+    std::string name;
+    int nbins = 0;
+    double xmin = 0, xmax = 0;
+    long long entries = 0;
+    std::vector<double> sumw, sumw2;
+    if (!getString(in, name) || !get(in, nbins) || !get(in, xmin) || !get(in, xmax) ||
+        !get(in, entries) || !getVector(in, sumw) || !getVector(in, sumw2)) return false;
+    if (name != booked.getName() || nbins != booked.getNbins() ||
+        xmin != booked.getXmin() || xmax != booked.getXmax()) return false;
+    result = booked.cloneEmpty();
+    return result.setContents(sumw, sumw2, entries);
+}
+
+static void putHist2D(std::ostream& out, const FastHist2D& h) {
+    putString(out, h.getName());
+    put(out, h.getNbinsX());
+    put(out, h.getXmin());
+    put(out, h.getXmax());
+    put(out, h.getNbinsY());
+    put(out, h.getYmin());
+    put(out, h.getYmax());
+    put(out, h.getEntries());
+    putVector(out, h.getSumw());
+    putVector(out, h.getSumw2());
+}
+
+static bool getHist2D(std::istream& in, const FastHist2D& booked, FastHist2D& result) {
+    std::string name;
+    int nx = 0, ny = 0;
+    double xmin = 0, xmax = 0, ymin = 0, ymax = 0;
+    long long entries = 0;
+    std::vector<double> sumw, sumw2;
+    if (!getString(in, name) || !get(in, nx) || !get(in, xmin) || !get(in, xmax) ||
+        !get(in, ny) || !get(in, ymin) || !get(in, ymax) || !get(in, entries) ||
+        !getVector(in, sumw) || !getVector(in, sumw2)) return false;
+    if (name != booked.getName() || nx != booked.getNbinsX() || ny != booked.getNbinsY() ||
+        xmin != booked.getXmin() || xmax != booked.getXmax() ||
+        ymin != booked.getYmin() || ymax != booked.getYmax()) return false;
+    result = booked.cloneEmpty();
+    return result.setContents(sumw, sumw2, entries);
+}
+
+// Histograms of a name -> hist map, in map order
+static void putHistMap(std::ostream& out, const std::map<std::string, FastHist1D>& hs) {
+    put<uint32_t>(out, static_cast<uint32_t>(hs.size()));
+    for (auto& [name, h] : hs) {
+        putString(out, name);
+        putHist(out, h);
+    }
+}
+
+static bool getHistMap(std::istream& in, const std::map<std::string, FastHist1D>& booked,
+                       std::map<std::string, FastHist1D>& result) {
+    uint32_t n = 0;
+    if (!get(in, n) || n != booked.size()) return false;
+    for (uint32_t i = 0; i < n; ++i) {
+        std::string name;
+        if (!getString(in, name)) return false;
+        auto it = booked.find(name);
+        if (it == booked.end() || !getHist(in, it->second, result[name])) return false;
+    }
+    return true;
+}
+
+// Consume a putHistMap + putHist2D block without a booked layout
+static bool skipSchemeHists(std::istream& in) {
+    uint32_t n = 0;
+    if (!get(in, n)) return false;
+    std::string name;
+    int nbins = 0;
+    double lo = 0, hi = 0;
+    long long entries = 0;
+    std::vector<double> v;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!getString(in, name) || !getString(in, name) || !get(in, nbins) || !get(in, lo) ||
+            !get(in, hi) || !get(in, entries) || !getVector(in, v) || !getVector(in, v)) return false;
+    }
+    return getString(in, name) && get(in, nbins) && get(in, lo) && get(in, hi) && get(in, nbins) &&
+           get(in, lo) && get(in, hi) && get(in, entries) && getVector(in, v) && getVector(in, v);
+}
+
+void writeCommon(std::ostream& out, const HistogramSet& hists) {
+    putHistMap(out, hists.common);
+}
+
+bool readCommon(std::istream& in, HistogramSet& hists) {
+    std::map<std::string, FastHist1D> common;
+    if (!getHistMap(in, hists.common, common)) return false;
+    hists.common = std::move(common);
+    return true;
+}
+
+void writeScheme(std::ostream& out, const HistogramSet& hists, const std::string& schemeKey) {
+    const Cutflow& cf = hists.cutflows.at(schemeKey);
+    put<uint32_t>(out, static_cast<uint32_t>(cf.steps.size()));
+    for (auto& s : cf.steps) {
+        putString(out, s.label);
+        put(out, s.nEvents);
+        put(out, s.sumW.value());
+        put(out, s.sumW2.value());
+    }
+
+    auto it = hists.scheme.find(schemeKey);
+    bool hasHists = it != hists.scheme.end();
+    put<uint8_t>(out, hasHists ? 1 : 0);
+    if (hasHists) {
+        putHistMap(out, it->second);
+        putHist2D(out, hists.massPlane.at(schemeKey));
+    }
+
+    auto sp = hists.sparse.find(schemeKey);
+    bool hasSparse = sp != hists.sparse.end();
+    put<uint8_t>(out, hasSparse ? 1 : 0);
+    if (hasSparse) sp->second.write(out);
+
+    auto ub = hists.unbinned.find(schemeKey);
+    bool hasUnbinned = ub != hists.unbinned.end();
+    put<uint8_t>(out, hasUnbinned ? 1 : 0);
+    if (hasUnbinned) putUnbinned(out, ub->second);
+}
+
+bool readScheme(std::istream& in, HistogramSet& hists, const std::string& schemeKey) {
+    auto cfIt = hists.cutflows.find(schemeKey);
+    if (cfIt == hists.cutflows.end()) return false;
+
+    Cutflow cf = cfIt->second;
+    uint32_t nSteps = 0;
+    if (!get(in, nSteps) || nSteps != cf.steps.size()) return false;
+    for (auto& s : cf.steps) {
+        std::string label;
+        if (!getString(in, label) || label != s.label) return false;
+        double sumW = 0, sumW2 = 0;
+        if (!get(in, s.nEvents) || !get(in, sumW) || !get(in, sumW2)) return false;
+        s.sumW = ExactSum(sumW);
+        s.sumW2 = ExactSum(sumW2);
+    }
+
+    // Histograms: needed only if this run books them
+    uint8_t hasHists = 0;
+    if (!get(in, hasHists)) return false;
+    auto hsIt = hists.scheme.find(schemeKey);
+    std::map<std::string, FastHist1D> hs;
+    FastHist2D plane;
+    if (hsIt != hists.scheme.end()) {
+        if (!hasHists) return false;
+        if (!getHistMap(in, hsIt->second, hs)) return false;
+        if (!getHist2D(in, hists.massPlane.at(schemeKey), plane)) return false;
+    } else if (hasHists && !skipSchemeHists(in)) {
+        return false;
+    }
+
+    // Sparse store and unbinned events: same rule; stored ones this run does
+    // not want are skipped
+    uint8_t hasSparse = 0;
+    if (!get(in, hasSparse)) return false;
+    auto spIt = hists.sparse.find(schemeKey);
+    SparseHist sparse;
+    if (spIt != hists.sparse.end() && !hasSparse) return false;
+    if (hasSparse && !sparse.read(in)) return false;
+    if (spIt != hists.sparse.end() && !sparse.sameAxes(spIt->second)) return false;
+
+    uint8_t hasUnbinned = 0;
+    if (!get(in, hasUnbinned)) return false;
+    auto ubIt = hists.unbinned.find(schemeKey);
+    UnbinnedEvents unbinned;
+    if (ubIt != hists.unbinned.end() && !hasUnbinned) return false;
+    if (hasUnbinned && !getUnbinned(in, unbinned)) return false;
+
+    if (hsIt != hists.scheme.end()) {
+        hsIt->second = std::move(hs);
+        hists.massPlane[schemeKey] = std::move(plane);
+    }
+    if (spIt != hists.sparse.end()) spIt->second = std::move(sparse);
+    if (ubIt != hists.unbinned.end()) ubIt->second = std::move(unbinned);
+    cfIt->second = std::move(cf);
+    return true;
+}
+
+void writeHistogramSet(std::ostream& out, const HistogramSet& hists) {
+    put<uint8_t>(out, hists.common.empty() ? 0 : 1);
+    if (!hists.common.empty()) writeCommon(out, hists);
+    put<uint32_t>(out, static_cast<uint32_t>(hists.cutflows.size()));
+    for (auto& [key, cf] : hists.cutflows) {
+        putString(out, key);
+        writeScheme(out, hists, key);
+    }
+}
+
+bool readHistogramSet(std::istream& in, HistogramSet& hists) {
+    // Read into a copy so a bad entry leaves hists unchanged
+    HistogramSet result = hists;
+    uint8_t hasCommon = 0;
+    if (!get(in, hasCommon) || hasCommon != (result.common.empty() ? 0 : 1)) return false;
+    if (hasCommon && !readCommon(in, result)) return false;
+    uint32_t nSchemes = 0;
+    if (!get(in, nSchemes) || nSchemes != result.cutflows.size()) return false;
+    for (uint32_t i = 0; i < nSchemes; ++i) {
+        std::string key;
+        if (!getString(in, key) || !readScheme(in, result, key)) return false;
+    }
+    hists = std::move(result);
+    return true;
+}
+
+bool writeFileAtomic(const std::string& path, const std::function<void(std::ostream&)>& write) {
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "ERROR: Cannot write " << tmp << std::endl;
+            return false;
+        }
+        write(out);
+        if (!out) {
+            std::cerr << "ERROR: Cannot write " << tmp << std::endl;
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "ERROR: Cannot move " << tmp << " to " << path << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ResultCache
+// ---------------------------------------------------------------------------
+ResultCache::ResultCache(const std::string& dir, const std::vector<std::string>& files,
+                         const SelectionCuts& cuts, bool doBlind, uint64_t modelKey)
+    : dir_(dir), inputKey_(fingerprintInputs(files)), cutsKey_(hashCuts(cuts)),
+      modelKey_(modelKey), doBlind_(doBlind) {}
+
+std::string ResultCache::entryPath(uint64_t key) const {
+    std::ostringstream oss;
+    oss << dir_ << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".hhc";
+    return oss.str();
+}
+
+uint64_t ResultCache::commonKey() const {
+    uint64_t h = hashString("common");
+    h = hashValue(inputKey_, h);
+    return hashValue(doBlind_, h);
+}
+
+uint64_t ResultCache::schemeKey(const std::string& key) const {
+    uint64_t h = hashString("scheme:" + key);
+    h = hashValue(inputKey_, h);
+    h = hashValue(cutsKey_, h);
+    if (modelKey_ != 0) h = hashValue(modelKey_, h);
+    return hashValue(doBlind_, h);
+}
+
+bool ResultCache::load(uint64_t key, const std::function<bool(std::istream&)>& read) const {
+    std::ifstream in(entryPath(key), std::ios::binary);
+    if (!in) return false;
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kCacheMagic)) return false;
+    if (!get(in, version) || version != kCacheVersion) return false;
+    if (!get(in, storedKey) || storedKey != key) return false;
+    return read(in);
+}
+
+bool ResultCache::store(uint64_t key, const std::function<void(std::ostream&)>& write) const {
+    ensureDirectory(dir_);
+    return writeFileAtomic(entryPath(key), [&](std::ostream& out) {
+        out.write(kCacheMagic, 4);
+        put(out, kCacheVersion);
+        put(out, key);
+        write(out);
+    });
+}
+
+bool ResultCache::loadCommon(HistogramSet& hists) const {
+    return load(commonKey(), [&](std::istream& in) { return readCommon(in, hists); });
+}
+
+bool ResultCache::loadScheme(const std::string& key, HistogramSet& hists) const {
+    return load(schemeKey(key), [&](std::istream& in) { return readScheme(in, hists, key); });
+}
+
+bool ResultCache::storeCommon(const HistogramSet& hists) const {
+    return store(commonKey(), [&](std::ostream& out) { writeCommon(out, hists); });
+}
+
+bool ResultCache::storeScheme(const std::string& key, const HistogramSet& hists) const {
+    return store(schemeKey(key), [&](std::ostream& out) { writeScheme(out, hists, key); });
+}
+
+// ---------------------------------------------------------------------------
+// Incremental runs
+// ---------------------------------------------------------------------------
+static constexpr uint32_t kStateVersion = 4;
+static const char kStateMagic[4] = {'H', 'H', 'S', 'T'};
+static const char* const kStateIndex = "state.hhs";
+
+// Words at a time: a whole Parquet file goes through it
+static uint64_t hashStream(std::istream& in, uint64_t h) {
+    std::vector<uint64_t> buf((1 << 20) / sizeof(uint64_t));
+    while (in) {
+        in.read(reinterpret_cast<char*>(buf.data()),
+                static_cast<std::streamsize>(buf.size() * sizeof(uint64_t)));
+        std::size_t n = static_cast<std::size_t>(in.gcount());
+        std::size_t words = n / sizeof(uint64_t);
+        for (std::size_t i = 0; i < words; ++i) {
+            h = (h ^ buf[i]) * 0x100000001b3ULL;
+            h ^= h >> 29;
+        }
+        h = hashBytes(reinterpret_cast<const char*>(buf.data()) + words * sizeof(uint64_t),
+                      n - words * sizeof(uint64_t), h);
+    }
+    return h;
+}
+
+uint64_t checksumFile(const std::string& path) {
+    if (isParquetPath(path)) {
+        if (path.find("://") != std::string::npos) return 0;
+        std::ifstream in(path, std::ios::binary);
+        return in ? hashStream(in, hashString("parquet")) : 0;
+    }
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+    if (!file || file->IsZombie()) return 0;
+    uint64_t h = hashValue(static_cast<long long>(file->GetSize()));
+    h = hashValue(file->GetModificationDate().Get(), h);
+    TIter next(file->GetListOfKeys());
+    while (TKey* key = static_cast<TKey*>(next())) {
+        h = hashString(key->GetName(), h);
+        h = hashValue(key->GetCycle(), h);
+        h = hashValue(key->GetDatime().Get(), h);
+        h = hashValue(key->GetSeekKey(), h);
+        h = hashValue(key->GetNbytes(), h);
+    }
+    return h;
+}
+
+// Everything that changes what a file contributes
+static uint64_t stateConfigKey(const RunOptions& opts, const SelectionCuts& cuts) {
+    uint64_t h = hashString("state");
+    h = hashValue(hashCuts(cuts), h);
+    h = hashValue(opts.doBlind, h);
+    h = hashValue(opts.fillHistograms, h);
+    h = hashValue(opts.fillCommon, h);
+    if (opts.modelKey != 0) h = hashValue(opts.modelKey, h);
+    for (auto& key : opts.schemeKeys) h = hashString(key, h);
+    return h;
+}
+
+static bool sameInput(const StateFileRecord& a, const StateFileRecord& b) {
+    return a.fp.path == b.fp.path && a.fp.size == b.fp.size && a.fp.uuid == b.fp.uuid &&
+           a.checksum == b.checksum;
+}
+
+static void putRecord(std::ostream& out, const StateFileRecord& r) {
+    putString(out, r.fp.path);
+    put(out, r.fp.size);
+    put(out, r.fp.mtime);
+    putString(out, r.fp.uuid);
+    put(out, r.checksum);
+    putString(out, r.part);
+}
+
+static bool getRecord(std::istream& in, StateFileRecord& r) {
+    return getString(in, r.fp.path) && get(in, r.fp.size) && get(in, r.fp.mtime) &&
+           getString(in, r.fp.uuid) && get(in, r.checksum) && getString(in, r.part);
+}
+
+static void putStateHeader(std::ostream& out, uint64_t config) {
+    out.write(kStateMagic, 4);
+    put(out, kStateVersion);
+    put(out, config);
+}
+
+static bool getStateHeader(std::istream& in, uint64_t config) {
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t storedConfig = 0;
+    return in.read(magic, 4) && std::equal(magic, magic + 4, kStateMagic) &&
+           get(in, version) && version == kStateVersion &&
+           get(in, storedConfig) && storedConfig == config;
+}
+
+// Index: header, file records, then the sum of all their results
+static bool loadStateIndex(const std::string& dir, uint64_t config,
+                           std::vector<StateFileRecord>& records, HistogramSet& total) {
+    std::ifstream in(dir + "/" + kStateIndex, std::ios::binary);
+    if (!in || !getStateHeader(in, config)) return false;
+    uint32_t n = 0;
+    if (!get(in, n)) return false;
+    std::vector<StateFileRecord> result(n);
+    for (auto& r : result) {
+        if (!getRecord(in, r)) return false;
+    }
+    if (!readHistogramSet(in, total)) return false;
+    records = std::move(result);
+    return true;
+}
+
+static bool storeStateIndex(const std::string& dir, uint64_t config,
+                            const std::vector<StateFileRecord>& records, const HistogramSet& total) {
+    return writeFileAtomic(dir + "/" + kStateIndex, [&](std::ostream& out) {
+        putStateHeader(out, config);
+        put<uint32_t>(out, static_cast<uint32_t>(records.size()));
+        for (auto& r : records) putRecord(out, r);
+        writeHistogramSet(out, total);
+    });
+}
+
+static std::string partName(const StateFileRecord& r, uint64_t config) {
+    uint64_t h = hashString(r.fp.path);
+    h = hashValue(r.checksum, h);
+    h = hashString(r.fp.uuid, h);
+    h = hashValue(config, h);
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << h << ".hhp";
+    return oss.str();
+}
+
+static bool loadPart(const std::string& dir, const StateFileRecord& r, uint64_t config,
+                     HistogramSet& hists) {
+    std::ifstream in(dir + "/" + r.part, std::ios::binary);
+    return in && getStateHeader(in, config) && readHistogramSet(in, hists);
+}
+
+RunReport runIncremental(const std::string& dir, const RunOptions& opts,
+                         const EventSelector& selector, HistogramSet& hists) {
+    ensureDirectory(dir);
+    uint64_t config = stateConfigKey(opts, selector.getCuts());
+
+    std::vector<StateFileRecord> saved;
+    HistogramSet savedTotal = hists;
+    if (!loadStateIndex(dir, config, saved, savedTotal)) {
+        if (fileExists(dir + "/" + kStateIndex)) {
+            std::cout << "State in " << dir << " was made with other settings, rebuilding"
+                      << std::endl;
+        }
+        saved.clear();
+        savedTotal = hists;
+    }
+    std::map<std::string, const StateFileRecord*> byPath;
+    for (auto& r : saved) byPath[r.fp.path] = &r;
+
+    // Classify the inputs
+    std::vector<StateFileRecord> current(opts.files.size());
+    std::vector<char> reuse(opts.files.size(), 0);
+    int nChanged = 0;
+    for (size_t f = 0; f < opts.files.size(); ++f) {
+        StateFileRecord& r = current[f];
+        r.fp = fingerprintFile(opts.files[f]);
+        r.checksum = checksumFile(opts.files[f]);
+        auto it = byPath.find(r.fp.path);
+        if (it == byPath.end()) continue;
+        if (sameInput(*it->second, r)) {
+            r = *it->second;
+            reuse[f] = 1;
+        } else {
+            ++nChanged;
+        }
+    }
+    int nReused = static_cast<int>(std::count(reuse.begin(), reuse.end(), 1));
+    int nDropped = static_cast<int>(saved.size()) - nReused - nChanged;
+
+    // Saved total minus nothing: add the new files to it. Otherwise rebuild
+    // the total from the parts of the files that are kept.
+    HistogramSet total = savedTotal;
+    if (nChanged > 0 || nDropped > 0) {
+        total = *hists.cloneEmpty();
+        for (size_t f = 0; f < opts.files.size(); ++f) {
+            if (!reuse[f]) continue;
+            HistogramSet part = *hists.cloneEmpty();
+            if (loadPart(dir, current[f], config, part)) {
+                total.add(part);
+            } else {
+                reuse[f] = 0;
+                --nReused;
+            }
+        }
+    }
+    std::cout << "State:   " << nReused << " file(s) unchanged, "
+              << opts.files.size() - nReused << " to process";
+    if (nChanged > 0) std::cout << " (" << nChanged << " changed)";
+    if (nDropped > 0) std::cout << ", " << nDropped << " no longer listed";
+    std::cout << " (" << dir << ")" << std::endl;
+
+    RunOptions delta = opts;
+    delta.files.clear();
+    std::vector<size_t> deltaIndex;
+    for (size_t f = 0; f < opts.files.size(); ++f) {
+        if (!reuse[f]) {
+            delta.files.push_back(opts.files[f]);
+            deltaIndex.push_back(f);
+        }
+    }
+
+    RunReport report;
+    if (!delta.files.empty()) {
+        std::vector<std::unique_ptr<HistogramSet>> perFile;
+        HistogramSet deltaTotal = *hists.cloneEmpty();
+        report = runEventLoop(delta, selector, deltaTotal, &perFile);
+        for (size_t i = 0; i < delta.files.size(); ++i) {
+            if (!report.fileOk[i]) continue;
+            StateFileRecord& r = current[deltaIndex[i]];
+            r.part = partName(r, config);
+            // A part that cannot be written is recomputed on the next rebuild
+            writeFileAtomic(dir + "/" + r.part, [&](std::ostream& out) {
+                putStateHeader(out, config);
+                writeHistogramSet(out, *perFile[i]);
+            });
+            total.add(*perFile[i]);
+            reuse[deltaIndex[i]] = 1;
+        }
+    }
+    report.nFilesReused = nReused;
+
+    std::vector<StateFileRecord> records;
+    for (size_t f = 0; f < opts.files.size(); ++f) {
+        if (reuse[f]) records.push_back(current[f]);
+    }
+    if (storeStateIndex(dir, config, records, total)) {
+        // Parts of files that were dropped or changed are no longer needed
+        std::set<std::string> live;
+        for (auto& r : records) live.insert(r.part);
+        std::error_code ec;
+        for (auto& entry : fs::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            if (entry.path().extension() == ".hhp" && !live.count(name)) fs::remove(entry.path(), ec);
+        }
+    } else {
+        std::cerr << "WARNING: Could not save the state in " << dir << std::endl;
+    }
+
+    hists = std::move(total);
+    return report;
+}
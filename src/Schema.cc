@@ -0,0 +1,97 @@
+#include "Schema.h"
+#include "LeafTypes.h"
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+bool readSchema(const std::string& path, ColumnTypes& types) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "ERROR: Cannot read schema " << path << std::endl;
+        return false;
+    }
+    ColumnTypes result;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        std::istringstream iss(line.substr(0, line.find('#')));
+        std::vector<std::string> tokens;
+        for (std::string t; iss >> t;) tokens.push_back(t);
+        if (tokens.empty() || tokens[0].back() == ':') continue;
+
+        // The type follows the last '/' of the last token, or is the last token
+        std::string name = tokens[0], last = tokens.back();
+        std::string type = last.substr(last.rfind('/') + 1);
+        if (tokens.size() == 1) name = last.substr(0, last.rfind('/'));
+        if (type.size() != 1 || leafTypeSize(type[0]) == 0 || name.empty()) {
+            std::cerr << "ERROR: " << path << ":" << lineNo << ": cannot parse '" << line << "'"
+                      << std::endl;
+            return false;
+        }
+        result[name] = type[0];
+    }
+    types = std::move(result);
+    return true;
+}
+
+bool writeSchema(const std::string& path, const std::vector<std::string>& names,
+                 const ColumnTypes& types) {
+    std::ofstream out(path);
+    out << "Branches: " << names.size() << "\n";
+    for (auto& name : names) {
+        auto it = types.find(name);
+        out << name << " : " << name << "/" << (it == types.end() ? 'D' : it->second) << "\n";
+    }
+    if (!out) {
+        std::cerr << "ERROR: Cannot write schema " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ColumnStats::add(double v) {
+    if (n == 0) {
+        min = max = v;
+    } else {
+        if (v < min) min = v;
+        if (v > max) max = v;
+    }
+    ++n;
+    if (integral && !(std::isfinite(v) && v == std::floor(v))) integral = false;
+    if (floatExact && !(static_cast<double>(static_cast<float>(v)) == v || v != v)) floatExact = false;
+}
+
+void ColumnStats::merge(const ColumnStats& other) {
+    if (other.n == 0) return;
+    if (n == 0) {
+        *this = other;
+        return;
+    }
+    n += other.n;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    integral = integral && other.integral;
+    floatExact = floatExact && other.floatExact;
+}
+
+char ColumnStats::narrowestType() const {
+    if (n == 0) return 'D';
+    if (integral) {
+        constexpr double kExact = 9007199254740992.0; // 2^53: every integer up to it fits a double
+        if (min >= 0) {
+            if (max <= 255)          return 'b';
+            if (max <= 65535)        return 's';
+            if (max <= 4294967295.0) return 'i';
+            if (max <= kExact)       return 'l';
+        } else {
+            if (min >= -128 && max <= 127)                   return 'B';
+            if (min >= -32768 && max <= 32767)               return 'S';
+            if (min >= -2147483648.0 && max <= 2147483647.0) return 'I';
+            if (min >= -kExact && max <= kExact)             return 'L';
+        }
+    }
+    return floatExact ? 'F' : 'D';
+}
@@ -36,53 +36,74 @@ bool EventSelector::passBtagMultiplicity(const EventData& evt) const {
 }
 
 bool EventSelector::passSchemeFlag(const EventData& evt, const std::string& schemeKey) const {
-    if (schemeKey == "nonRes")              return evt.is_nonRes > 0.5;
-    if (schemeKey == "nonResReg")           return evt.is_nonResReg > 0.5;
-    if (schemeKey == "nonResReg_DNNpair")   return evt.is_nonResReg_DNNpair > 0.5;
-    if (schemeKey == "nonResReg_vbfpair")   return evt.is_nonResReg_vbfpair > 0.5;
-    if (schemeKey == "Res")                 return evt.is_Res > 0.5;
-    if (schemeKey == "Res_DNNpair")         return evt.is_Res_DNNpair > 0.5;
-    return false;
+    int idx = schemeIndex(schemeKey);
+    return idx >= 0 && passSchemeFlag(evt, static_cast<SchemeId>(idx));
 }
 
 bool EventSelector::passSideband(const EventData& evt) const {
-    return evt.mass < BLIND_LOW || evt.mass > BLIND_HIGH;
+    return passSideband(evt, BLIND_LOW, BLIND_HIGH);
 }
 
 bool EventSelector::passSignalRegion(const EventData& evt) const {
-    return evt.mass >= BLIND_LOW && evt.mass <= BLIND_HIGH;
+    return passSignalRegion(evt, BLIND_LOW, BLIND_HIGH);
 }
 
-bool EventSelector::passPreselection(const EventData& evt, const SchemeData& sd,
-                                     const std::string& schemeKey) const {
-    if (!passSchemeFlag(evt, schemeKey)) return false;
+bool EventSelector::passSideband(const EventData& evt, double blindLow, double blindHigh) const {
+    return evt.mass < blindLow || evt.mass > blindHigh;
+}
+
+bool EventSelector::passSignalRegion(const EventData& evt, double blindLow, double blindHigh) const {
+    return evt.mass >= blindLow && evt.mass <= blindHigh;
+}
+
+bool EventSelector::passCommonCuts(const EventData& evt, const std::string& schemeKey) const {
+    int idx = schemeIndex(schemeKey);
+    return idx >= 0 && passCommonCuts(evt, static_cast<SchemeId>(idx));
+}
+
+bool EventSelector::passCommonCuts(const EventData& evt, SchemeId id) const {
+    if (!passSchemeFlag(evt, id))       return false;
     if (!passDiphotonMass(evt))         return false;
     if (!passPhotonPt(evt))             return false;
     if (!passPhotonMvaId(evt))          return false;
+    return true;
+}
+
+bool EventSelector::passSchemeCuts(const SchemeData& sd) const {
     if (!passDijetMass(sd))             return false;
     if (!passBjetPt(sd))                return false;
     return true;
 }
 
-void EventSelector::printCutflow(DataLoader& loader, const std::string& schemeKey) const {
-    const auto& schemes = getSchemes();
-    auto it = schemes.find(schemeKey);
-    if (it == schemes.end()) {
-        std::cerr << "ERROR: Unknown scheme '" << schemeKey << "' for cutflow" << std::endl;
-        return;
+bool EventSelector::passPreselection(const EventData& evt, const SchemeData& sd,
+                                     const std::string& schemeKey) const {
+    return passCommonCuts(evt, schemeKey) && passSchemeCuts(sd);
+}
+
+bool EventSelector::passPreselection(const EventData& evt, const SchemeData& sd,
+                                     SchemeId id) const {
+    return passCommonCuts(evt, id) && passSchemeCuts(sd);
+}
+
+void Cutflow::add(const Cutflow& other) {
+    for (size_t i = 0; i < steps.size() && i < other.steps.size(); ++i) {
+        steps[i].nEvents += other.steps[i].nEvents;
+        steps[i].sumW    += other.steps[i].sumW;
+        steps[i].sumW2   += other.steps[i].sumW2;
     }
+}
 
-    // Set up a temporary SchemeData for this cutflow
-    EventData evt;
-    SchemeData sd;
-    loader.setupBranches(evt);
-    loader.setupSchemeBranches(sd, schemeKey);
+void Cutflow::reset() {
+    for (auto& s : steps) {
+        s.nEvents = 0;
+        s.sumW = s.sumW2 = ExactSum();
+    }
+}
 
-    struct CutInfo {
-        std::string label;
-        int count = 0;
-    };
-    std::vector<CutInfo> cutflow = {
+Cutflow EventSelector::makeCutflow(const std::string& schemeKey) const {
+    Cutflow cf;
+    cf.schemeKey = schemeKey;
+    cf.steps = {
         {"Total events"},
         {"Scheme flag (" + schemeKey + ")"},
         {"m_{gg} in [" + std::to_string((int)cuts_.mggMin) + "," + std::to_string((int)cuts_.mggMax) + "]"},
@@ -91,46 +112,85 @@ void EventSelector::printCutflow(DataLoader& loader, const std::string& schemeKe
         {"m_{jj} in [" + std::to_string((int)cuts_.mjjMin) + "," + std::to_string((int)cuts_.mjjMax) + "]"},
         {"b-jet pT > " + std::to_string((int)cuts_.bjetPtMin) + " GeV"},
     };
+    return cf;
+}
+
+bool EventSelector::fillCutflow(Cutflow& cf, const EventData& evt, const SchemeData& sd,
+                                const std::string& schemeKey, double w) const {
+    return fillCutflowCommon(cf, evt, schemeKey, w) && fillCutflowScheme(cf, sd, w);
+}
+
+bool EventSelector::fillCutflow(Cutflow& cf, const EventData& evt, const SchemeData& sd,
+                                SchemeId id, double w) const {
+    return fillCutflowCommon(cf, evt, id, w) && fillCutflowScheme(cf, sd, w);
+}
+
+bool EventSelector::fillCutflowCommon(Cutflow& cf, const EventData& evt,
+                                      const std::string& schemeKey, double w) const {
+    int idx = schemeIndex(schemeKey);
+    if (idx < 0) {
+        cf.record(0, w); // Total
+        return false;
+    }
+    return fillCutflowCommon(cf, evt, static_cast<SchemeId>(idx), w);
+}
+
+bool EventSelector::fillCutflowCommon(Cutflow& cf, const EventData& evt, SchemeId id,
+                                      double w) const {
+    size_t step = 0;
+    cf.record(step++, w); // Total
+
+    if (!passSchemeFlag(evt, id)) return false;
+    cf.record(step++, w);
 
-    Long64_t nEntries = loader.getEntries();
-    for (Long64_t i = 0; i < nEntries; ++i) {
-        loader.getEntry(i);
+    if (!passDiphotonMass(evt)) return false;
+    cf.record(step++, w);
 
-        int step = 0;
-        cutflow[step++].count++; // Total
+    if (!passPhotonPt(evt)) return false;
+    cf.record(step++, w);
 
-        if (!passSchemeFlag(evt, schemeKey)) continue;
-        cutflow[step++].count++;
+    if (!passPhotonMvaId(evt)) return false;
+    cf.record(step++, w);
+
+    return true;
+}
 
-        if (!passDiphotonMass(evt)) continue;
-        cutflow[step++].count++;
+bool EventSelector::fillCutflowScheme(Cutflow& cf, const SchemeData& sd, double w) const {
+    size_t step = kFirstSchemeStep;
 
-        if (!passPhotonPt(evt)) continue;
-        cutflow[step++].count++;
+    if (!passDijetMass(sd)) return false;
+    cf.record(step++, w);
 
-        if (!passPhotonMvaId(evt)) continue;
-        cutflow[step++].count++;
+    if (!passBjetPt(sd)) return false;
+    cf.record(step++, w);
 
-        if (!passDijetMass(sd)) continue;
-        cutflow[step++].count++;
+    return true;
+}
 
-        if (!passBjetPt(sd)) continue;
-        cutflow[step++].count++;
+void EventSelector::printCutflow(const Cutflow& cf) const {
+    const auto& schemes = getSchemes();
+    auto it = schemes.find(cf.schemeKey);
+    if (it == schemes.end() || cf.steps.empty()) {
+        std::cerr << "ERROR: Unknown scheme '" << cf.schemeKey << "' for cutflow" << std::endl;
+        return;
     }
 
-    // Print table
-    std::cout << "\n===== Cutflow: " << it->second.name << " (" << schemeKey << ") =====" << std::endl;
+    std::cout << "\n===== Cutflow: " << it->second.name << " (" << cf.schemeKey << ") =====" << std::endl;
     std::cout << std::left << std::setw(45) << "Cut"
               << std::right << std::setw(10) << "Events"
+              << std::setw(14) << "Sum w"
+              << std::setw(12) << "Err w"
               << std::setw(12) << "Eff (%)" << std::endl;
-    std::cout << std::string(67, '-') << std::endl;
+    std::cout << std::string(93, '-') << std::endl;
 
-    int total = cutflow[0].count;
-    for (auto& c : cutflow) {
-        double eff = (total > 0) ? 100.0 * c.count / total : 0.0;
+    long long total = cf.steps[0].nEvents;
+    for (auto& c : cf.steps) {
+        double eff = (total > 0) ? 100.0 * c.nEvents / total : 0.0;
         std::cout << std::left << std::setw(45) << c.label
-                  << std::right << std::setw(10) << c.count
-                  << std::setw(11) << std::fixed << std::setprecision(1) << eff << "%" << std::endl;
+                  << std::right << std::setw(10) << c.nEvents
+                  << std::setw(14) << std::fixed << std::setprecision(2) << c.sumW.value()
+                  << std::setw(12) << std::sqrt(c.sumW2.value())
+                  << std::setw(11) << std::setprecision(1) << eff << "%" << std::endl;
     }
     std::cout << std::endl;
 }
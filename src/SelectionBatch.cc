@@ -0,0 +1,250 @@
+// Batch (column-wise) preselection with runtime-dispatched AVX2 / AVX-512
+// kernels. Every kernel evaluates exactly the comparisons of the scalar
+// EventSelector::pass* methods, so the masks agree bit for bit.
+#include "Selection.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SELECTION_X86_SIMD 1
+#endif
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2:   return "AVX2";
+        default:                return "scalar";
+    }
+}
+
+// Scalar reference for one event (also used for the tails of SIMD blocks):
+// the number of cutflow steps after "Total events" it passes, in the order of
+// EventSelector::fillCutflow. Scheme steps count as passed when their
+// columns are not set.
+static constexpr int kAllSteps = 6;
+
+static inline int passedSteps(const SelectionColumns& c, const SelectionCuts& k, std::size_t i) {
+    double m = c.mass[i];
+    if (c.schemeFlag && c.schemeFlag[i] == 0) return 0;
+    if (!(m >= k.mggMin && m <= k.mggMax)) return 1;
+    if (m <= 0) return 2;
+    if (!((c.lead_pt[i] / m) > k.leadPtOverMgg && (c.sublead_pt[i] / m) > k.subleadPtOverMgg)) return 2;
+    if (!(c.lead_mvaID[i] > k.mvaIdMin && c.sublead_mvaID[i] > k.mvaIdMin)) return 3;
+    if (c.dijet_mass) {
+        double mjj = c.dijet_mass[i];
+        if (isSentinel(mjj)) return 4;
+        if (!(mjj >= k.mjjMin && mjj <= k.mjjMax)) return 4;
+    }
+    if (c.lead_bjet_pt && c.sublead_bjet_pt) {
+        double pt1 = c.lead_bjet_pt[i], pt2 = c.sublead_bjet_pt[i];
+        if (isSentinel(pt1) || isSentinel(pt2)) return 5;
+        if (!(pt1 > k.bjetPtMin && pt2 > k.bjetPtMin)) return 5;
+    }
+    return kAllSteps;
+}
+
+static inline bool passOne(const SelectionColumns& c, const SelectionCuts& k, std::size_t i) {
+    return passedSteps(c, k, i) == kAllSteps;
+}
+
+// Number of events in mask word w
+static inline std::size_t wordLength(const SelectionColumns& c, std::size_t w) {
+    return std::min<std::size_t>(64, c.n - w * 64);
+}
+
+static void batchScalar(const SelectionColumns& c, const SelectionCuts& k, uint64_t* mask) {
+    std::size_t nWords = (c.n + 63) / 64;
+    for (std::size_t w = 0; w < nWords; ++w) {
+        std::size_t base = w * 64, len = wordLength(c, w);
+        uint64_t bits = 0;
+        for (std::size_t j = 0; j < len; ++j) bits |= uint64_t(passOne(c, k, base + j)) << j;
+        mask[w] = bits;
+    }
+}
+
+#ifdef SELECTION_X86_SIMD
+// Helpers are target-attributed themselves so they inline into the kernels
+
+// |x - SENTINEL| < 0.1, as in isSentinel()
+__attribute__((target("avx2"))) static inline __m256d isSentinel4(__m256d x) {
+    __m256d d = _mm256_andnot_pd(_mm256_set1_pd(-0.0), _mm256_sub_pd(x, _mm256_set1_pd(SENTINEL)));
+    return _mm256_cmp_pd(d, _mm256_set1_pd(0.1), _CMP_LT_OQ);
+}
+
+// is_<scheme> == 0 for events [i, i + 4), as in passSchemeFlag
+__attribute__((target("avx2"))) static inline __m256d flagClear4(const unsigned char* p) {
+    int32_t bytes;
+    std::memcpy(&bytes, p, sizeof(bytes));
+    __m256i v = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bytes));
+    return _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, _mm256_setzero_si256()));
+}
+
+// The predicate is a template argument: the intrinsics need an immediate
+template <int Op>
+__attribute__((target("avx2"))) static inline __m256d cmp4(const double* p, double v) {
+    return _mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_set1_pd(v), Op);
+}
+
+// Pass bits of events [i, i + 4)
+__attribute__((target("avx2")))
+static inline uint64_t block4(const SelectionColumns& c, const SelectionCuts& k, std::size_t i) {
+    __m256d m = _mm256_loadu_pd(c.mass + i);
+    __m256d pass = _mm256_and_pd(cmp4<_CMP_GE_OQ>(c.mass + i, k.mggMin),
+                                 cmp4<_CMP_LE_OQ>(c.mass + i, k.mggMax));
+    if (c.schemeFlag) pass = _mm256_andnot_pd(flagClear4(c.schemeFlag + i), pass);
+    pass = _mm256_and_pd(pass, cmp4<_CMP_NLE_UQ>(c.mass + i, 0.0));
+    __m256d r1 = _mm256_div_pd(_mm256_loadu_pd(c.lead_pt + i), m);
+    __m256d r2 = _mm256_div_pd(_mm256_loadu_pd(c.sublead_pt + i), m);
+    pass = _mm256_and_pd(pass, _mm256_cmp_pd(r1, _mm256_set1_pd(k.leadPtOverMgg), _CMP_GT_OQ));
+    pass = _mm256_and_pd(pass, _mm256_cmp_pd(r2, _mm256_set1_pd(k.subleadPtOverMgg), _CMP_GT_OQ));
+    pass = _mm256_and_pd(pass, cmp4<_CMP_GT_OQ>(c.lead_mvaID + i, k.mvaIdMin));
+    pass = _mm256_and_pd(pass, cmp4<_CMP_GT_OQ>(c.sublead_mvaID + i, k.mvaIdMin));
+    if (c.dijet_mass) {
+        pass = _mm256_andnot_pd(isSentinel4(_mm256_loadu_pd(c.dijet_mass + i)), pass);
+        pass = _mm256_and_pd(pass, cmp4<_CMP_GE_OQ>(c.dijet_mass + i, k.mjjMin));
+        pass = _mm256_and_pd(pass, cmp4<_CMP_LE_OQ>(c.dijet_mass + i, k.mjjMax));
+    }
+    if (c.lead_bjet_pt && c.sublead_bjet_pt) {
+        __m256d sent = _mm256_or_pd(isSentinel4(_mm256_loadu_pd(c.lead_bjet_pt + i)),
+                                    isSentinel4(_mm256_loadu_pd(c.sublead_bjet_pt + i)));
+        pass = _mm256_andnot_pd(sent, pass);
+        pass = _mm256_and_pd(pass, cmp4<_CMP_GT_OQ>(c.lead_bjet_pt + i, k.bjetPtMin));
+        pass = _mm256_and_pd(pass, cmp4<_CMP_GT_OQ>(c.sublead_bjet_pt + i, k.bjetPtMin));
+    }
+    return uint64_t(_mm256_movemask_pd(pass));
+}
+
+__attribute__((target("avx2")))
+static void batchAVX2(const SelectionColumns& c, const SelectionCuts& k, uint64_t* mask) {
+    std::size_t nWords = (c.n + 63) / 64;
+    for (std::size_t w = 0; w < nWords; ++w) {
+        std::size_t base = w * 64, len = wordLength(c, w);
+        uint64_t bits = 0;
+        std::size_t j = 0;
+        for (; j + 4 <= len; j += 4) bits |= block4(c, k, base + j) << j;
+        for (; j < len; ++j) bits |= uint64_t(passOne(c, k, base + j)) << j;
+        mask[w] = bits;
+    }
+}
+
+__attribute__((target("avx512f"))) static inline __mmask8 isSentinel8(__m512d x) {
+    __m512d d = _mm512_abs_pd(_mm512_sub_pd(x, _mm512_set1_pd(SENTINEL)));
+    return _mm512_cmp_pd_mask(d, _mm512_set1_pd(0.1), _CMP_LT_OQ);
+}
+
+// is_<scheme> != 0 for events [i, i + 8)
+__attribute__((target("avx512f"))) static inline __mmask8 flagSet8(const unsigned char* p) {
+    __m512i v = _mm512_cvtepu8_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    return _mm512_test_epi64_mask(v, v);
+}
+
+template <int Op>
+__attribute__((target("avx512f"))) static inline __mmask8 cmp8(const double* p, double v) {
+    return _mm512_cmp_pd_mask(_mm512_loadu_pd(p), _mm512_set1_pd(v), Op);
+}
+
+// Pass bits of events [i, i + 8)
+__attribute__((target("avx512f")))
+static inline uint64_t block8(const SelectionColumns& c, const SelectionCuts& k, std::size_t i) {
+    __m512d m = _mm512_loadu_pd(c.mass + i);
+    __mmask8 pass = cmp8<_CMP_GE_OQ>(c.mass + i, k.mggMin) & cmp8<_CMP_LE_OQ>(c.mass + i, k.mggMax);
+    if (c.schemeFlag) pass &= flagSet8(c.schemeFlag + i);
+    pass &= cmp8<_CMP_NLE_UQ>(c.mass + i, 0.0);
+    __m512d r1 = _mm512_div_pd(_mm512_loadu_pd(c.lead_pt + i), m);
+    __m512d r2 = _mm512_div_pd(_mm512_loadu_pd(c.sublead_pt + i), m);
+    pass &= _mm512_cmp_pd_mask(r1, _mm512_set1_pd(k.leadPtOverMgg), _CMP_GT_OQ);
+    pass &= _mm512_cmp_pd_mask(r2, _mm512_set1_pd(k.subleadPtOverMgg), _CMP_GT_OQ);
+    pass &= cmp8<_CMP_GT_OQ>(c.lead_mvaID + i, k.mvaIdMin);
+    pass &= cmp8<_CMP_GT_OQ>(c.sublead_mvaID + i, k.mvaIdMin);
+    if (c.dijet_mass) {
+        pass &= ~isSentinel8(_mm512_loadu_pd(c.dijet_mass + i));
+        pass &= cmp8<_CMP_GE_OQ>(c.dijet_mass + i, k.mjjMin);
+        pass &= cmp8<_CMP_LE_OQ>(c.dijet_mass + i, k.mjjMax);
+    }
+    if (c.lead_bjet_pt && c.sublead_bjet_pt) {
+        pass &= ~(isSentinel8(_mm512_loadu_pd(c.lead_bjet_pt + i)) |
+                  isSentinel8(_mm512_loadu_pd(c.sublead_bjet_pt + i)));
+        pass &= cmp8<_CMP_GT_OQ>(c.lead_bjet_pt + i, k.bjetPtMin);
+        pass &= cmp8<_CMP_GT_OQ>(c.sublead_bjet_pt + i, k.bjetPtMin);
+    }
+    return uint64_t(pass);
+}
+
+__attribute__((target("avx512f")))
+static void batchAVX512(const SelectionColumns& c, const SelectionCuts& k, uint64_t* mask) {
+    std::size_t nWords = (c.n + 63) / 64;
+    for (std::size_t w = 0; w < nWords; ++w) {
+        std::size_t base = w * 64, len = wordLength(c, w);
+        uint64_t bits = 0;
+        std::size_t j = 0;
+        for (; j + 8 <= len; j += 8) bits |= block8(c, k, base + j) << j;
+        for (; j < len; ++j) bits |= uint64_t(passOne(c, k, base + j)) << j;
+        mask[w] = bits;
+    }
+}
+#endif
+
+SimdLevel EventSelector::detectSimdLevel() {
+#ifdef SELECTION_X86_SIMD
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2"))    return SimdLevel::AVX2;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+void EventSelector::passPreselectionBatch(const SelectionColumns& cols, uint64_t* mask) const {
+    passPreselectionBatch(cols, mask, detectSimdLevel());
+}
+
+void EventSelector::passPreselectionBatch(const SelectionColumns& cols, uint64_t* mask,
+                                          SimdLevel level) const {
+    // Never run an instruction set the CPU does not have
+    level = std::min(level, detectSimdLevel());
+#ifdef SELECTION_X86_SIMD
+    if (level == SimdLevel::AVX512) return batchAVX512(cols, cuts_, mask);
+    if (level == SimdLevel::AVX2)   return batchAVX2(cols, cuts_, mask);
+#endif
+    batchScalar(cols, cuts_, mask);
+}
+
+// ---------------------------------------------------------------------------
+// Column-wise cutflow
+// ---------------------------------------------------------------------------
+// The masks come from the SIMD kernels; only the events that fail are walked
+// again to find the step they stop at.
+void EventSelector::fillCutflowCommonBatch(Cutflow& cf, const SelectionColumns& cols,
+                                           const double* w, uint64_t* mask) const {
+    SelectionColumns common = cols;
+    common.dijet_mass = common.lead_bjet_pt = common.sublead_bjet_pt = nullptr;
+    passPreselectionBatch(common, mask);
+    for (std::size_t i = 0; i < cols.n; ++i) {
+        bool pass = (mask[i / 64] >> (i % 64)) & 1;
+        std::size_t steps = pass ? kFirstSchemeStep : 1 + passedSteps(common, cuts_, i);
+        for (std::size_t s = 0; s < steps; ++s) cf.record(s, w[i]);
+    }
+}
+
+void EventSelector::fillCutflowSchemeBatch(Cutflow& cf, const SelectionColumns& cols,
+                                           const double* w, uint64_t* mask) const {
+    std::size_t nWords = (cols.n + 63) / 64;
+    std::vector<uint64_t> full(nWords);
+    passPreselectionBatch(cols, full.data());
+    for (std::size_t wd = 0; wd < nWords; ++wd) {
+        for (uint64_t bits = mask[wd]; bits; bits &= bits - 1) {
+            std::size_t i = wd * 64 + __builtin_ctzll(bits);
+            bool pass = (full[wd] >> (i % 64)) & 1;
+            std::size_t steps = 1 + (pass ? kAllSteps : passedSteps(cols, cuts_, i));
+            for (std::size_t s = kFirstSchemeStep; s < steps; ++s) cf.record(s, w[i]);
+        }
+        mask[wd] &= full[wd];
+    }
+}
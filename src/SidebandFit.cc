@@ -0,0 +1,426 @@
+#include "SidebandFit.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+static constexpr int kMaxBernsteinOrder = 8;
+// Events per likelihood chunk; chunks are summed in order, so the result
+// does not depend on the thread count
+static constexpr std::size_t kChunk = 16384;
+
+bool parseBkgModel(const std::string& name, BkgModel& model) {
+    if (name == "exp") {
+        model = {BkgShape::Exponential, 0};
+    } else if (name == "pow") {
+        model = {BkgShape::PowerLaw, 0};
+    } else if (name.compare(0, 4, "bern") == 0 && name.size() > 4) {
+        char* end = nullptr;
+        long order = std::strtol(name.c_str() + 4, &end, 10);
+        if (*end != '\0' || order < 1 || order > kMaxBernsteinOrder) return false;
+        model = {BkgShape::Bernstein, static_cast<int>(order)};
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string bkgModelName(const BkgModel& model) {
+    switch (model.shape) {
+        case BkgShape::Exponential: return "exp";
+        case BkgShape::PowerLaw:    return "pow";
+        case BkgShape::Bernstein:   return "bern" + std::to_string(model.order);
+    }
+    return "?";
+}
+
+// ---------------------------------------------------------------------------
+// Shapes
+// ---------------------------------------------------------------------------
+static double binomial(int n, int k) {
+    double c = 1;
+    for (int i = 1; i <= k; ++i) c = c * (n - k + i) / i;
+    return c;
+}
+
+static double bernstein(int k, int n, double t) {
+    return binomial(n, k) * std::pow(t, k) * std::pow(1 - t, n - k);
+}
+
+// Integral of B_k,n over [0, T]: (1 / (n + 1)) sum_{j > k} B_j,n+1(T)
+static double bernsteinCdf(int k, int n, double T) {
+    double s = 0;
+    for (int j = k + 1; j <= n + 1; ++j) s += bernstein(j, n + 1, T);
+    return s / (n + 1);
+}
+
+// Integral of exp(a t) over [t1, t2] and its derivative in a; a short series
+// near a = 0, where the closed forms cancel
+static double expIntegral(double a, double t1, double t2, double* dA) {
+    if (std::fabs(a) < 1e-5) {
+        if (dA) *dA = (t2 * t2 - t1 * t1) / 2 + a * (t2 * t2 * t2 - t1 * t1 * t1) / 3;
+        return (t2 - t1) + a * (t2 * t2 - t1 * t1) / 2;
+    }
+    double e1 = std::exp(a * t1), e2 = std::exp(a * t2);
+    if (dA) *dA = (e2 * (t2 / a - 1 / (a * a))) - (e1 * (t1 / a - 1 / (a * a)));
+    return (e2 - e1) / a;
+}
+
+// Integral of u^a du over [u1, u2] and its derivative in a
+static double powIntegral(double a, double u1, double u2, double* dA) {
+    double b = a + 1, l1 = std::log(u1), l2 = std::log(u2);
+    if (std::fabs(b) < 1e-5) {
+        if (dA) *dA = (l2 * l2 - l1 * l1) / 2 + b * (l2 * l2 * l2 - l1 * l1 * l1) / 3;
+        return (l2 - l1) + b * (l2 * l2 - l1 * l1) / 2;
+    }
+    double p1 = std::exp(b * l1), p2 = std::exp(b * l2);
+    if (dA) *dA = (p2 * (l2 / b - 1 / (b * b))) - (p1 * (l1 / b - 1 / (b * b)));
+    return (p2 - p1) / b;
+}
+
+double SidebandFitter::integral(const BkgModel& model, const std::vector<double>& params,
+                                double t1, double t2, std::vector<double>* grad) const {
+    if (grad) grad->assign(params.size(), 0.0);
+    switch (model.shape) {
+        case BkgShape::Exponential:
+            return expIntegral(params[0], t1, t2, grad ? &(*grad)[0] : nullptr);
+        case BkgShape::PowerLaw: {
+            // u = 1 + scale t, dt = du / scale: normalised in t like the others
+            double scale = (opts_.fitHigh - opts_.fitLow) / opts_.fitLow;
+            double value = powIntegral(params[0], 1 + scale * t1, 1 + scale * t2, grad ? &(*grad)[0] : nullptr);
+            if (grad) (*grad)[0] /= scale;
+            return value / scale;
+        }
+        case BkgShape::Bernstein: {
+            int n = model.order;
+            double total = bernsteinCdf(0, n, t2) - bernsteinCdf(0, n, t1);
+            for (int k = 1; k <= n; ++k) {
+                double c = std::exp(params[k - 1]);
+                double term = c * (bernsteinCdf(k, n, t2) - bernsteinCdf(k, n, t1));
+                if (grad) (*grad)[k - 1] = term;
+                total += term;
+            }
+            return total;
+        }
+    }
+    return 0;
+}
+
+double SidebandFitter::sidebandIntegral(const BkgModel& model, const std::vector<double>& params,
+                                        std::vector<double>* grad) const {
+    std::vector<double> g1, g2;
+    double lower = integral(model, params, 0, tBlindLow_, grad ? &g1 : nullptr);
+    double upper = integral(model, params, tBlindHigh_, 1, grad ? &g2 : nullptr);
+    if (grad) {
+        grad->resize(params.size());
+        for (std::size_t p = 0; p < params.size(); ++p) (*grad)[p] = g1[p] + g2[p];
+    }
+    return lower + upper;
+}
+
+// ---------------------------------------------------------------------------
+// Likelihood
+// ---------------------------------------------------------------------------
+SidebandFitter::SidebandFitter(ColumnSpan<double> mgg, ColumnSpan<double> weight,
+                               const SidebandFitOptions& opts)
+    : opts_(opts) {
+    double blindLow = std::max(opts_.fitLow, std::min(opts_.blindLow, opts_.fitHigh));
+    double blindHigh = std::max(blindLow, std::min(opts_.blindHigh, opts_.fitHigh));
+    tBlindLow_ = toT(blindLow);
+    tBlindHigh_ = toT(blindHigh);
+    for (std::size_t i = 0; i < mgg.size(); ++i) {
+        double x = mgg[i];
+        if (!(x >= opts_.fitLow && x <= opts_.fitHigh) || (x >= blindLow && x <= blindHigh)) continue;
+        double w = weight.empty() ? 1.0 : weight[i];
+        t_.push_back(toT(x));
+        w_.push_back(w);
+        sumW_ += w;
+        sumW2_ += w * w;
+        sumWT_ += w * t_.back();
+        sumWLogU_ += w * std::log(x / opts_.fitLow);
+    }
+}
+
+SidebandFitter::Evaluation SidebandFitter::evaluate(const BkgModel& model, const std::vector<double>& params,
+                                                    const std::vector<std::vector<double>>& basis) const {
+    Evaluation e;
+    std::vector<double> dI;
+    double I = sidebandIntegral(model, params, &dI);
+    e.grad.assign(params.size(), 0.0);
+
+    if (model.shape != BkgShape::Bernstein) {
+        // log g is linear in the parameter: the data enter through one sum
+        double sum = model.shape == BkgShape::Exponential ? sumWT_ : sumWLogU_;
+        e.nll = -params[0] * sum + sumW_ * std::log(I);
+        e.grad[0] = -sum + sumW_ * dI[0] / I;
+        return e;
+    }
+
+    // Bernstein: per-event sum over the precomputed basis values, chunk by
+    // chunk across threads
+    int n = model.order;
+    std::vector<double> c(n + 1, 1.0);
+    for (int k = 1; k <= n; ++k) c[k] = std::exp(params[k - 1]);
+    std::size_t nChunks = (t_.size() + kChunk - 1) / kChunk;
+    std::vector<double> chunkNll(nChunks, 0.0);
+    std::vector<double> chunkGrad(nChunks * n, 0.0);
+
+    auto runChunk = [&](std::size_t chunk) {
+        std::size_t begin = chunk * kChunk, end = std::min(t_.size(), begin + kChunk);
+        std::size_t len = end - begin;
+        const double* w = w_.data() + begin;
+        std::vector<double> g(len, 0.0), r(len);
+        for (int k = 0; k <= n; ++k) {
+            const double* b = basis[k].data() + begin;
+            double ck = c[k];
+            for (std::size_t i = 0; i < len; ++i) g[i] += ck * b[i];
+        }
+        double nll = 0;
+        for (std::size_t i = 0; i < len; ++i) {
+            nll -= w[i] * std::log(g[i]);
+            r[i] = w[i] / g[i];
+        }
+        chunkNll[chunk] = nll;
+        for (int k = 1; k <= n; ++k) {
+            const double* b = basis[k].data() + begin;
+            double s = 0;
+            for (std::size_t i = 0; i < len; ++i) s += r[i] * b[i];
+            chunkGrad[chunk * n + (k - 1)] = s;
+        }
+    };
+
+    int nThreads = std::max(1, std::min<int>(opts_.threads, static_cast<int>(nChunks)));
+    if (nThreads == 1) {
+        for (std::size_t chunk = 0; chunk < nChunks; ++chunk) runChunk(chunk);
+    } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; ++t) {
+            threads.emplace_back([&, t] {
+                for (std::size_t chunk = t; chunk < nChunks; chunk += nThreads) runChunk(chunk);
+            });
+        }
+        for (auto& th : threads) th.join();
+    }
+
+    e.nll = sumW_ * std::log(I);
+    for (int k = 0; k < n; ++k) e.grad[k] = sumW_ * dI[k] / I;
+    for (std::size_t chunk = 0; chunk < nChunks; ++chunk) {
+        e.nll += chunkNll[chunk];
+        // d g / d p_k = c_k B_k
+        for (int k = 1; k <= n; ++k) e.grad[k - 1] -= c[k] * chunkGrad[chunk * n + (k - 1)];
+    }
+    return e;
+}
+
+// ---------------------------------------------------------------------------
+// Minimisation
+// ---------------------------------------------------------------------------
+// Inverse of a small symmetric matrix (Gauss-Jordan); false if singular
+static bool invert(std::vector<std::vector<double>> a, std::vector<std::vector<double>>& inv) {
+    std::size_t n = a.size();
+    inv.assign(n, std::vector<double>(n, 0.0));
+    for (std::size_t i = 0; i < n; ++i) inv[i][i] = 1;
+    for (std::size_t col = 0; col < n; ++col) {
+        std::size_t pivot = col;
+        for (std::size_t r = col + 1; r < n; ++r) {
+            if (std::fabs(a[r][col]) > std::fabs(a[pivot][col])) pivot = r;
+        }
+        if (std::fabs(a[pivot][col]) < 1e-300) return false;
+        std::swap(a[col], a[pivot]);
+        std::swap(inv[col], inv[pivot]);
+        double d = a[col][col];
+        for (std::size_t j = 0; j < n; ++j) {
+            a[col][j] /= d;
+            inv[col][j] /= d;
+        }
+        for (std::size_t r = 0; r < n; ++r) {
+            if (r == col || a[r][col] == 0) continue;
+            double f = a[r][col];
+            for (std::size_t j = 0; j < n; ++j) {
+                a[r][j] -= f * a[col][j];
+                inv[r][j] -= f * inv[col][j];
+            }
+        }
+    }
+    return true;
+}
+
+SidebandFitResult SidebandFitter::fit(const BkgModel& model) const {
+    auto t0 = std::chrono::steady_clock::now();
+    SidebandFitResult result;
+    result.model = model;
+    std::size_t np = static_cast<std::size_t>(model.nParams());
+    if (t_.empty() || sumW_ <= 0) return result;
+
+    // Basis values are fixed during the fit: computed once
+    std::vector<std::vector<double>> basis;
+    if (model.shape == BkgShape::Bernstein) {
+        int n = model.order;
+        basis.assign(n + 1, std::vector<double>(t_.size()));
+        std::vector<double> binom(n + 1), tk(n + 1), uk(n + 1);
+        for (int k = 0; k <= n; ++k) binom[k] = binomial(n, k);
+        for (std::size_t i = 0; i < t_.size(); ++i) {
+            tk[0] = uk[0] = 1;
+            for (int k = 1; k <= n; ++k) {
+                tk[k] = tk[k - 1] * t_[i];
+                uk[k] = uk[k - 1] * (1 - t_[i]);
+            }
+            for (int k = 0; k <= n; ++k) basis[k][i] = binom[k] * tk[k] * uk[n - k];
+        }
+    }
+
+    // BFGS with a backtracking (Armijo) line search, from a flat shape
+    std::vector<double> x(np, 0.0);
+    if (model.shape == BkgShape::PowerLaw) x[0] = -1;
+    Evaluation e = evaluate(model, x, basis);
+    ++result.evaluations;
+    std::vector<std::vector<double>> H(np, std::vector<double>(np, 0.0)); // inverse Hessian estimate
+    for (std::size_t i = 0; i < np; ++i) H[i][i] = 1.0 / sumW_;
+
+    auto gradNorm = [&](const std::vector<double>& g) {
+        double m = 0;
+        for (double v : g) m = std::max(m, std::fabs(v));
+        return m / sumW_;
+    };
+
+    for (int it = 0; it < opts_.maxIterations; ++it) {
+        if (gradNorm(e.grad) < opts_.tolerance) {
+            result.converged = true;
+            break;
+        }
+        result.iterations = it + 1;
+        std::vector<double> d(np, 0.0);
+        double slope = 0;
+        for (std::size_t i = 0; i < np; ++i) {
+            for (std::size_t j = 0; j < np; ++j) d[i] -= H[i][j] * e.grad[j];
+            slope += d[i] * e.grad[i];
+        }
+        if (slope >= 0) { // lost descent: restart from steepest descent
+            for (std::size_t i = 0; i < np; ++i) {
+                std::fill(H[i].begin(), H[i].end(), 0.0);
+                H[i][i] = 1.0 / sumW_;
+                d[i] = -e.grad[i] / sumW_;
+            }
+            slope = 0;
+            for (std::size_t i = 0; i < np; ++i) slope += d[i] * e.grad[i];
+        }
+
+        double step = 1;
+        std::vector<double> xn(np);
+        Evaluation en;
+        bool accepted = false;
+        for (int ls = 0; ls < 50; ++ls, step *= 0.5) {
+            for (std::size_t i = 0; i < np; ++i) xn[i] = x[i] + step * d[i];
+            en = evaluate(model, xn, basis);
+            ++result.evaluations;
+            if (std::isfinite(en.nll) && en.nll <= e.nll + 1e-4 * step * slope) {
+                accepted = true;
+                break;
+            }
+        }
+        if (!accepted) break;
+
+        // BFGS update of the inverse Hessian
+        std::vector<double> s(np), y(np), Hy(np, 0.0);
+        double sy = 0;
+        for (std::size_t i = 0; i < np; ++i) {
+            s[i] = xn[i] - x[i];
+            y[i] = en.grad[i] - e.grad[i];
+            sy += s[i] * y[i];
+        }
+        if (sy > 1e-12) {
+            double yHy = 0;
+            for (std::size_t i = 0; i < np; ++i) {
+                for (std::size_t j = 0; j < np; ++j) Hy[i] += H[i][j] * y[j];
+                yHy += y[i] * Hy[i];
+            }
+            for (std::size_t i = 0; i < np; ++i) {
+                for (std::size_t j = 0; j < np; ++j) {
+                    H[i][j] += (sy + yHy) * s[i] * s[j] / (sy * sy) - (Hy[i] * s[j] + s[i] * Hy[j]) / sy;
+                }
+            }
+        }
+        bool stalled = std::fabs(e.nll - en.nll) < 1e-14 * (1 + std::fabs(e.nll));
+        x = xn;
+        e = std::move(en);
+        if (stalled) {
+            result.converged = gradNorm(e.grad) < 1e3 * opts_.tolerance;
+            break;
+        }
+    }
+    if (!result.converged && gradNorm(e.grad) < opts_.tolerance) result.converged = true;
+
+    // Covariance: inverse of the Hessian, from central differences of the
+    // analytic gradient
+    std::vector<std::vector<double>> hess(np, std::vector<double>(np, 0.0));
+    for (std::size_t k = 0; k < np; ++k) {
+        double h = 1e-4 * std::max(1.0, std::fabs(x[k]));
+        std::vector<double> xp = x, xm = x;
+        xp[k] += h;
+        xm[k] -= h;
+        Evaluation ep = evaluate(model, xp, basis), em = evaluate(model, xm, basis);
+        result.evaluations += 2;
+        for (std::size_t j = 0; j < np; ++j) hess[j][k] = (ep.grad[j] - em.grad[j]) / (2 * h);
+    }
+    for (std::size_t j = 0; j < np; ++j) {
+        for (std::size_t k = j + 1; k < np; ++k) hess[j][k] = hess[k][j] = (hess[j][k] + hess[k][j]) / 2;
+    }
+    result.params = x;
+    result.nll = e.nll;
+    result.errors.assign(np, 0.0);
+    if (invert(hess, result.covariance)) {
+        for (std::size_t k = 0; k < np; ++k) result.errors[k] = std::sqrt(std::max(0.0, result.covariance[k][k]));
+    } else {
+        result.covariance.clear();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Window yields
+// ---------------------------------------------------------------------------
+double SidebandFitter::fraction(const SidebandFitResult& result, double lo, double hi) const {
+    if (result.params.empty()) return 0;
+    return integral(result.model, result.params, toT(lo), toT(hi), nullptr) /
+           sidebandIntegral(result.model, result.params, nullptr);
+}
+
+WindowYield SidebandFitter::yield(const SidebandFitResult& result, double lo, double hi) const {
+    WindowYield y;
+    y.lo = std::max(lo, opts_.fitLow);
+    y.hi = std::min(hi, opts_.fitHigh);
+    if (y.hi <= y.lo || result.params.empty()) return y;
+    y.blinded = y.lo < opts_.blindHigh && y.hi > opts_.blindLow;
+    double t1 = toT(y.lo), t2 = toT(y.hi);
+
+    auto fractionAt = [&](const std::vector<double>& p) {
+        return integral(result.model, p, t1, t2, nullptr) / sidebandIntegral(result.model, p, nullptr);
+    };
+    double f = fractionAt(result.params);
+    y.expected = sumW_ * f;
+    y.statError = std::sqrt(sumW2_) * f;
+
+    if (!result.covariance.empty()) {
+        std::size_t np = result.params.size();
+        std::vector<double> df(np);
+        for (std::size_t k = 0; k < np; ++k) {
+            double h = 1e-5 * std::max(1.0, std::fabs(result.params[k]));
+            std::vector<double> pp = result.params, pm = result.params;
+            pp[k] += h;
+            pm[k] -= h;
+            df[k] = (fractionAt(pp) - fractionAt(pm)) / (2 * h);
+        }
+        double var = 0;
+        for (std::size_t j = 0; j < np; ++j) {
+            for (std::size_t k = 0; k < np; ++k) var += df[j] * result.covariance[j][k] * df[k];
+        }
+        y.shapeError = sumW_ * std::sqrt(std::max(0.0, var));
+    }
+
+    for (std::size_t i = 0; i < t_.size(); ++i) {
+        if (t_[i] >= t1 && t_[i] < t2) y.observed += w_[i];
+    }
+    return y;
+}
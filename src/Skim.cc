@@ -0,0 +1,257 @@
+#include "Skim.h"
+#include "DataLoader.h"
+#include "Schema.h"
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TObjArray.h>
+#include <fnmatch.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <deque>
+#include <map>
+#include <cstring>
+#include <cctype>
+
+char skimNarrowType(const std::string& branch) {
+    // Look at the '_'-separated tokens: is_X / X_has_Y are flags,
+    // n_X / nX / X_nY (capital after the n) are counts
+    std::vector<std::string> tokens;
+    std::istringstream iss(branch);
+    for (std::string t; std::getline(iss, t, '_');) tokens.push_back(t);
+    if (tokens.empty()) return 0;
+    bool flag = tokens[0] == "is";
+    bool count = tokens[0] == "n" && tokens.size() > 1;
+    for (auto& t : tokens) {
+        if (t == "has") flag = true;
+        if (t.size() > 1 && t[0] == 'n' && std::isupper(static_cast<unsigned char>(t[1]))) count = true;
+    }
+    if (!flag && !count) return 0;
+    // The type schema inference would pick for the values such a branch holds
+    ColumnStats range;
+    range.add(0);
+    range.add(flag ? 1 : 255);
+    return range.narrowestType();
+}
+
+// One branch of the output tree
+struct SkimColumn {
+    std::string name;
+    char        type = 'D';  // stored type
+    uint64_t    buffer = 0;  // the output branch address
+};
+
+// Where a column's value comes from in the current input file
+struct SkimSource {
+    const void* address = nullptr; // null: missing, written as 0
+    char        type = 0;
+};
+
+static bool matchesAny(const std::string& name, const std::vector<std::string>& patterns) {
+    for (auto& p : patterns) {
+        if (fnmatch(p.c_str(), name.c_str(), 0) == 0) return true;
+    }
+    return false;
+}
+
+SkimReport runSkim(const SkimOptions& opts, const std::vector<std::string>& files,
+                   const std::vector<std::string>& schemeKeys, const EventSelector& selector) {
+    SkimReport report;
+    std::unique_ptr<TFile> outFile(TFile::Open(opts.outputFile.c_str(), "RECREATE"));
+    if (!outFile || outFile->IsZombie()) {
+        report.failures.push_back("Cannot create " + opts.outputFile);
+        return report;
+    }
+    applyFileLayout(outFile.get(), opts.layout);
+    outFile->cd();
+    TTree* out = new TTree(opts.treeName.c_str(), "HH->bbgg skim"); // owned by outFile
+
+    std::vector<SchemeId> ids;
+    for (auto& key : schemeKeys) ids.push_back(static_cast<SchemeId>(schemeIndex(key)));
+
+    // Columns are defined by the first file that opens; they must not move
+    // once the output branches point at them
+    std::deque<SkimColumn> columns;
+    unsigned char passMask = 0;
+    bool defined = false;
+
+    for (size_t f = 0; f < files.size(); ++f) {
+        const std::string& file = files[f];
+        DataLoader loader(file, opts.treeName);
+        if (!loader.isOpen()) {
+            report.failures.push_back(loader.getError());
+            std::cerr << "  [" << f + 1 << "/" << files.size() << "] FAILED "
+                      << loader.getError() << std::endl;
+            continue;
+        }
+        EventData evt;
+        std::vector<SchemeData> sds(N_SCHEMES); // sized once: addresses are bound
+        loader.setupBranches(evt);
+        for (SchemeId id : ids) loader.setupSchemeBranches(sds[static_cast<int>(id)], schemeKeyOf(id));
+
+        // Bound branches are copied from the value as the file stores it
+        // (the staging word of a converted branch), not the bound member:
+        // the output keeps the input type and narrowing sees SENTINEL
+        std::map<std::string, SkimSource> bound;
+        std::map<std::string, char> storedType;
+        std::vector<std::string> boundOrder;
+        auto addBound = [&](const std::vector<BranchBinding>& group) {
+            for (auto& b : group) {
+                bound[b.name] = b.source ? SkimSource{b.source, b.sourceType} : SkimSource{b.address, b.type};
+                storedType[b.name] = b.storedType;
+                boundOrder.push_back(b.name);
+            }
+        };
+        addBound(loader.getSelectionBindings());
+        addBound(loader.getEventBindings());
+        for (SchemeId id : ids) addBound(loader.getSchemeBindings()[static_cast<int>(id)]);
+
+        if (!defined) {
+            std::vector<std::pair<std::string, char>> chosen;
+            if (opts.branches.empty()) {
+                for (auto& name : boundOrder) chosen.emplace_back(name, storedType[name]);
+            } else if (loader.isParquet()) {
+                // No branch list to match against: only bound columns
+                for (auto& name : boundOrder) {
+                    if (matchesAny(name, opts.branches)) chosen.emplace_back(name, storedType[name]);
+                }
+            } else {
+                TObjArray* list = loader.getTree()->GetListOfBranches();
+                for (int b = 0; b < list->GetEntriesFast(); ++b) {
+                    auto* br = static_cast<TBranch*>(list->UncheckedAt(b));
+                    std::string name = br->GetName();
+                    if (name == SKIM_MASK_BRANCH || !matchesAny(name, opts.branches)) continue;
+                    char type = branchTypeCode(br);
+                    if (type == 0) {
+                        std::cerr << "WARNING: Skim skips branch " << name
+                                  << " (arrays and this type are not supported)" << std::endl;
+                        continue;
+                    }
+                    chosen.emplace_back(name, type);
+                }
+            }
+            std::vector<std::string> chosenNames;
+            for (auto& entry : chosen) chosenNames.push_back(entry.first);
+            const auto& hot = opts.layout.hotBranches.empty() ? boundOrder : opts.layout.hotBranches;
+            for (std::size_t k : hotFirstOrder(chosenNames, hot)) {
+                const auto& [name, type] = chosen[k];
+                SkimColumn c;
+                c.name = name;
+                c.type = type;
+                if (opts.narrow && type == 'D' && skimNarrowType(name)) c.type = skimNarrowType(name);
+                columns.push_back(c);
+            }
+            for (auto& c : columns) {
+                out->Branch(c.name.c_str(), static_cast<void*>(&c.buffer), (c.name + "/" + c.type).c_str());
+            }
+            out->Branch(SKIM_MASK_BRANCH, &passMask, (std::string(SKIM_MASK_BRANCH) + "/b").c_str());
+            applyTreeLayout(out, opts.layout);
+            report.nBranches = static_cast<int>(columns.size()) + 1;
+            defined = true;
+        }
+
+        // Sources for this file: bound struct members, else a buffer of our
+        // own on the input branch (read only for selected events)
+        TTree* tree = loader.getTree();
+        std::vector<SkimSource> sources(columns.size());
+        std::deque<uint64_t> extraBuffers;
+        std::vector<TBranch*> extraBranches;
+        int nMissing = 0;
+        for (size_t c = 0; c < columns.size(); ++c) {
+            const std::string& name = columns[c].name;
+            auto it = bound.find(name);
+            if (it != bound.end()) {
+                sources[c] = it->second;
+                continue;
+            }
+            TBranch* br = tree ? tree->GetBranch(name.c_str()) : nullptr;
+            char type = branchTypeCode(br);
+            if (type == 0) {
+                ++nMissing;
+                continue;
+            }
+            extraBuffers.push_back(0);
+            tree->SetBranchStatus(name.c_str(), 1);
+            tree->SetBranchAddress(name.c_str(), static_cast<void*>(&extraBuffers.back()));
+            extraBranches.push_back(br);
+            sources[c] = {&extraBuffers.back(), type};
+        }
+        if (nMissing > 0) {
+            std::cerr << "WARNING: " << nMissing << " skim branch(es) missing in " << file
+                      << ", written as 0" << std::endl;
+        }
+
+        // The kept rows of this file (one word per column, then the mask)
+        // reach the output tree only once the whole file has been read, so
+        // a file that fails partway adds nothing
+        Long64_t nEntries = loader.getEntries();
+        Long64_t nKept = 0, nInexact = 0;
+        std::vector<uint64_t> rows;
+        std::string readError;
+        for (Long64_t i = 0; i < nEntries; ++i) {
+            loader.getSelectionEntry(i);
+            unsigned read = 0;
+            passMask = 0;
+            for (SchemeId id : ids) {
+                int s = static_cast<int>(id);
+                if (!selector.passCommonCuts(evt, id)) continue;
+                loader.getSchemeEntry(i, id);
+                read |= 1u << s;
+                if (selector.passSchemeCuts(sds[s])) passMask |= static_cast<unsigned char>(1u << s);
+            }
+            if (loader.hasReadError()) {
+                readError = loader.getError();
+                break;
+            }
+            if (!passMask) continue;
+
+            // Everything else only for the events that are kept
+            loader.getEventEntry(i);
+            for (SchemeId id : ids) {
+                if (!(read & (1u << static_cast<int>(id)))) loader.getSchemeEntry(i, id);
+            }
+            if (loader.hasReadError()) readError = loader.getError();
+            for (TBranch* br : extraBranches) {
+                if (readError.empty() && br->GetEntry(i) < 0) {
+                    readError = "Cannot read branch " + std::string(br->GetName()) + " entry " +
+                                std::to_string(i) + " of " + file;
+                }
+            }
+            if (!readError.empty()) break;
+
+            for (size_t c = 0; c < columns.size(); ++c) {
+                uint64_t word = 0;
+                if (sources[c].address &&
+                    !convertLeafValue(sources[c].address, sources[c].type, &word, columns[c].type)) {
+                    ++nInexact;
+                }
+                rows.push_back(word);
+            }
+            rows.push_back(passMask);
+            ++nKept;
+        }
+        if (!readError.empty()) {
+            report.failures.push_back(readError);
+            std::cerr << "  [" << f + 1 << "/" << files.size() << "] FAILED " << readError
+                      << " (nothing written for this file)" << std::endl;
+            continue;
+        }
+        for (std::size_t r = 0; r < rows.size(); r += columns.size() + 1) {
+            for (size_t c = 0; c < columns.size(); ++c) columns[c].buffer = rows[r + c];
+            passMask = static_cast<unsigned char>(rows[r + columns.size()]);
+            out->Fill();
+        }
+        report.nRead += nEntries;
+        report.nWritten += nKept;
+        report.nInexact += nInexact;
+        report.nFilesOk++;
+        std::cout << "  [" << f + 1 << "/" << files.size() << "] " << file << ": "
+                  << nKept << "/" << nEntries << " events kept" << std::endl;
+    }
+
+    outFile->cd();
+    out->Write();
+    outFile->Close();
+    return report;
+}
@@ -0,0 +1,225 @@
+#include "SparseHist.h"
+#include "BinaryIO.h"
+#include <algorithm>
+#include <utility>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+static const char kSparseMagic[4] = {'H', 'H', 'S', 'P'};
+static constexpr uint32_t kSparseVersion = 1;
+
+SparseHist::SparseHist(const std::string& name, const std::vector<SparseAxis>& axes)
+    : name_(name), axes_(axes) {
+    // Mixed-radix key: axis a has stride (n0 + 2) * ... * (n(a-1) + 2)
+    uint64_t stride = 1;
+    for (auto& ax : axes_) {
+        uint64_t size = static_cast<uint64_t>(std::max(ax.nbins, 0)) + 2;
+        stride_.push_back(stride);
+        if (stride > std::numeric_limits<uint64_t>::max() / size) {
+            std::cerr << "ERROR: Sparse store " << name_ << ": too many bins for a 64-bit key" << std::endl;
+            axes_.clear();
+            stride_.clear();
+            return;
+        }
+        stride *= size;
+    }
+}
+
+bool SparseHist::sameAxes(const SparseHist& other) const {
+    if (axes_.size() != other.axes_.size()) return false;
+    for (std::size_t a = 0; a < axes_.size(); ++a) {
+        const SparseAxis& x = axes_[a];
+        const SparseAxis& y = other.axes_[a];
+        if (x.name != y.name || x.nbins != y.nbins || x.xmin != y.xmin || x.xmax != y.xmax) return false;
+    }
+    return true;
+}
+
+void SparseHist::add(const SparseHist& other) {
+    for (auto& [k, c] : other.cells_) {
+        Cell& mine = cells_[k];
+        mine.sumw    += c.sumw;
+        mine.sumw2   += c.sumw2;
+        mine.entries += c.entries;
+    }
+    entries_ += other.entries_;
+}
+
+int SparseHist::findAxis(const std::string& name) const {
+    for (std::size_t a = 0; a < axes_.size(); ++a) {
+        if (axes_[a].name == name) return static_cast<int>(a);
+    }
+    return -1;
+}
+
+std::size_t SparseHist::getMemoryBytes() const {
+    // Node (key, cell, next pointer, cached hash) plus the bucket array
+    std::size_t node = sizeof(std::pair<const uint64_t, Cell>) + 2 * sizeof(void*);
+    return sizeof(*this) + cells_.size() * node + cells_.bucket_count() * sizeof(void*);
+}
+
+// ---------------------------------------------------------------------------
+// Projections
+// ---------------------------------------------------------------------------
+std::vector<std::vector<char>> SparseHist::cutMasks(const std::vector<SparseCut>& cuts) const {
+    std::vector<std::vector<char>> masks(axes_.size()); // empty: axis not cut
+    for (auto& cut : cuts) {
+        if (cut.axis < 0 || cut.axis >= static_cast<int>(axes_.size())) continue;
+        const SparseAxis& ax = axes_[cut.axis];
+        std::vector<char>& mask = masks[cut.axis];
+        if (mask.empty()) mask.assign(ax.nbins + 2, 1);
+        double width = (ax.xmax - ax.xmin) / ax.nbins;
+        for (int b = 0; b < ax.nbins + 2; ++b) {
+            double centre = b == 0             ? -std::numeric_limits<double>::infinity()
+                          : b == ax.nbins + 1 ? std::numeric_limits<double>::infinity()
+                                               : ax.xmin + (b - 0.5) * width;
+            if (!(centre >= cut.lo && centre < cut.hi)) mask[b] = 0;
+        }
+    }
+    return masks;
+}
+
+bool SparseHist::passes(uint64_t key, const std::vector<std::vector<char>>& masks) const {
+    for (std::size_t a = 0; a < masks.size(); ++a) {
+        if (!masks[a].empty() && !masks[a][binOf(key, a)]) return false;
+    }
+    return true;
+}
+
+FastHist1D SparseHist::project1D(int axis, const std::vector<SparseCut>& cuts) const {
+    if (axis < 0 || axis >= static_cast<int>(axes_.size())) return FastHist1D();
+    const SparseAxis& ax = axes_[axis];
+    FastHist1D h(name_ + "_" + ax.name, ax.name, ax.nbins, ax.xmin, ax.xmax);
+    std::vector<ExactSum> sumw(ax.nbins + 2), sumw2(ax.nbins + 2);
+    long long entries = 0;
+    auto masks = cutMasks(cuts);
+    for (auto& [k, c] : cells_) {
+        if (!passes(k, masks)) continue;
+        int b = binOf(k, axis);
+        sumw[b]  += c.sumw;
+        sumw2[b] += c.sumw2;
+        entries  += c.entries;
+    }
+    h.setContents(std::move(sumw), std::move(sumw2), entries);
+    return h;
+}
+
+FastHist2D SparseHist::project2D(int xAxis, int yAxis, const std::vector<SparseCut>& cuts) const {
+    int n = static_cast<int>(axes_.size());
+    if (xAxis < 0 || xAxis >= n || yAxis < 0 || yAxis >= n || xAxis == yAxis) return FastHist2D();
+    const SparseAxis& ax = axes_[xAxis];
+    const SparseAxis& ay = axes_[yAxis];
+    FastHist2D h(name_ + "_" + ax.name + "_vs_" + ay.name, ax.name + " vs " + ay.name,
+                 ax.nbins, ax.xmin, ax.xmax, ay.nbins, ay.xmin, ay.xmax);
+    std::size_t size = static_cast<std::size_t>(ax.nbins + 2) * (ay.nbins + 2);
+    std::vector<ExactSum> sumw(size), sumw2(size);
+    long long entries = 0;
+    auto masks = cutMasks(cuts);
+    for (auto& [k, c] : cells_) {
+        if (!passes(k, masks)) continue;
+        std::size_t cell = binOf(k, xAxis) + static_cast<std::size_t>(ax.nbins + 2) * binOf(k, yAxis);
+        sumw[cell]  += c.sumw;
+        sumw2[cell] += c.sumw2;
+        entries     += c.entries;
+    }
+    h.setContents(std::move(sumw), std::move(sumw2), entries);
+    return h;
+}
+
+// ---------------------------------------------------------------------------
+// Serialisation
+// ---------------------------------------------------------------------------
+void SparseHist::write(std::ostream& out) const {
+    putString(out, name_);
+    put<uint32_t>(out, static_cast<uint32_t>(axes_.size()));
+    for (auto& ax : axes_) {
+        putString(out, ax.name);
+        put(out, ax.nbins);
+        put(out, ax.xmin);
+        put(out, ax.xmax);
+    }
+    put(out, entries_);
+    // Sorted by key, so equal content gives identical bytes
+    std::vector<uint64_t> keys;
+    keys.reserve(cells_.size());
+    for (auto& kv : cells_) keys.push_back(kv.first);
+    std::sort(keys.begin(), keys.end());
+    put<uint64_t>(out, keys.size());
+    for (uint64_t k : keys) {
+        const Cell& c = cells_.at(k);
+        put(out, k);
+        put(out, c.sumw.value());
+        put(out, c.sumw2.value());
+        put(out, c.entries);
+    }
+}
+
+bool SparseHist::read(std::istream& in) {
+    std::string name;
+    uint32_t nAxes = 0;
+    if (!getString(in, name) || !get(in, nAxes) || nAxes > 64) return false;
+    std::vector<SparseAxis> axes(nAxes);
+    for (auto& ax : axes) {
+        if (!getString(in, ax.name) || !get(in, ax.nbins) || !get(in, ax.xmin) || !get(in, ax.xmax) ||
+            ax.nbins <= 0) return false;
+    }
+    SparseHist result(name, axes);
+    if (result.axes_.size() != nAxes) return false;
+
+    uint64_t nCells = 0;
+    if (!get(in, result.entries_) || !get(in, nCells) || nCells > (1ull << 32)) return false;
+    result.cells_.reserve(static_cast<std::size_t>(nCells));
+    for (uint64_t i = 0; i < nCells; ++i) {
+        uint64_t k = 0;
+        Cell c;
+        double sumw = 0, sumw2 = 0;
+        if (!get(in, k) || !get(in, sumw) || !get(in, sumw2) || !get(in, c.entries)) return false;
+        c.sumw = ExactSum(sumw);
+        c.sumw2 = ExactSum(sumw2);
+        result.cells_[k] = c;
+    }
+    *this = std::move(result);
+    return true;
+}
+
+bool saveSparseStores(const std::string& path, const std::map<std::string, SparseHist>& stores) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(kSparseMagic, 4);
+    put(out, kSparseVersion);
+    put<uint32_t>(out, static_cast<uint32_t>(stores.size()));
+    for (auto& [key, store] : stores) {
+        putString(out, key);
+        store.write(out);
+    }
+    if (!out) {
+        std::cerr << "ERROR: Cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadSparseStores(const std::string& path, std::map<std::string, SparseHist>& stores) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "ERROR: Cannot read " << path << std::endl;
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0, n = 0;
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kSparseMagic) ||
+        !get(in, version) || version != kSparseVersion || !get(in, n)) {
+        std::cerr << "ERROR: " << path << " is not a sparse store file" << std::endl;
+        return false;
+    }
+    std::map<std::string, SparseHist> result;
+    for (uint32_t i = 0; i < n; ++i) {
+        std::string key;
+        if (!getString(in, key) || !result[key].read(in)) {
+            std::cerr << "ERROR: " << path << " is truncated or corrupt" << std::endl;
+            return false;
+        }
+    }
+    stores = std::move(result);
+    return true;
+}
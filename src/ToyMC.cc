@@ -0,0 +1,233 @@
+#include "ToyMC.h"
+#include "Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+
+bool parseToyMode(const std::string& name, ToyMode& mode) {
+    if (name == "model")          mode = ToyMode::Model;
+    else if (name == "bootstrap") mode = ToyMode::Bootstrap;
+    else return false;
+    return true;
+}
+
+bool parseToyStatistic(const std::string& name, ToyStatistic& statistic) {
+    if (name == "count")       statistic = ToyStatistic::Count;
+    else if (name == "excess") statistic = ToyStatistic::Excess;
+    else return false;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Toy result
+// ---------------------------------------------------------------------------
+double ToyResult::pValue(double observed) const {
+    if (nUsable() <= 0) return -1;
+    long long n = 0;
+    for (auto& t : toys) n += !t.failed && t.statistic >= observed;
+    return static_cast<double>(n) / nUsable();
+}
+
+double ToyResult::quantile(double q) const {
+    if (nUsable() <= 0) return 0;
+    std::vector<double> v;
+    v.reserve(static_cast<std::size_t>(nUsable()));
+    for (auto& t : toys) {
+        if (!t.failed) v.push_back(t.statistic);
+    }
+    std::size_t k = std::min(v.size() - 1, static_cast<std::size_t>(q * v.size()));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+FastHist1D ToyResult::histogram(int nbins) const {
+    double lo = 0, hi = 1;
+    if (nUsable() > 0) {
+        lo = std::numeric_limits<double>::max();
+        hi = std::numeric_limits<double>::lowest();
+        for (auto& t : toys) {
+            if (t.failed) continue;
+            lo = std::min(lo, t.statistic);
+            hi = std::max(hi, t.statistic);
+        }
+        if (hi <= lo) hi = lo + 1;
+        hi += (hi - lo) * 1e-9; // keep the maximum out of the overflow
+    }
+    FastHist1D h("toy_statistic", ";test statistic;Toys", nbins, lo, hi);
+    for (auto& t : toys) {
+        if (!t.failed) h.fill(t.statistic);
+    }
+    return h;
+}
+
+// ---------------------------------------------------------------------------
+// Generation
+// ---------------------------------------------------------------------------
+// Inverse CDF of the fitted shape on a fine grid over the fit range
+class ShapeSampler {
+public:
+    ShapeSampler(const SidebandFitter& fitter, const SidebandFitResult& fit, int nGrid = 4096) {
+        const SidebandFitOptions& o = fitter.getOptions();
+        x_.resize(nGrid + 1);
+        cdf_.resize(nGrid + 1, 0.0);
+        for (int g = 0; g <= nGrid; ++g) x_[g] = o.fitLow + (o.fitHigh - o.fitLow) * g / nGrid;
+        for (int g = 1; g <= nGrid; ++g) {
+            cdf_[g] = cdf_[g - 1] + std::max(0.0, fitter.fraction(fit, x_[g - 1], x_[g]));
+        }
+        // fraction() is relative to the sidebands: the total is the full-range yield per sideband yield
+        total_ = cdf_.back();
+        for (auto& c : cdf_) c /= total_;
+        // Guide table: first grid point above each of nGrid equal steps in
+        // u, so sample() scans O(1) points instead of a binary search
+        guide_.resize(nGrid);
+        std::size_t g = 1;
+        for (int j = 0; j < nGrid; ++j) {
+            while (g + 1 < cdf_.size() && cdf_[g] <= static_cast<double>(j) / nGrid) ++g;
+            guide_[j] = g;
+        }
+    }
+
+    double totalFraction() const { return total_; }
+
+    double sample(double u) const {
+        std::size_t g = guide_[std::min(guide_.size() - 1, static_cast<std::size_t>(u * guide_.size()))];
+        while (g + 1 < cdf_.size() && cdf_[g] <= u) ++g;
+        double c0 = cdf_[g - 1], c1 = cdf_[g];
+        double f = c1 > c0 ? (u - c0) / (c1 - c0) : 0.5;
+        return x_[g - 1] + f * (x_[g] - x_[g - 1]);
+    }
+
+private:
+    std::vector<double> x_, cdf_;
+    std::vector<std::size_t> guide_;
+    double total_ = 0;
+};
+
+// Counts and statistic of one event set
+static ToyOutcome countToy(const ToyOptions& opts, const EventSelector& selector, EventData& evt,
+                           const std::vector<double>& mgg, const std::vector<double>& weight) {
+    ToyOutcome out;
+    for (std::size_t i = 0; i < mgg.size(); ++i) {
+        evt.mass = mgg[i];
+        double w = weight[i];
+        if (selector.passSignalRegion(evt, opts.fit.blindLow, opts.fit.blindHigh)) out.signalRegion += w;
+        if (selector.passSideband(evt, opts.fit.blindLow, opts.fit.blindHigh) && selector.passDiphotonMass(evt))
+            out.sidebands += w;
+        if (mgg[i] >= opts.windowLow && mgg[i] < opts.windowHigh) out.window += w;
+    }
+    out.statistic = out.window;
+    if (opts.statistic == ToyStatistic::Excess) {
+        SidebandFitOptions fitOpts = opts.fit;
+        fitOpts.threads = 1;
+        SidebandFitter fitter(ColumnSpan<double>(mgg.data(), mgg.size()),
+                              ColumnSpan<double>(weight.data(), weight.size()), fitOpts);
+        SidebandFitResult fit = fitter.fit(opts.model);
+        out.failed = !fit.converged;
+        out.statistic -= fitter.yield(fit, opts.windowLow, opts.windowHigh).expected;
+    }
+    return out;
+}
+
+ToyResult runToys(const ToyOptions& opts, ColumnSpan<double> mgg, ColumnSpan<double> weight,
+                  const EventSelector& selector) {
+    auto t0 = std::chrono::steady_clock::now();
+    ToyResult result;
+    std::vector<double> dataMgg(mgg.begin(), mgg.end());
+    std::vector<double> dataW = weight.empty() ? std::vector<double>(mgg.size(), 1.0)
+                                               : std::vector<double>(weight.begin(), weight.end());
+    if (dataMgg.empty()) {
+        result.error = "No events";
+        return result;
+    }
+    EventData evt;
+    result.data = countToy(opts, selector, evt, dataMgg, dataW);
+    if (result.data.failed) {
+        result.error = "The " + bkgModelName(opts.model) + " fit to the data sidebands did not converge";
+        return result;
+    }
+
+    // Model toys: one fit to the data, then the expected number of events
+    // over the whole fit range (sideband events scaled by the shape). Toy
+    // weights are drawn from the weights of those sideband events, so the
+    // expected sum of weights is the fitted sideband yield scaled the same way.
+    std::unique_ptr<ShapeSampler> sampler;
+    std::vector<double> sidebandW;
+    double expectedEvents = 0;
+    if (opts.mode == ToyMode::Model) {
+        SidebandFitOptions fitOpts = opts.fit;
+        SidebandFitter fitter(mgg, weight, fitOpts);
+        result.dataFit = fitter.fit(opts.model);
+        if (!result.dataFit.converged) {
+            result.error = "The " + bkgModelName(opts.model) + " fit to the data sidebands did not converge";
+            return result;
+        }
+        sampler = std::make_unique<ShapeSampler>(fitter, result.dataFit);
+        for (std::size_t i = 0; i < dataMgg.size(); ++i) {
+            evt.mass = dataMgg[i];
+            if (dataMgg[i] >= opts.fit.fitLow && dataMgg[i] <= opts.fit.fitHigh &&
+                selector.passSideband(evt, opts.fit.blindLow, opts.fit.blindHigh))
+                sidebandW.push_back(dataW[i]);
+        }
+        if (sidebandW.empty() || fitter.getSumW() <= 0) {
+            result.error = "Model toys need a positive sum of sideband weights";
+            return result;
+        }
+        expectedEvents = static_cast<double>(sidebandW.size()) * sampler->totalFraction();
+    }
+
+    long long nToys = std::max(0LL, opts.nToys);
+    long long blockSize = std::max(1, opts.blockSize);
+    long long nBlocks = (nToys + blockSize - 1) / blockSize;
+    result.toys.resize(static_cast<std::size_t>(nToys));
+    int nThreads = opts.threads > 0 ? opts.threads
+                                    : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    nThreads = static_cast<int>(std::max(1LL, std::min<long long>(nThreads, nBlocks)));
+
+    std::atomic<long long> nextBlock{0};
+    auto work = [&] {
+        EventData toyEvt;
+        std::vector<double> m, w;
+        for (long long b; (b = nextBlock.fetch_add(1)) < nBlocks;) {
+            for (long long toy = b * blockSize; toy < std::min(nToys, (b + 1) * blockSize); ++toy) {
+                std::mt19937_64 rng(hashValue(toy, hashValue(opts.seed)));
+                m.clear();
+                w.clear();
+                if (opts.mode == ToyMode::Model) {
+                    long long n = std::poisson_distribution<long long>(expectedEvents)(rng);
+                    std::uniform_real_distribution<double> u(0.0, 1.0);
+                    std::uniform_int_distribution<std::size_t> pick(0, sidebandW.size() - 1);
+                    for (long long i = 0; i < n; ++i) {
+                        m.push_back(sampler->sample(u(rng)));
+                        w.push_back(sidebandW[pick(rng)]);
+                    }
+                } else {
+                    std::uniform_int_distribution<std::size_t> pick(0, dataMgg.size() - 1);
+                    for (std::size_t i = 0; i < dataMgg.size(); ++i) {
+                        std::size_t k = pick(rng);
+                        m.push_back(dataMgg[k]);
+                        w.push_back(dataW[k]);
+                    }
+                }
+                result.toys[static_cast<std::size_t>(toy)] = countToy(opts, selector, toyEvt, m, w);
+            }
+        }
+    };
+    if (nThreads == 1) {
+        work();
+    } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; ++t) threads.emplace_back(work);
+        for (auto& th : threads) th.join();
+    }
+
+    for (auto& t : result.toys) result.nFailed += t.failed;
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    result.toysPerSecond = result.seconds > 0 ? nToys / result.seconds : 0;
+    return result;
+}
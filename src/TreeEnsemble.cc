@@ -0,0 +1,960 @@
+#include "TreeEnsemble.h"
+#include <algorithm>
+#include <cstddef>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <cctype>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TREEENSEMBLE_X86_SIMD 1
+#endif
+
+// ---------------------------------------------------------------------------
+// Minimal JSON reader (XGBoost models)
+// ---------------------------------------------------------------------------
+namespace {
+
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;                           // Array
+    std::vector<std::pair<std::string, JsonValue>> members; // Object
+
+    const JsonValue* get(const std::string& key) const {
+        for (auto& [k, v] : members) {
+            if (k == key) return &v;
+        }
+        return nullptr;
+    }
+    // Numbers may be stored as strings ("5E-1", "[5E-1]" in newer XGBoost)
+    bool toNumber(double& v) const {
+        if (type == Number || type == Bool) {
+            v = number;
+            return true;
+        }
+        if (type != String) return false;
+        std::string s = string;
+        if (s.size() >= 2 && s.front() == '[' && s.back() == ']') s = s.substr(1, s.size() - 2);
+        char* end = nullptr;
+        v = std::strtod(s.c_str(), &end);
+        return end != s.c_str() && *end == '\0';
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    bool parse(JsonValue& v) {
+        if (!value(v, 0)) return false;
+        skipBlanks();
+        return p_ == end_;
+    }
+
+private:
+    void skipBlanks() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    bool literal(const char* word) {
+        std::size_t n = std::strlen(word);
+        if (static_cast<std::size_t>(end_ - p_) < n || std::memcmp(p_, word, n) != 0) return false;
+        p_ += n;
+        return true;
+    }
+
+    bool string(std::string& s) {
+        if (p_ >= end_ || *p_ != '"') return false;
+        ++p_;
+        s.clear();
+        while (p_ < end_ && *p_ != '"') {
+            char c = *p_++;
+            if (c != '\\') {
+                s += c;
+                continue;
+            }
+            if (p_ >= end_) return false;
+            char e = *p_++;
+            switch (e) {
+                case 'n': s += '\n'; break;
+                case 't': s += '\t'; break;
+                case 'r': s += '\r'; break;
+                case 'b': s += '\b'; break;
+                case 'f': s += '\f'; break;
+                case 'u': {
+                    // Feature names are ASCII; anything else becomes '?'
+                    if (end_ - p_ < 4) return false;
+                    unsigned code = 0;
+                    auto r = std::from_chars(p_, p_ + 4, code, 16);
+                    if (r.ptr != p_ + 4) return false;
+                    p_ += 4;
+                    s += code < 0x80 ? static_cast<char>(code) : '?';
+                    break;
+                }
+                default: s += e; break;
+            }
+        }
+        if (p_ >= end_) return false;
+        ++p_;
+        return true;
+    }
+
+    bool value(JsonValue& v, int depth) {
+        if (depth > 64) return false;
+        skipBlanks();
+        if (p_ >= end_) return false;
+        switch (*p_) {
+            case '{': {
+                ++p_;
+                v.type = JsonValue::Object;
+                skipBlanks();
+                if (p_ < end_ && *p_ == '}') {
+                    ++p_;
+                    return true;
+                }
+                for (;;) {
+                    skipBlanks();
+                    std::string key;
+                    if (!string(key)) return false;
+                    skipBlanks();
+                    if (p_ >= end_ || *p_++ != ':') return false;
+                    v.members.emplace_back(std::move(key), JsonValue());
+                    if (!value(v.members.back().second, depth + 1)) return false;
+                    skipBlanks();
+                    if (p_ >= end_) return false;
+                    if (*p_ == ',') { ++p_; continue; }
+                    if (*p_++ == '}') return true;
+                    return false;
+                }
+            }
+            case '[': {
+                ++p_;
+                v.type = JsonValue::Array;
+                skipBlanks();
+                if (p_ < end_ && *p_ == ']') {
+                    ++p_;
+                    return true;
+                }
+                for (;;) {
+                    v.items.emplace_back();
+                    if (!value(v.items.back(), depth + 1)) return false;
+                    skipBlanks();
+                    if (p_ >= end_) return false;
+                    if (*p_ == ',') { ++p_; continue; }
+                    if (*p_++ == ']') return true;
+                    return false;
+                }
+            }
+            case '"':
+                v.type = JsonValue::String;
+                return string(v.string);
+            case 't':
+                v.type = JsonValue::Bool;
+                v.number = 1;
+                return literal("true");
+            case 'f':
+                v.type = JsonValue::Bool;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default: {
+                v.type = JsonValue::Number;
+                const char* b = p_;
+                while (p_ < end_ && (std::isdigit(static_cast<unsigned char>(*p_)) || *p_ == '-' ||
+                                     *p_ == '+' || *p_ == '.' || *p_ == 'e' || *p_ == 'E')) {
+                    ++p_;
+                }
+                if (b < p_ && *b == '+') ++b;
+                auto r = std::from_chars(b, p_, v.number);
+                return r.ec == std::errc() && r.ptr == p_;
+            }
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+// Numbers of a JSON array (or an empty vector if it is not one)
+template <typename T>
+std::vector<T> numbers(const JsonValue* v) {
+    std::vector<T> out;
+    if (!v || v->type != JsonValue::Array) return out;
+    out.reserve(v->items.size());
+    for (auto& item : v->items) {
+        double d = 0;
+        item.toNumber(d);
+        out.push_back(static_cast<T>(d));
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Minimal XML reader (TMVA weight files)
+// ---------------------------------------------------------------------------
+struct XmlElement {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> attrs;
+    std::vector<XmlElement> children;
+    std::string text;
+
+    const std::string* attr(const std::string& key) const {
+        for (auto& [k, v] : attrs) {
+            if (k == key) return &v;
+        }
+        return nullptr;
+    }
+    double number(const std::string& key, double fallback) const {
+        const std::string* s = attr(key);
+        if (!s) return fallback;
+        char* end = nullptr;
+        double v = std::strtod(s->c_str(), &end);
+        return end != s->c_str() ? v : fallback;
+    }
+    const XmlElement* child(const std::string& key) const {
+        for (auto& c : children) {
+            if (c.name == key) return &c;
+        }
+        return nullptr;
+    }
+};
+
+class XmlParser {
+public:
+    XmlParser(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    bool parse(XmlElement& root) {
+        skipMisc();
+        if (!element(root, 0)) return false;
+        skipMisc();
+        return p_ == end_;
+    }
+
+private:
+    bool startsWith(const char* s) const {
+        std::size_t n = std::strlen(s);
+        return static_cast<std::size_t>(end_ - p_) >= n && std::memcmp(p_, s, n) == 0;
+    }
+    bool skipPast(const char* s) {
+        std::size_t n = std::strlen(s);
+        for (; static_cast<std::size_t>(end_ - p_) >= n; ++p_) {
+            if (std::memcmp(p_, s, n) == 0) {
+                p_ += n;
+                return true;
+            }
+        }
+        p_ = end_;
+        return false;
+    }
+    void skipBlanks() {
+        while (p_ < end_ && std::isspace(static_cast<unsigned char>(*p_))) ++p_;
+    }
+    // Blanks, <?xml ...?>, comments and <!DOCTYPE>
+    void skipMisc() {
+        for (;;) {
+            skipBlanks();
+            if (startsWith("<?"))        skipPast("?>");
+            else if (startsWith("<!--")) skipPast("-->");
+            else if (startsWith("<!"))   skipPast(">");
+            else return;
+        }
+    }
+    static std::string decode(const char* b, const char* e) {
+        std::string s;
+        s.reserve(e - b);
+        while (b < e) {
+            if (*b != '&') {
+                s += *b++;
+                continue;
+            }
+            static const std::pair<const char*, char> entities[] = {
+                {"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'}, {"&quot;", '"'}, {"&apos;", '\''}};
+            bool known = false;
+            for (auto& [ent, c] : entities) {
+                std::size_t n = std::strlen(ent);
+                if (static_cast<std::size_t>(e - b) >= n && std::memcmp(b, ent, n) == 0) {
+                    s += c;
+                    b += n;
+                    known = true;
+                    break;
+                }
+            }
+            if (!known) s += *b++;
+        }
+        return s;
+    }
+    std::string name() {
+        const char* b = p_;
+        while (p_ < end_ && !std::isspace(static_cast<unsigned char>(*p_)) && *p_ != '>' &&
+               *p_ != '/' && *p_ != '=') {
+            ++p_;
+        }
+        return std::string(b, p_);
+    }
+
+    bool element(XmlElement& el, int depth) {
+        // TMVA trees nest one element per node level
+        if (depth > 512 || p_ >= end_ || *p_ != '<') return false;
+        ++p_;
+        el.name = name();
+        if (el.name.empty()) return false;
+        for (;;) {
+            skipBlanks();
+            if (p_ >= end_) return false;
+            if (startsWith("/>")) {
+                p_ += 2;
+                return true;
+            }
+            if (*p_ == '>') {
+                ++p_;
+                break;
+            }
+            std::string key = name();
+            skipBlanks();
+            if (key.empty() || p_ >= end_ || *p_++ != '=') return false;
+            skipBlanks();
+            if (p_ >= end_ || (*p_ != '"' && *p_ != '\'')) return false;
+            char quote = *p_++;
+            const char* b = p_;
+            while (p_ < end_ && *p_ != quote) ++p_;
+            if (p_ >= end_) return false;
+            el.attrs.emplace_back(std::move(key), decode(b, p_));
+            ++p_;
+        }
+        // Content: text, children, comments, up to the closing tag
+        for (;;) {
+            const char* b = p_;
+            while (p_ < end_ && *p_ != '<') ++p_;
+            el.text += decode(b, p_);
+            if (p_ >= end_) return false;
+            if (startsWith("<!--")) {
+                skipPast("-->");
+            } else if (startsWith("<![CDATA[")) {
+                p_ += 9;
+                const char* c = p_;
+                if (!skipPast("]]>")) return false;
+                el.text.append(c, p_ - 3);
+            } else if (startsWith("</")) {
+                p_ += 2;
+                if (name() != el.name) return false;
+                skipBlanks();
+                if (p_ >= end_ || *p_++ != '>') return false;
+                return true;
+            } else {
+                el.children.emplace_back();
+                if (!element(el.children.back(), depth + 1)) return false;
+            }
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+std::string trim(const std::string& s) {
+    std::size_t b = s.find_first_not_of(" \t\r\n");
+    std::size_t e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Smallest float >= v: a float input x satisfies x >= v exactly when
+// x >= ceilFloat(v), so double cuts keep their meaning in float
+float ceilFloat(double v) {
+    float f = static_cast<float>(v);
+    if (static_cast<double>(f) < v) f = std::nextafter(f, std::numeric_limits<float>::infinity());
+    return f;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+bool TreeEnsemble::load(const std::string& path) {
+    *this = TreeEnsemble();
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error_ = "Cannot open model " + path;
+        return false;
+    }
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    std::string text = oss.str();
+
+    bool ok = false;
+    if (endsWith(path, ".json"))     ok = loadXGBoost(text);
+    else if (endsWith(path, ".xml")) ok = loadTmva(text);
+    else error_ = "unknown model format (expected .json or .xml)";
+    if (ok && roots_.empty()) {
+        error_ = "no trees";
+        ok = false;
+    }
+    if (ok && featureNames_.size() > std::numeric_limits<uint16_t>::max()) {
+        error_ = "too many features";
+        ok = false;
+    }
+    if (!ok) {
+        std::string msg = "Model " + path + ": " + error_;
+        *this = TreeEnsemble();
+        error_ = msg;
+    }
+    return ok;
+}
+
+bool TreeEnsemble::loadXGBoost(const std::string& text) {
+    JsonValue doc;
+    if (!JsonParser(text.data(), text.data() + text.size()).parse(doc)) {
+        error_ = "not valid JSON";
+        return false;
+    }
+    const JsonValue* learner = doc.get("learner");
+    const JsonValue* booster = learner ? learner->get("gradient_booster") : nullptr;
+    if (!booster) {
+        error_ = "no learner.gradient_booster (not an XGBoost JSON model)";
+        return false;
+    }
+    // dart keeps a gbtree model plus one weight per tree
+    const JsonValue* name = booster->get("name");
+    std::vector<float> weightDrop;
+    if (name && name->string == "dart") {
+        weightDrop = numbers<float>(booster->get("weight_drop"));
+        booster = booster->get("gbtree");
+    } else if (name && name->string != "gbtree") {
+        error_ = "unsupported booster '" + name->string + "'";
+        return false;
+    }
+    const JsonValue* model = booster ? booster->get("model") : nullptr;
+    const JsonValue* trees = model ? model->get("trees") : nullptr;
+    if (!trees || trees->type != JsonValue::Array) {
+        error_ = "no trees in the model";
+        return false;
+    }
+    std::vector<int> treeInfo = numbers<int>(model->get("tree_info"));
+
+    // Model parameters: all stored as strings
+    int nFeatures = 0, nClass = 0;
+    double base = 0.5;
+    if (const JsonValue* param = learner->get("learner_model_param")) {
+        double v = 0;
+        if (const JsonValue* p = param->get("num_feature"); p && p->toNumber(v)) nFeatures = static_cast<int>(v);
+        if (const JsonValue* p = param->get("num_class"); p && p->toNumber(v)) nClass = static_cast<int>(v);
+        if (const JsonValue* p = param->get("base_score"); p && p->toNumber(v)) base = v;
+    }
+    std::string objective = "reg:squarederror";
+    if (const JsonValue* obj = learner->get("objective")) {
+        if (const JsonValue* n = obj->get("name")) objective = n->string;
+    }
+
+    // base_score is given in output space; the trees add to the margin
+    nOutputs_ = std::max(1, nClass);
+    double margin = base;
+    if (objective == "binary:logistic" || objective == "reg:logistic") {
+        transform_ = Transform::Sigmoid;
+        margin = std::log(base / (1 - base));
+    } else if (objective == "binary:logitraw") {
+        transform_ = Transform::Raw;
+        margin = std::log(base / (1 - base));
+    } else if (objective == "multi:softprob" || objective == "multi:softmax") {
+        transform_ = Transform::Softmax; // probabilities for both
+    } else if (objective == "reg:squarederror" || objective == "reg:linear" ||
+               objective == "reg:pseudohubererror" || objective == "reg:absoluteerror") {
+        transform_ = Transform::Raw;
+    } else {
+        error_ = "unsupported objective '" + objective + "'";
+        return false;
+    }
+    baseScore_.assign(nOutputs_, static_cast<float>(margin));
+
+    std::size_t maxFeature = 0;
+    for (std::size_t t = 0; t < trees->items.size(); ++t) {
+        const JsonValue& tree = trees->items[t];
+        for (int type : numbers<int>(tree.get("split_type"))) {
+            if (type != 0) {
+                error_ = "categorical splits are not supported";
+                return false;
+            }
+        }
+        RawTree raw;
+        raw.left = numbers<int>(tree.get("left_children"));
+        raw.right = numbers<int>(tree.get("right_children"));
+        raw.feature = numbers<int>(tree.get("split_indices"));
+        raw.threshold = numbers<float>(tree.get("split_conditions"));
+        std::vector<int> defaultLeft = numbers<int>(tree.get("default_left"));
+        std::size_t n = raw.left.size();
+        if (n == 0 || raw.right.size() != n || raw.feature.size() != n || raw.threshold.size() != n ||
+            defaultLeft.size() != n) {
+            error_ = "malformed tree " + std::to_string(t);
+            return false;
+        }
+        // Leaves keep their value in split_conditions; XGBoost goes left
+        // when x < condition, i.e. right when x >= condition
+        raw.value = raw.threshold;
+        raw.missingRight.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            raw.missingRight[i] = !defaultLeft[i];
+            if (raw.left[i] < 0) continue;
+            if (raw.left[i] >= static_cast<int>(n) || raw.right[i] < 0 || raw.right[i] >= static_cast<int>(n) ||
+                raw.feature[i] < 0) {
+                error_ = "malformed tree " + std::to_string(t);
+                return false;
+            }
+            maxFeature = std::max(maxFeature, static_cast<std::size_t>(raw.feature[i]) + 1);
+        }
+        raw.output = t < treeInfo.size() ? treeInfo[t] : 0;
+        if (raw.output < 0 || raw.output >= nOutputs_) {
+            error_ = "tree " + std::to_string(t) + " has no valid class";
+            return false;
+        }
+        if (t < weightDrop.size()) raw.weight = weightDrop[t];
+        if (!addTree(raw)) {
+            error_ = "malformed tree " + std::to_string(t);
+            return false;
+        }
+    }
+
+    if (const JsonValue* names = learner->get("feature_names")) {
+        for (auto& item : names->items) featureNames_.push_back(item.string);
+    }
+    nFeatures = std::max<int>(nFeatures, static_cast<int>(maxFeature));
+    if (featureNames_.empty()) {
+        for (int f = 0; f < nFeatures; ++f) featureNames_.push_back("f" + std::to_string(f));
+    } else if (featureNames_.size() < maxFeature) {
+        error_ = "fewer feature names than features used by the trees";
+        return false;
+    }
+    return true;
+}
+
+bool TreeEnsemble::loadTmva(const std::string& text) {
+    XmlElement root;
+    if (!XmlParser(text.data(), text.data() + text.size()).parse(root)) {
+        error_ = "not valid XML";
+        return false;
+    }
+    const std::string* method = root.attr("Method");
+    if (root.name != "MethodSetup" || !method || method->compare(0, 4, "BDT:") != 0) {
+        error_ = "not a TMVA BDT weight file";
+        return false;
+    }
+
+    std::string boostType = "AdaBoost";
+    bool yesNoLeaf = true;
+    if (const XmlElement* options = root.child("Options")) {
+        for (auto& opt : options->children) {
+            const std::string* n = opt.attr("name");
+            if (!n) continue;
+            std::string v = trim(opt.text);
+            if (*n == "BoostType") boostType = v;
+            if (*n == "UseYesNoLeaf") yesNoLeaf = (v == "True" || v == "true" || v == "1");
+        }
+    }
+    if (const XmlElement* transforms = root.child("Transformations")) {
+        if (transforms->number("NTransformations", 0) > 0) {
+            error_ = "input variable transformations are not supported";
+            return false;
+        }
+    }
+    if (const XmlElement* vars = root.child("Variables")) {
+        for (auto& v : vars->children) {
+            const std::string* expr = v.attr("Expression");
+            featureNames_.push_back(expr ? *expr : "");
+        }
+    }
+    if (const XmlElement* specs = root.child("Spectators")) {
+        for (auto& s : specs->children) {
+            const std::string* expr = s.attr("Expression");
+            spectators_.push_back(expr ? *expr : "");
+        }
+    }
+    int nClass = 2;
+    if (const XmlElement* classes = root.child("Classes")) {
+        nClass = static_cast<int>(classes->number("NClass", 2));
+    }
+    const XmlElement* weights = root.child("Weights");
+    if (!weights || featureNames_.empty()) {
+        error_ = "no Weights or Variables";
+        return false;
+    }
+
+    // AnalysisType 0: classification (one MVA value), 2: multiclass (trees
+    // cycle over the classes), 1: regression
+    int analysisType = static_cast<int>(weights->number("AnalysisType", 0));
+    if (analysisType == 1) {
+        error_ = "regression BDTs are not supported";
+        return false;
+    }
+    bool multiclass = analysisType == 2 || nClass > 2;
+    bool grad = boostType == "Grad";
+    if (multiclass && !grad) {
+        error_ = "multiclass models need BoostType=Grad";
+        return false;
+    }
+    nOutputs_ = multiclass ? nClass : 1;
+    transform_ = multiclass ? Transform::Softmax : grad ? Transform::TmvaGrad : Transform::TmvaAdaBoost;
+    baseScore_.assign(nOutputs_, 0.0f);
+    yesNoLeaf_ = yesNoLeaf;
+
+    int nTrees = 0;
+    for (auto& bt : weights->children) {
+        if (bt.name != "BinaryTree") continue;
+        const XmlElement* top = bt.child("Node");
+        if (!top) {
+            error_ = "empty tree " + std::to_string(nTrees);
+            return false;
+        }
+        RawTree raw;
+        raw.output = multiclass ? nTrees % nClass : 0;
+        raw.weight = grad ? 1.0f : static_cast<float>(bt.number("boostWeight", 1));
+        // Depth first over the nested nodes; children are numbered as found
+        std::vector<std::pair<const XmlElement*, int>> stack{{top, 0}};
+        raw.left.push_back(-1);
+        raw.right.push_back(-1);
+        raw.feature.push_back(0);
+        raw.threshold.push_back(0);
+        raw.value.push_back(0);
+        raw.missingRight.push_back(0);
+        while (!stack.empty()) {
+            auto [node, i] = stack.back();
+            stack.pop_back();
+            if (node->number("NCoef", 0) > 0) {
+                error_ = "Fisher cuts are not supported";
+                return false;
+            }
+            const XmlElement* l = nullptr;
+            const XmlElement* r = nullptr;
+            for (auto& c : node->children) {
+                if (c.name != "Node") continue;
+                const std::string* pos = c.attr("pos");
+                if (pos && *pos == "l") l = &c;
+                if (pos && *pos == "r") r = &c;
+            }
+            int ivar = static_cast<int>(node->number("IVar", -1));
+            if (!l || !r || ivar < 0) {
+                // Leaf: Grad trees are regression trees (response), AdaBoost
+                // and friends use the node type (+1 / -1) or the purity
+                raw.value[i] = static_cast<float>(grad ? node->number("res", 0)
+                                                       : yesNoLeaf ? node->number("nType", 0)
+                                                                   : node->number("purity", 0));
+                continue;
+            }
+            if (ivar >= static_cast<int>(featureNames_.size())) {
+                error_ = "node uses unknown variable " + std::to_string(ivar);
+                return false;
+            }
+            // TMVA goes right when (x >= cut) == cType; store the branch
+            // taken for x >= cut as our right child
+            if (node->number("cType", 1) == 0) std::swap(l, r);
+            int li = static_cast<int>(raw.left.size());
+            for (int k = 0; k < 2; ++k) {
+                raw.left.push_back(-1);
+                raw.right.push_back(-1);
+                raw.feature.push_back(0);
+                raw.threshold.push_back(0);
+                raw.value.push_back(0);
+                raw.missingRight.push_back(0);
+            }
+            raw.left[i] = li;
+            raw.right[i] = li + 1;
+            raw.feature[i] = ivar;
+            raw.threshold[i] = ceilFloat(node->number("Cut", 0));
+            stack.push_back({l, li});
+            stack.push_back({r, li + 1});
+        }
+        if (!addTree(raw)) {
+            error_ = "malformed tree " + std::to_string(nTrees);
+            return false;
+        }
+        ++nTrees;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Flattening
+// ---------------------------------------------------------------------------
+bool TreeEnsemble::addTree(const RawTree& tree) {
+    // Breadth first, the two children of a node in consecutive slots. A
+    // node reached twice (a cycle or shared child) makes the walk visit
+    // more nodes than the tree has.
+    int32_t root = static_cast<int32_t>(nodes_.size());
+    nodes_.push_back({});
+    struct Pending {
+        int raw;
+        int32_t flat;
+        int depth;
+    };
+    std::deque<Pending> queue{{0, root, 0}};
+    int depth = 0;
+    std::size_t visited = 0;
+    while (!queue.empty()) {
+        if (++visited > tree.left.size()) return false;
+        auto [i, f, d] = queue.front();
+        queue.pop_front();
+        Node& node = nodes_[f];
+        if (tree.left[i] < 0) {
+            node.threshold = std::numeric_limits<float>::quiet_NaN();
+            node.left = f;
+            node.feature = 0;
+            node.missingRight = 0;
+            node.value = tree.value[i];
+            continue;
+        }
+        // node is not used past the resize below
+        int32_t child = static_cast<int32_t>(nodes_.size());
+        node.threshold = tree.threshold[i];
+        node.left = child;
+        node.feature = static_cast<uint16_t>(tree.feature[i]);
+        node.missingRight = tree.missingRight[i] ? 1 : 0;
+        nodes_.resize(nodes_.size() + 2);
+        depth = std::max(depth, d + 1);
+        queue.push_back({tree.left[i], child, d + 1});
+        queue.push_back({tree.right[i], child + 1, d + 1});
+    }
+    roots_.push_back(root);
+    depth_.push_back(depth);
+    treeOutput_.push_back(tree.output);
+    treeWeight_.push_back(tree.weight);
+    weightSum_ += tree.weight;
+    return true;
+}
+
+int TreeEnsemble::getMaxDepth() const {
+    return depth_.empty() ? 0 : *std::max_element(depth_.begin(), depth_.end());
+}
+
+void TreeEnsemble::getOutputRange(double& lo, double& hi) const {
+    switch (transform_) {
+        case Transform::Sigmoid:
+        case Transform::Softmax:
+            lo = 0;
+            hi = 1;
+            return;
+        case Transform::TmvaGrad:
+            lo = -1;
+            hi = 1;
+            return;
+        case Transform::TmvaAdaBoost:
+            lo = yesNoLeaf_ ? -1 : 0;
+            hi = 1;
+            return;
+        case Transform::Raw:
+            break;
+    }
+    // Sum of the smallest / largest leaf of every tree, widest output
+    std::vector<double> lows(baseScore_.begin(), baseScore_.end());
+    std::vector<double> highs(baseScore_.begin(), baseScore_.end());
+    for (std::size_t t = 0; t < roots_.size(); ++t) {
+        int32_t end = t + 1 < roots_.size() ? roots_[t + 1] : static_cast<int32_t>(nodes_.size());
+        double mn = std::numeric_limits<double>::max(), mx = std::numeric_limits<double>::lowest();
+        for (int32_t i = roots_[t]; i < end; ++i) {
+            if (nodes_[i].left != i) continue;
+            mn = std::min(mn, static_cast<double>(nodes_[i].value));
+            mx = std::max(mx, static_cast<double>(nodes_[i].value));
+        }
+        lows[treeOutput_[t]] += treeWeight_[t] * mn;
+        highs[treeOutput_[t]] += treeWeight_[t] * mx;
+    }
+    lo = *std::min_element(lows.begin(), lows.end());
+    hi = *std::max_element(highs.begin(), highs.end());
+    if (!(hi > lo)) hi = lo + 1;
+}
+
+std::vector<std::pair<float, float>> TreeEnsemble::getSplitRanges() const {
+    std::vector<std::pair<float, float>> ranges(featureNames_.size(),
+                                                {std::numeric_limits<float>::max(),
+                                                 std::numeric_limits<float>::lowest()});
+    for (std::size_t i = 0; i < nodes_.size(); ++i) {
+        const Node& n = nodes_[i];
+        if (n.left == static_cast<int32_t>(i)) continue;
+        ranges[n.feature].first = std::min(ranges[n.feature].first, n.threshold);
+        ranges[n.feature].second = std::max(ranges[n.feature].second, n.threshold);
+    }
+    for (auto& r : ranges) {
+        if (r.first > r.second) r = {0.0f, 1.0f};
+    }
+    return ranges;
+}
+
+// ---------------------------------------------------------------------------
+// Inference
+// ---------------------------------------------------------------------------
+// Every event takes exactly depth steps; leaves loop on themselves
+void TreeEnsemble::walkScalar(const Node* nodes, const float* x, std::size_t nf, int32_t* idx,
+                              std::size_t begin, std::size_t end, int depth) {
+    for (int d = 0; d < depth; ++d) {
+        for (std::size_t j = begin; j < end; ++j) {
+            const Node& nd = nodes[idx[j]];
+            const float v = x[j * nf + nd.feature];
+            idx[j] = nd.left + ((v >= nd.threshold) | ((v != v) & nd.missingRight));
+        }
+    }
+}
+
+#ifdef TREEENSEMBLE_X86_SIMD
+// Eight events per vector, gathering their nodes and inputs. Depth is the
+// outer loop so the gathers of the vectors of a block overlap.
+__attribute__((target("avx2")))
+void TreeEnsemble::walkAVX2(const Node* nodes, const float* x, std::size_t nf, int32_t* idx,
+                            std::size_t m, int depth) {
+    static_assert(sizeof(Node) == 16 && offsetof(Node, threshold) == 0 && offsetof(Node, left) == 4 &&
+                      offsetof(Node, feature) == 12 && offsetof(Node, missingRight) == 14,
+                  "walkAVX2 gathers Node fields by byte offset");
+    const char* base = reinterpret_cast<const char*>(nodes);
+    const std::size_t vecEnd = m & ~std::size_t(7);
+    const __m256i laneRow = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32(static_cast<int>(nf)));
+    const __m256i featureMask = _mm256_set1_epi32(0xffff);
+    const __m256i missingBit = _mm256_set1_epi32(0x10000);
+    for (int d = 0; d < depth; ++d) {
+        for (std::size_t j = 0; j < vecEnd; j += 8) {
+            __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + j));
+            __m256i off = _mm256_slli_epi32(id, 4); // byte offset of the node
+            __m256 threshold = _mm256_i32gather_ps(reinterpret_cast<const float*>(base), off, 1);
+            __m256i left = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + 4), off, 1);
+            __m256i meta = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + 12), off, 1);
+            __m256i row = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(j * nf)), laneRow);
+            __m256 v = _mm256_i32gather_ps(x, _mm256_add_epi32(row, _mm256_and_si256(meta, featureMask)), 4);
+            __m256i ge = _mm256_castps_si256(_mm256_cmp_ps(v, threshold, _CMP_GE_OQ));
+            __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+            __m256i missing = _mm256_cmpeq_epi32(_mm256_and_si256(meta, missingBit), missingBit);
+            // Comparison masks are -1: subtracting them adds one
+            __m256i go = _mm256_or_si256(ge, _mm256_and_si256(nan, missing));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(idx + j), _mm256_sub_epi32(left, go));
+        }
+    }
+    // The scalar tail is SSE code: leave no dirty upper halves behind
+    _mm256_zeroupper();
+    walkScalar(nodes, x, nf, idx, vecEnd, m, depth);
+}
+#endif
+
+void TreeEnsemble::predict(const float* rows, std::size_t n, float* out) const {
+    predict(rows, n, out, EventSelector::detectSimdLevel());
+}
+
+void TreeEnsemble::predict(const float* rows, std::size_t n, float* out, SimdLevel level) const {
+    // Never run an instruction set the CPU does not have; AVX-512 CPUs run
+    // the AVX2 kernel
+    level = std::min(level, EventSelector::detectSimdLevel());
+    constexpr std::size_t kBlock = 64;
+    const std::size_t nf = featureNames_.size();
+    const std::size_t nOut = static_cast<std::size_t>(nOutputs_);
+    const Node* nodes = nodes_.data();
+    int32_t idx[kBlock];
+    // Sums of the current block; on the stack for the usual few outputs
+    constexpr std::size_t kStackOutputs = 8;
+    double stackSum[kBlock * kStackOutputs];
+    std::vector<double> heapSum(nOut > kStackOutputs ? kBlock * nOut : 0);
+    double* sum = nOut > kStackOutputs ? heapSum.data() : stackSum;
+
+    for (std::size_t b = 0; b < n; b += kBlock) {
+        const std::size_t m = std::min(kBlock, n - b);
+        const float* x = rows + b * nf;
+        // Fewer than eight events would all go through the scalar tail
+        const bool simd = level != SimdLevel::Scalar && m >= 8;
+        std::fill(sum, sum + m * nOut, 0.0);
+
+        for (std::size_t t = 0; t < roots_.size(); ++t) {
+            for (std::size_t j = 0; j < m; ++j) idx[j] = roots_[t];
+#ifdef TREEENSEMBLE_X86_SIMD
+            if (simd) walkAVX2(nodes, x, nf, idx, m, depth_[t]);
+            else
+#endif
+                walkScalar(nodes, x, nf, idx, 0, m, depth_[t]);
+            const double w = treeWeight_[t];
+            double* s = sum + treeOutput_[t];
+            for (std::size_t j = 0; j < m; ++j) s[j * nOut] += w * nodes[idx[j]].value;
+        }
+
+        float* o = out + b * nOut;
+        for (std::size_t j = 0; j < m; ++j) {
+            const double* s = sum + j * nOut;
+            float* oj = o + j * nOut;
+            switch (transform_) {
+                case Transform::Raw:
+                    for (std::size_t k = 0; k < nOut; ++k) oj[k] = static_cast<float>(s[k] + baseScore_[k]);
+                    break;
+                case Transform::Sigmoid:
+                    for (std::size_t k = 0; k < nOut; ++k) {
+                        oj[k] = static_cast<float>(1 / (1 + std::exp(-(s[k] + baseScore_[k]))));
+                    }
+                    break;
+                case Transform::Softmax: {
+                    double mx = s[0] + baseScore_[0];
+                    for (std::size_t k = 1; k < nOut; ++k) mx = std::max(mx, s[k] + baseScore_[k]);
+                    double norm = 0;
+                    for (std::size_t k = 0; k < nOut; ++k) norm += std::exp(s[k] + baseScore_[k] - mx);
+                    for (std::size_t k = 0; k < nOut; ++k) {
+                        oj[k] = static_cast<float>(std::exp(s[k] + baseScore_[k] - mx) / norm);
+                    }
+                    break;
+                }
+                case Transform::TmvaGrad:
+                    oj[0] = static_cast<float>(2 / (1 + std::exp(-2 * s[0])) - 1);
+                    break;
+                case Transform::TmvaAdaBoost:
+                    oj[0] = weightSum_ > std::numeric_limits<double>::epsilon()
+                                ? static_cast<float>(s[0] / weightSum_) : 0.0f;
+                    break;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Event-loop variables
+// ---------------------------------------------------------------------------
+std::string BdtVariable::plotName(int output) const {
+    return model && model->getNumOutputs() > 1 ? name + "_" + std::to_string(output) : name;
+}
+
+PlotDef BdtVariable::plotDef(int output) const {
+    std::string label = name;
+    if (model && model->getNumOutputs() > 1) label += " output " + std::to_string(output);
+    return PlotDef{nbins, xmin, xmax, label, "", FieldRef{}};
+}
+
+bool makeBdtVariable(const std::string& name, const std::string& path, BdtVariable& var,
+                     std::string& error) {
+    auto model = std::make_shared<TreeEnsemble>();
+    if (!model->load(path)) {
+        error = model->getError();
+        return false;
+    }
+
+    // Every plotted field by name; scheme fields also under each prefix
+    std::map<std::string, FieldRef> fields;
+    for (auto& [n, def] : getPlotDefs()) fields[n] = def.field;
+    for (auto& def : getSparseAxisDefs()) fields.emplace(def.name, def.field);
+    for (auto& [n, def] : getSchemePlotDefs()) {
+        fields[n] = def.field;
+        for (auto& [key, scheme] : getSchemes()) fields[scheme.prefix + n] = def.field;
+    }
+
+    var = BdtVariable();
+    var.name = name;
+    for (auto& feature : model->getFeatureNames()) {
+        auto it = fields.find(feature);
+        if (it == fields.end() || it->second.source == FieldRef::None) {
+            error = "Model " + path + ": unknown feature '" + feature + "'";
+            return false;
+        }
+        var.features.push_back(it->second);
+    }
+    model->getOutputRange(var.xmin, var.xmax);
+    var.model = std::move(model);
+    return true;
+}
@@ -0,0 +1,72 @@
+#include "TreeLayout.h"
+#include <fnmatch.h>
+#include <cstdlib>
+
+namespace {
+struct Algorithm {
+    const char* name;
+    int id;
+    int defaultLevel;
+};
+constexpr Algorithm kAlgorithms[] = {
+    {"zlib", 1, 5}, {"lzma", 2, 5}, {"lz4", 4, 4}, {"zstd", 5, 5},
+};
+}
+
+bool parseCompression(const std::string& spec, TreeLayout& layout) {
+    std::string name = spec.substr(0, spec.find(':'));
+    if (name == "none") {
+        layout.algorithm = 0;
+        layout.level = 0;
+        return true;
+    }
+    for (auto& a : kAlgorithms) {
+        if (name != a.name) continue;
+        int level = a.defaultLevel;
+        if (name.size() < spec.size()) {
+            char* end = nullptr;
+            level = static_cast<int>(std::strtol(spec.c_str() + name.size() + 1, &end, 10));
+            if (*end != '\0' || level < 1 || level > 9) return false;
+        }
+        layout.algorithm = a.id;
+        layout.level = level;
+        return true;
+    }
+    return false;
+}
+
+std::string compressionName(const TreeLayout& layout) {
+    if (layout.algorithm < 0) return "default";
+    if (layout.level == 0) return "none";
+    for (auto& a : kAlgorithms) {
+        if (a.id == layout.algorithm) return std::string(a.name) + ":" + std::to_string(layout.level);
+    }
+    return std::to_string(layout.algorithm * 100 + layout.level);
+}
+
+void applyFileLayout(TFile* file, const TreeLayout& layout) {
+    if (layout.algorithm < 0) return;
+    file->SetCompressionSettings(layout.algorithm * 100 + layout.level);
+}
+
+void applyTreeLayout(TTree* tree, const TreeLayout& layout) {
+    if (layout.autoFlush != 0) tree->SetAutoFlush(layout.autoFlush);
+    if (layout.basketSize > 0) tree->SetBasketSize("*", layout.basketSize);
+}
+
+std::vector<std::size_t> hotFirstOrder(const std::vector<std::string>& names,
+                                       const std::vector<std::string>& hot) {
+    std::vector<std::size_t> order;
+    std::vector<char> placed(names.size(), 0);
+    for (auto& pattern : hot) {
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            if (placed[i] || fnmatch(pattern.c_str(), names[i].c_str(), 0) != 0) continue;
+            placed[i] = 1;
+            order.push_back(i);
+        }
+    }
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (!placed[i]) order.push_back(i);
+    }
+    return order;
+}
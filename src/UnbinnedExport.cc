@@ -0,0 +1,177 @@
+#include "UnbinnedExport.h"
+#include "ResultCache.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint32_t kUnbinnedVersion = 1;
+static const char kUnbinnedMagic[4] = {'H', 'H', 'U', 'B'};
+static constexpr std::size_t kAlign = 64;
+
+struct UnbinnedHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t nEvents;
+    uint32_t nColumns;
+    uint32_t reserved;
+    char     scheme[40];   // NUL-padded
+};
+
+struct UnbinnedColumnEntry {
+    char     name[40];     // NUL-padded
+    char     type;         // leafTypeCode
+    char     reserved[7];
+    uint64_t offset;       // from the start of the file
+    uint64_t bytes;
+};
+
+static_assert(sizeof(UnbinnedHeader) == kAlign, "header must be one 64-byte block");
+static_assert(sizeof(UnbinnedColumnEntry) == kAlign, "column entry must be one 64-byte block");
+
+static std::size_t alignUp(std::size_t n) {
+    return (n + kAlign - 1) / kAlign * kAlign;
+}
+
+void UnbinnedEvents::append(const UnbinnedEvents& other) {
+    mgg.insert(mgg.end(), other.mgg.begin(), other.mgg.end());
+    mjj.insert(mjj.end(), other.mjj.begin(), other.mjj.end());
+    weight.insert(weight.end(), other.weight.begin(), other.weight.end());
+    category.insert(category.end(), other.category.begin(), other.category.end());
+}
+
+void UnbinnedEvents::clear() {
+    mgg.clear();
+    mjj.clear();
+    weight.clear();
+    category.clear();
+}
+
+unsigned char bdtCategory(const float* scores) {
+    return static_cast<unsigned char>(std::max_element(scores, scores + 4) - scores);
+}
+
+unsigned char bdtCategory(const EventData& evt) {
+    return bdtCategory(evt.MultiBDT_output);
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+bool writeUnbinnedFile(const std::string& path, const std::string& schemeKey,
+                       const UnbinnedEvents& events) {
+    struct Source {
+        const char* name;
+        char type;
+        const void* data;
+        std::size_t bytes;
+    };
+    std::size_t n = events.size();
+    const Source sources[] = {
+        {"mgg",      'D', events.mgg.data(),      n * sizeof(double)},
+        {"mjj",      'D', events.mjj.data(),      n * sizeof(double)},
+        {"weight",   'D', events.weight.data(),   n * sizeof(double)},
+        {"category", 'b', events.category.data(), n * sizeof(unsigned char)},
+    };
+    constexpr uint32_t nColumns = sizeof(sources) / sizeof(sources[0]);
+    if (schemeKey.size() >= sizeof(UnbinnedHeader::scheme)) {
+        std::cerr << "ERROR: Scheme key '" << schemeKey << "' too long for " << path << std::endl;
+        return false;
+    }
+
+    UnbinnedHeader header{};
+    std::memcpy(header.magic, kUnbinnedMagic, 4);
+    header.version  = kUnbinnedVersion;
+    header.nEvents  = n;
+    header.nColumns = nColumns;
+    std::memcpy(header.scheme, schemeKey.data(), schemeKey.size());
+
+    UnbinnedColumnEntry entries[nColumns] = {};
+    std::size_t offset = sizeof(UnbinnedHeader) + nColumns * sizeof(UnbinnedColumnEntry);
+    for (uint32_t c = 0; c < nColumns; ++c) {
+        std::strncpy(entries[c].name, sources[c].name, sizeof(entries[c].name) - 1);
+        entries[c].type   = sources[c].type;
+        entries[c].offset = offset;
+        entries[c].bytes  = sources[c].bytes;
+        offset = alignUp(offset + sources[c].bytes);
+    }
+
+    return writeFileAtomic(path, [&](std::ostream& out) {
+        static const char zeros[kAlign] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+        std::size_t pos = sizeof(header) + sizeof(entries);
+        for (uint32_t c = 0; c < nColumns; ++c) {
+            out.write(zeros, static_cast<std::streamsize>(entries[c].offset - pos));
+            out.write(static_cast<const char*>(sources[c].data),
+                      static_cast<std::streamsize>(sources[c].bytes));
+            pos = entries[c].offset + sources[c].bytes;
+        }
+    });
+}
+
+// ---------------------------------------------------------------------------
+// Reading
+// ---------------------------------------------------------------------------
+UnbinnedFile::UnbinnedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error_ = "Cannot open " + path;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(UnbinnedHeader)) {
+        close(fd);
+        error_ = path + " is not an unbinned export";
+        return;
+    }
+    bytes_ = static_cast<std::size_t>(st.st_size);
+    void* p = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        error_ = "Cannot map " + path;
+        return;
+    }
+    const char* base = static_cast<const char*>(p);
+
+    // Only the header and the column table are read; the arrays are used in place
+    UnbinnedHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    std::size_t tableEnd = sizeof(header) + std::size_t(header.nColumns) * sizeof(UnbinnedColumnEntry);
+    if (!std::equal(header.magic, header.magic + 4, kUnbinnedMagic) ||
+        header.version != kUnbinnedVersion || header.nColumns > 256 || tableEnd > bytes_) {
+        munmap(p, bytes_);
+        error_ = path + " is not an unbinned export (or has another version)";
+        return;
+    }
+    for (uint32_t c = 0; c < header.nColumns; ++c) {
+        UnbinnedColumnEntry e;
+        std::memcpy(&e, base + sizeof(header) + c * sizeof(e), sizeof(e));
+        std::size_t size = leafTypeSize(e.type);
+        if (size == 0 || e.offset % kAlign != 0 || e.bytes != header.nEvents * size ||
+            e.offset + e.bytes > bytes_) {
+            munmap(p, bytes_);
+            columns_.clear();
+            error_ = path + " is truncated or corrupt";
+            return;
+        }
+        columns_.push_back({std::string(e.name, strnlen(e.name, sizeof(e.name))), e.type,
+                            static_cast<std::size_t>(e.offset)});
+    }
+    data_ = base;
+    nEvents_ = static_cast<std::size_t>(header.nEvents);
+    scheme_.assign(header.scheme, strnlen(header.scheme, sizeof(header.scheme)));
+}
+
+UnbinnedFile::~UnbinnedFile() {
+    if (data_) munmap(const_cast<char*>(data_), bytes_);
+}
+
+std::vector<std::string> UnbinnedFile::getColumnNames() const {
+    std::vector<std::string> names;
+    for (auto& c : columns_) names.push_back(c.name);
+    return names;
+}
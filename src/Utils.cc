@@ -1,6 +1,14 @@
 #include "Utils.h"
 #include <TSystem.h>
 #include <cmath>
+#include <glob.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <set>
+
+namespace fs = std::filesystem;
 
 std::string schemeBranch(const std::string& prefix, const std::string& suffix) {
     return prefix + suffix;
@@ -10,6 +18,114 @@ void ensureDirectory(const std::string& path) {
     gSystem->mkdir(path.c_str(), true);
 }
 
+bool fileExists(const std::string& path) {
+    std::error_code ec;
+    return fs::is_regular_file(path, ec);
+}
+
 bool isSentinel(double val, double sentinel) {
     return std::abs(val - sentinel) < 0.1;
 }
+
+uint64_t hashBytes(const void* data, std::size_t n, uint64_t h) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static bool hasSuffix(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void expandSpec(const std::string& spec, std::vector<std::string>& out,
+                       std::vector<std::string>* unmatched, int depth) {
+    std::error_code ec;
+
+    // Directory: every ROOT or Parquet file directly inside it
+    if (fs::is_directory(spec, ec)) {
+        std::vector<std::string> files;
+        for (auto& entry : fs::directory_iterator(spec, ec)) {
+            std::string path = entry.path().string();
+            if (entry.is_regular_file(ec) &&
+                (hasSuffix(path, ".root") || hasSuffix(path, ".parquet") || hasSuffix(path, ".pq"))) {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        if (files.empty() && unmatched) unmatched->push_back(spec);
+        out.insert(out.end(), files.begin(), files.end());
+        return;
+    }
+
+    // File list: one spec per line (nested lists allowed, bounded depth)
+    if ((hasSuffix(spec, ".txt") || hasSuffix(spec, ".list")) && fs::is_regular_file(spec, ec)) {
+        if (depth > 4) {
+            if (unmatched) unmatched->push_back(spec);
+            return;
+        }
+        std::ifstream in(spec);
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') continue;
+            size_t end = line.find_last_not_of(" \t\r");
+            expandSpec(line.substr(start, end - start + 1), out, unmatched, depth + 1);
+        }
+        return;
+    }
+
+    // Remote URLs are passed through untouched (TFile::Open handles them)
+    if (spec.find("://") != std::string::npos) {
+        out.push_back(spec);
+        return;
+    }
+
+    // Glob (a plain existing file matches itself)
+    glob_t g;
+    if (glob(spec.c_str(), 0, nullptr, &g) == 0) {
+        for (size_t i = 0; i < g.gl_pathc; ++i) out.push_back(g.gl_pathv[i]);
+    } else if (unmatched) {
+        unmatched->push_back(spec);
+    }
+    globfree(&g);
+}
+
+std::vector<std::string> expandInputs(const std::vector<std::string>& specs,
+                                      std::vector<std::string>* unmatched) {
+    std::vector<std::string> files;
+    for (auto& spec : specs) expandSpec(spec, files, unmatched, 0);
+
+    // De-duplicate while keeping the first occurrence order
+    std::vector<std::string> result;
+    std::set<std::string> seen;
+    for (auto& f : files) {
+        if (seen.insert(f).second) result.push_back(f);
+    }
+    return result;
+}
+
+std::vector<std::string> parseBranchList(const std::string& spec) {
+    std::vector<std::string> names;
+    if (fileExists(spec)) {
+        std::ifstream in(spec);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream iss(line.substr(0, line.find('#')));
+            std::string name;
+            // Skips blank lines and the "Entries:" / "Branches:" header lines
+            if (!(iss >> name) || name.back() == ':') continue;
+            names.push_back(name);
+        }
+        return names;
+    }
+    std::istringstream iss(spec);
+    std::string name;
+    while (std::getline(iss, name, ',')) {
+        if (!name.empty()) names.push_back(name);
+    }
+    return names;
+}
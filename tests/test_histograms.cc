@@ -0,0 +1,172 @@
+// Round-trip checks of the exact accumulators: ExactSum cancellation, carries
+// and negative totals; SparseHist keys at the edges of every axis, projections
+// against a dense fill of the same events, and a write/read round trip.
+//
+// Usage: test_histograms   (exits 1 on a failed check)
+
+#include "ExactSum.h"
+#include "FastHist.h"
+#include "SparseHist.h"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cout << "FAIL " << what << std::endl;
+    ++nFailed;
+}
+
+// --- ExactSum ---
+
+static void testExactSum() {
+    ExactSum s;
+    s += 1e20;
+    s += 1.0;
+    s += -1e20;
+    check(s.value() == 1.0, "1e20 + 1 - 1e20");
+
+    // Terms that cancel leave exactly the empty sum
+    ExactSum c;
+    for (double x : {1e15, 0.1, 3.0e-20, -0.1, -1e15, -3.0e-20}) c += x;
+    check(c == ExactSum() && c.value() == 0.0, "cancelling terms");
+
+    // 2^31 sits on the top bit of the low 128-bit limb: adding it twice
+    // carries into the high limb, and subtracting 2^32 borrows back
+    ExactSum carry;
+    carry += std::ldexp(1.0, 31);
+    carry += std::ldexp(1.0, 31);
+    check(carry.value() == std::ldexp(1.0, 32), "carry into the high limb");
+    carry += -std::ldexp(1.0, 32);
+    check(carry == ExactSum(), "borrow out of the high limb");
+
+    // Negative totals, down through zero and across the limbs
+    ExactSum neg;
+    neg += 1.25;
+    neg += -3.5;
+    check(neg.value() == -2.25, "negative total");
+    neg += -std::ldexp(1.0, 40);
+    neg += std::ldexp(1.0, -90);
+    check(neg.value() == -std::ldexp(1.0, 40) - 2.25, "large negative total");
+    neg += std::ldexp(1.0, 40);
+    neg += 2.25;
+    check(neg.value() == std::ldexp(1.0, -90), "back to a tiny positive total");
+
+    // Any order and any split of the terms gives the same bits
+    std::vector<double> terms;
+    uint64_t seed = 12345;
+    for (int i = 0; i < 1000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        double mant = static_cast<double>(seed >> 11) / 9007199254740992.0 - 0.5;
+        terms.push_back(std::ldexp(mant, static_cast<int>(seed % 80) - 30));
+    }
+    ExactSum forward, backward, left, right;
+    for (double x : terms) forward += x;
+    for (auto it = terms.rbegin(); it != terms.rend(); ++it) backward += *it;
+    for (std::size_t i = 0; i < terms.size(); ++i) (i % 3 == 0 ? left : right) += terms[i];
+    right += left;
+    check(forward == backward && forward == right, "order and split independence");
+
+    ExactSum special(1.0);
+    special += std::numeric_limits<double>::infinity();
+    check(std::isinf(special.value()), "inf dominates");
+}
+
+// --- SparseHist ---
+
+// Value of the edges of an axis: underflow, first bin, last bin, overflow
+static double edgeValue(const SparseAxis& ax, int which) {
+    double width = (ax.xmax - ax.xmin) / ax.nbins;
+    switch (which) {
+    case 0:  return ax.xmin - width;
+    case 1:  return ax.xmin;
+    case 2:  return ax.xmax - 0.5 * width;
+    default: return ax.xmax;
+    }
+}
+
+static bool sameContents(const FastHist1D& a, const FastHist1D& b) {
+    return a.getSumw() == b.getSumw() && a.getSumw2() == b.getSumw2() && a.getEntries() == b.getEntries();
+}
+
+static bool sameContents(const FastHist2D& a, const FastHist2D& b) {
+    return a.getSumw() == b.getSumw() && a.getSumw2() == b.getSumw2() && a.getEntries() == b.getEntries();
+}
+
+static void testSparseHist() {
+    // Different sizes per axis so the mixed-radix strides all differ
+    const std::vector<SparseAxis> axes = {{"a", 3, 0.0, 3.0}, {"b", 4, -1.0, 1.0}, {"c", 5, 10.0, 20.0}};
+    SparseHist hist("edges", axes);
+
+    std::vector<std::vector<double>> events;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            for (int k = 0; k < 4; ++k)
+                events.push_back({edgeValue(axes[0], i), edgeValue(axes[1], j), edgeValue(axes[2], k)});
+    // NaN counts as overflow, as in FastHist1D
+    events.push_back({std::nan(""), 0.0, 15.0});
+    events.push_back({1.5, std::nan(""), std::nan("")});
+
+    std::vector<double> weights;
+    for (std::size_t e = 0; e < events.size(); ++e) weights.push_back(0.25 + 0.125 * static_cast<double>(e % 7));
+    for (std::size_t e = 0; e < events.size(); ++e) hist.fill(events[e].data(), weights[e]);
+    check(hist.getOccupiedCells() == 64 + 2, "one cell per edge combination");
+    check(hist.getEntries() == static_cast<long long>(events.size()), "entries");
+
+    // Each axis projected with no cuts, against a dense fill
+    for (int a = 0; a < 3; ++a) {
+        FastHist1D dense("d", "", axes[a].nbins, axes[a].xmin, axes[a].xmax);
+        for (std::size_t e = 0; e < events.size(); ++e) dense.fill(events[e][a], weights[e]);
+        check(sameContents(hist.project1D(a), dense), "project1D axis " + axes[a].name);
+    }
+
+    // Cuts keep whole bins: [10, 14) on c passes its first two bins only;
+    // [-inf, 0) on b passes its underflow and first two bins
+    const std::vector<SparseCut> cuts = {{2, 10.0, 14.0}, {1, -HUGE_VAL, 0.0}};
+    auto passes = [&](const std::vector<double>& x) {
+        int bc = fastHistBin(x[2], axes[2].nbins, axes[2].xmin, axes[2].xmax);
+        int bb = fastHistBin(x[1], axes[1].nbins, axes[1].xmin, axes[1].xmax);
+        return bc >= 1 && bc <= 2 && bb <= 2;
+    };
+    FastHist1D dense1("d", "", axes[0].nbins, axes[0].xmin, axes[0].xmax);
+    FastHist2D dense2("d", "", axes[0].nbins, axes[0].xmin, axes[0].xmax, axes[2].nbins, axes[2].xmin, axes[2].xmax);
+    for (std::size_t e = 0; e < events.size(); ++e) {
+        if (!passes(events[e])) continue;
+        dense1.fill(events[e][0], weights[e]);
+        dense2.fill(events[e][0], events[e][2], weights[e]);
+    }
+    check(sameContents(hist.project1D(0, cuts), dense1), "project1D with cuts");
+    // Cuts on a projected axis apply too
+    check(sameContents(hist.project2D(0, 2, cuts), dense2), "project2D with cuts");
+
+    // Write and read back: same cells, same projections
+    std::stringstream buf;
+    hist.write(buf);
+    SparseHist back;
+    check(back.read(buf), "read");
+    check(back.getName() == hist.getName() && back.sameAxes(hist), "axes round trip");
+    check(back.getOccupiedCells() == hist.getOccupiedCells() && back.getEntries() == hist.getEntries(),
+          "cells round trip");
+    for (int a = 0; a < 3; ++a)
+        check(sameContents(back.project1D(a, cuts), hist.project1D(a, cuts)), "projection round trip");
+
+    // A truncated stream is refused and leaves the store unchanged
+    std::string bytes = buf.str();
+    std::stringstream shortBuf(bytes.substr(0, bytes.size() / 2));
+    check(!back.read(shortBuf) && back.getOccupiedCells() == hist.getOccupiedCells(), "truncated read");
+}
+
+int main() {
+    testExactSum();
+    testSparseHist();
+    std::cout << "test_histograms: " << (nFailed == 0 ? "OK" : std::to_string(nFailed) + " failed")
+              << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
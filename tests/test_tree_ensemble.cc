@@ -0,0 +1,146 @@
+// Known-model check of TreeEnsemble: a two-tree XGBoost JSON model and a
+// two-tree TMVA AdaBoost weight file, with outputs computed by hand,
+// including NaN (missing) routing and a TMVA cType=0 node. Every row set
+// is predicted with the scalar walk and the AVX2 walk (when the CPU has it),
+// which must agree bit for bit.
+//
+// Usage: test_tree_ensemble   (exits 1 on a failed check)
+
+#include "TreeEnsemble.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cout << "FAIL " << what << std::endl;
+    ++nFailed;
+}
+
+static std::string writeModel(const std::string& name, const std::string& text) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("test_tree_ensemble_" + std::to_string(getpid()) + "_" + name)).string();
+    std::ofstream(path) << text;
+    return path;
+}
+
+// Rows cycle through the cases so that blocks have full AVX2 vectors and a
+// scalar tail
+static void checkModel(const std::string& what, const TreeEnsemble& model,
+                       const std::vector<std::vector<float>>& cases, const std::vector<float>& expected) {
+    const std::size_t n = 21, nf = static_cast<std::size_t>(model.getNumFeatures());
+    std::vector<float> rows;
+    for (std::size_t i = 0; i < n; ++i) {
+        for (float v : cases[i % cases.size()]) rows.push_back(v);
+    }
+    std::vector<float> scalar(n), simd(n);
+    check(nf == cases[0].size() && model.getNumOutputs() == 1, what + " shape");
+    model.predict(rows.data(), n, scalar.data(), SimdLevel::Scalar);
+    model.predict(rows.data(), n, simd.data(), SimdLevel::AVX2);
+    for (std::size_t i = 0; i < n; ++i) {
+        float want = expected[i % cases.size()];
+        check(std::fabs(scalar[i] - want) < 1e-6f,
+              what + " row " + std::to_string(i) + ": " + std::to_string(scalar[i]) + " != " +
+                  std::to_string(want));
+    }
+    check(std::memcmp(scalar.data(), simd.data(), n * sizeof(float)) == 0, what + " scalar vs AVX2");
+}
+
+static void testXGBoost() {
+    // Tree 0: f0 < 1 ? 0.1 : 0.3, missing left
+    // Tree 1: f1 < 2 ? -0.2 : (f0 < 3 ? 0.05 : 0.4), missing right at the
+    //         root and left below it
+    const std::string json = R"({
+  "learner": {
+    "feature_names": ["f0", "f1"],
+    "learner_model_param": {"base_score": "5E-1", "num_class": "0", "num_feature": "2"},
+    "objective": {"name": "reg:squarederror"},
+    "gradient_booster": {
+      "name": "gbtree",
+      "model": {
+        "tree_info": [0, 0],
+        "trees": [
+          {"left_children": [1, -1, -1], "right_children": [2, -1, -1],
+           "split_indices": [0, 0, 0], "split_conditions": [1.0, 0.1, 0.3],
+           "default_left": [1, 0, 0], "split_type": [0, 0, 0]},
+          {"left_children": [1, -1, 3, -1, -1], "right_children": [2, -1, 4, -1, -1],
+           "split_indices": [1, 0, 0, 0, 0], "split_conditions": [2.0, -0.2, 3.0, 0.05, 0.4],
+           "default_left": [0, 0, 1, 0, 0], "split_type": [0, 0, 0, 0, 0]}
+        ]
+      }
+    }
+  }
+})";
+    TreeEnsemble model;
+    std::string path = writeModel("model.json", json);
+    bool ok = model.load(path);
+    std::filesystem::remove(path);
+    check(ok, "XGBoost load: " + model.getError());
+    if (!ok) return;
+    check(model.getNumTrees() == 2 && model.getMaxDepth() == 2, "XGBoost trees");
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    checkModel("XGBoost", model, {{0.5f, 1.0f}, {1.0f, 2.0f}, {nan, nan}, {5.0f, nan}},
+               {0.5f + 0.1f - 0.2f, 0.5f + 0.3f + 0.05f, 0.5f + 0.1f + 0.05f, 0.5f + 0.3f + 0.4f});
+}
+
+static void testTmva() {
+    // AdaBoost with purity leaves: output = sum(boostWeight x purity) / sum(boostWeight)
+    // Tree A (weight 1): x >= 1 ? 0.8 : 0.2
+    // Tree B (weight 3): cType=0, TMVA goes right when y < 0.5: right 0.9,
+    //                    left 0.1; a missing y fails y >= 0.5, so goes right
+    const std::string xml = R"(<?xml version="1.0"?>
+<MethodSetup Method="BDT::BDT">
+  <Options>
+    <Option name="BoostType" modified="Yes">AdaBoost</Option>
+    <Option name="UseYesNoLeaf" modified="Yes">False</Option>
+  </Options>
+  <Variables NVar="2">
+    <Variable VarIndex="0" Expression="x" Type="F"/>
+    <Variable VarIndex="1" Expression="y" Type="F"/>
+  </Variables>
+  <Classes NClass="2"/>
+  <Transformations NTransformations="0"/>
+  <Weights NTrees="2" AnalysisType="0">
+    <BinaryTree type="DecisionTree" boostWeight="1.0e+00" itree="0">
+      <Node pos="s" depth="0" NCoef="0" IVar="0" Cut="1.0e+00" cType="1" res="0" rms="0" purity="5.0e-01" nType="0">
+        <Node pos="l" depth="1" NCoef="0" IVar="-1" Cut="0" cType="1" res="0" rms="0" purity="2.0e-01" nType="-1"/>
+        <Node pos="r" depth="1" NCoef="0" IVar="-1" Cut="0" cType="1" res="0" rms="0" purity="8.0e-01" nType="1"/>
+      </Node>
+    </BinaryTree>
+    <BinaryTree type="DecisionTree" boostWeight="3.0e+00" itree="1">
+      <Node pos="s" depth="0" NCoef="0" IVar="1" Cut="5.0e-01" cType="0" res="0" rms="0" purity="5.0e-01" nType="0">
+        <Node pos="l" depth="1" NCoef="0" IVar="-1" Cut="0" cType="1" res="0" rms="0" purity="1.0e-01" nType="-1"/>
+        <Node pos="r" depth="1" NCoef="0" IVar="-1" Cut="0" cType="1" res="0" rms="0" purity="9.0e-01" nType="1"/>
+      </Node>
+    </BinaryTree>
+  </Weights>
+</MethodSetup>
+)";
+    TreeEnsemble model;
+    std::string path = writeModel("weights.xml", xml);
+    bool ok = model.load(path);
+    std::filesystem::remove(path);
+    check(ok, "TMVA load: " + model.getError());
+    if (!ok) return;
+    check(model.getTransform() == TreeEnsemble::Transform::TmvaAdaBoost, "TMVA transform");
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    checkModel("TMVA", model, {{0.5f, 0.2f}, {1.0f, 0.5f}, {nan, nan}, {2.0f, 1.0f}},
+               {(0.2f + 3 * 0.9f) / 4, (0.8f + 3 * 0.1f) / 4, (0.2f + 3 * 0.9f) / 4, (0.8f + 3 * 0.1f) / 4});
+}
+
+int main() {
+    testXGBoost();
+    testTmva();
+    std::cout << "test_tree_ensemble: " << (nFailed == 0 ? "OK" : std::to_string(nFailed) + " failed")
+              << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+// CSV -> ROOT TTree converter: memory-mapped input, multithreaded parsing.
+// Compiled replacement for parquet_example/csv_to_root_cmssw.C.
+//
+// Usage: csv_to_root INPUT.csv OUTPUT.root [--tree NAME] [--threads N]
+//                    [--block-mb MB] [--delimiter C]
+//                    [--schema FILE | --infer-schema FILE]
+//                    [--compression ALG[:LEVEL]] [--cluster-entries N | --cluster-mb MB]
+//                    [--basket-kb KB] [--hot-branches FILE|LIST]
+//
+// --schema gives the branch type of each column (branch_list.txt format, see
+// Schema.h); --infer-schema scans the CSV first, writes the narrowest exact
+// type of every column to FILE and converts with it.
+//
+// --compression takes zlib, lzma, lz4, zstd or none (see TreeLayout.h).
+// --basket-kb sets the basket size of the first cluster only: ROOT resizes
+// the baskets when it flushes it (TreeLayout::basketSize).
+// --hot-branches lists the branches to create first, e.g. the ones
+// run_analysis reads (bench_tree_layout --write-hot FILE writes that list).
+
+#include "CsvConverter.h"
+#include "Schema.h"
+#include "Utils.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+int main(int argc, char** argv) {
+    CsvConvertOptions opts;
+    std::vector<std::string> positional;
+    std::string schemaFile, inferFile;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--tree" && i + 1 < argc)           { opts.treeName = argv[++i]; }
+        else if (a == "--threads" && i + 1 < argc)   { opts.threads = std::max(0, std::atoi(argv[++i])); }
+        else if (a == "--block-mb" && i + 1 < argc)  { opts.blockBytes = std::size_t(std::max(1, std::atoi(argv[++i]))) << 20; }
+        else if (a == "--delimiter" && i + 1 < argc) { opts.delimiter = argv[++i][0]; }
+        else if (a == "--schema" && i + 1 < argc)    { schemaFile = argv[++i]; }
+        else if (a == "--infer-schema" && i + 1 < argc) { inferFile = argv[++i]; }
+        else if (a == "--compression" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            if (!parseCompression(spec, opts.layout)) {
+                std::cerr << "ERROR: Unknown compression '" << spec << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (a == "--cluster-entries" && i + 1 < argc) { opts.layout.autoFlush = std::max(1LL, std::atoll(argv[++i])); }
+        else if (a == "--cluster-mb" && i + 1 < argc)   { opts.layout.autoFlush = -(std::max(1LL, std::atoll(argv[++i])) << 20); }
+        else if (a == "--basket-kb" && i + 1 < argc)    { opts.layout.basketSize = std::max(1, std::atoi(argv[++i])) * 1024; }
+        else if (a == "--hot-branches" && i + 1 < argc) { opts.layout.hotBranches = parseBranchList(argv[++i]); }
+        else if (!a.empty() && a[0] != '-')          { positional.push_back(a); }
+        else {
+            std::cerr << "Unknown argument: " << a << std::endl;
+            positional.clear();
+            break;
+        }
+    }
+    if (positional.size() != 2 || (!schemaFile.empty() && !inferFile.empty())) {
+        std::cerr << "Usage: csv_to_root INPUT.csv OUTPUT.root [--tree NAME] [--threads N]\n"
+                     "                   [--block-mb MB] [--delimiter C]\n"
+                     "                   [--schema FILE | --infer-schema FILE]\n"
+                     "                   [--compression ALG[:LEVEL]] [--cluster-entries N | --cluster-mb MB]\n"
+                     "                   [--basket-kb KB] [--hot-branches FILE|LIST]" << std::endl;
+        return 1;
+    }
+    opts.input = positional[0];
+    opts.output = positional[1];
+
+    std::cout << "=== CSV to ROOT ===" << std::endl;
+    std::cout << "Input:  " << opts.input << std::endl;
+    std::cout << "Output: " << opts.output << " (tree '" << opts.treeName << "', compression "
+              << compressionName(opts.layout) << ")" << std::endl;
+
+    if (!schemaFile.empty()) {
+        if (!readSchema(schemaFile, opts.schema)) return 1;
+        std::cout << "Schema: " << schemaFile << " (" << opts.schema.size() << " columns)" << std::endl;
+    } else if (!inferFile.empty()) {
+        std::vector<std::string> names;
+        if (!inferCsvSchema(opts, names, opts.schema)) return 1;
+        if (!writeSchema(inferFile, names, opts.schema)) return 1;
+        std::cout << "Schema: inferred, written to " << inferFile << std::endl;
+    }
+    if (!opts.schema.empty()) {
+        std::map<char, int> nByType;
+        for (auto& [name, type] : opts.schema) ++nByType[type];
+        std::cout << "Types: ";
+        for (auto& [type, n] : nByType) std::cout << " " << type << "=" << n;
+        std::cout << std::endl;
+    }
+
+    CsvConvertReport report = convertCsvToRoot(opts);
+    if (!report.ok) {
+        std::cerr << "ERROR: " << report.error << std::endl;
+        return 1;
+    }
+
+    double mb = report.inputBytes / (1024.0 * 1024.0);
+    std::cout << "Columns:      " << report.columns << std::endl;
+    std::cout << "Entries:      " << report.rows << std::endl;
+    std::cout << "Parse errors: " << report.parseErrors << std::endl;
+    if (report.inexact > 0) {
+        std::cout << "WARNING: " << report.inexact
+                  << " values did not fit their schema type (clamped or rounded)" << std::endl;
+    }
+    std::cout << "Time:         " << report.seconds << " s ("
+              << report.rows / report.seconds << " rows/s, "
+              << mb / report.seconds << " MB/s)" << std::endl;
+    return 0;
+}
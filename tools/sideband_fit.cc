@@ -0,0 +1,138 @@
+// Blinded unbinned fit of the mgg background to the sidebands of the files
+// written by run_analysis --export-unbinned, and the background each fit
+// predicts in mgg windows (see SidebandFit.h).
+//
+// Usage: sideband_fit EXPORT.hhub... [--models LIST] [--window LO:HI ...]
+//                     [--by-category | --category N] [--fit-range LO:HI]
+//                     [--blind LO:HI] [--threads N]
+//
+// LIST is comma-separated: exp, pow, bern1 ... bern8 (default exp,pow,bern2,bern3).
+// The default window is the blinded signal region. Observed counts are
+// given for the unblinded part of a window only.
+
+#include "SidebandFit.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::istringstream iss(s);
+    for (std::string item; std::getline(iss, item, ',');) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static bool parseRange(const std::string& s, double& lo, double& hi) {
+    std::size_t colon = s.find(':');
+    if (colon == std::string::npos) return false;
+    char* end = nullptr;
+    lo = std::strtod(s.c_str(), &end);
+    if (end != s.c_str() + colon) return false;
+    hi = std::strtod(s.c_str() + colon + 1, &end);
+    return *end == '\0' && hi > lo;
+}
+
+static void printFit(const SidebandFitter& fitter, const SidebandFitResult& r,
+                     const std::vector<std::pair<double, double>>& windows) {
+    std::cout << "  " << std::left << std::setw(6) << bkgModelName(r.model) << std::right
+              << " NLL " << std::setprecision(8) << r.nll << std::setprecision(4)
+              << (r.converged ? "" : " (NOT CONVERGED)") << ", " << r.iterations << " it, "
+              << std::setprecision(3) << r.seconds * 1e3 << " ms\n    params:";
+    for (std::size_t p = 0; p < r.params.size(); ++p) {
+        std::cout << " " << std::setprecision(4) << r.params[p] << " +- " << r.errors[p];
+    }
+    std::cout << "\n";
+    for (auto& [lo, hi] : windows) {
+        WindowYield y = fitter.yield(r, lo, hi);
+        std::cout << "    [" << y.lo << ", " << y.hi << "]  expected " << std::setprecision(4) << y.expected
+                  << " +- " << y.statError << " (stat) +- " << y.shapeError << " (shape)";
+        if (y.hi > y.lo) std::cout << ", observed " << y.observed << (y.blinded ? " (blinded part excluded)" : "");
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    std::vector<std::string> modelNames = {"exp", "pow", "bern2", "bern3"};
+    std::vector<std::pair<double, double>> windows;
+    SidebandFitOptions opts;
+    bool byCategory = false;
+    int category = -1;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        std::string a = argv[i];
+        double lo = 0, hi = 0;
+        if (a == "--models" && i + 1 < argc)          { modelNames = splitList(argv[++i]); }
+        else if (a == "--window" && i + 1 < argc)     { ok = parseRange(argv[++i], lo, hi); windows.push_back({lo, hi}); }
+        else if (a == "--by-category")                { byCategory = true; }
+        else if (a == "--category" && i + 1 < argc)   { category = std::atoi(argv[++i]); }
+        else if (a == "--fit-range" && i + 1 < argc)  { ok = parseRange(argv[++i], opts.fitLow, opts.fitHigh); }
+        else if (a == "--blind" && i + 1 < argc)      { ok = parseRange(argv[++i], opts.blindLow, opts.blindHigh); }
+        else if (a == "--threads" && i + 1 < argc)    { opts.threads = std::max(1, std::atoi(argv[++i])); }
+        else if (!a.empty() && a[0] != '-')           { inputs.push_back(a); }
+        else ok = false;
+    }
+    std::vector<BkgModel> models;
+    for (auto& name : modelNames) {
+        BkgModel m;
+        if (!parseBkgModel(name, m)) {
+            std::cerr << "ERROR: Unknown model '" << name << "' (exp, pow, bern1 ... bern8)" << std::endl;
+            return 1;
+        }
+        models.push_back(m);
+    }
+    if (!ok || inputs.empty() || models.empty()) {
+        std::cerr << "Usage: sideband_fit EXPORT.hhub... [--models LIST] [--window LO:HI ...]\n"
+                     "                    [--by-category | --category N] [--fit-range LO:HI]\n"
+                     "                    [--blind LO:HI] [--threads N]" << std::endl;
+        return 1;
+    }
+    if (windows.empty()) windows.push_back({opts.blindLow, opts.blindHigh});
+
+    auto t0 = std::chrono::steady_clock::now();
+    int nFits = 0;
+    for (auto& path : inputs) {
+        UnbinnedFile file(path);
+        if (!file.isOpen()) {
+            std::cerr << "ERROR: " << file.getError() << std::endl;
+            return 1;
+        }
+        ColumnSpan<double> mgg = file.mgg(), weight = file.weight();
+        ColumnSpan<unsigned char> cat = file.category();
+
+        // -1: all events; otherwise one MultiBDT category at a time
+        std::vector<int> selections;
+        if (byCategory) selections = {0, 1, 2, 3};
+        else            selections = {category};
+        for (int sel : selections) {
+            std::vector<double> m, w;
+            if (sel >= 0) {
+                for (std::size_t i = 0; i < mgg.size(); ++i) {
+                    if (cat[i] != sel) continue;
+                    m.push_back(mgg[i]);
+                    w.push_back(weight[i]);
+                }
+            }
+            SidebandFitter fitter(sel >= 0 ? ColumnSpan<double>(m.data(), m.size()) : mgg,
+                                  sel >= 0 ? ColumnSpan<double>(w.data(), w.size()) : weight, opts);
+            std::cout << file.getScheme() << (sel >= 0 ? ", category " + std::to_string(sel) : "")
+                      << ": " << fitter.getEvents() << " sideband events, sum w " << fitter.getSumW()
+                      << " (" << path << ")\n";
+            if (fitter.getEvents() == 0) continue;
+            for (auto& model : models) {
+                printFit(fitter, fitter.fit(model), windows);
+                ++nFits;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << nFits << " fit(s) in " << std::setprecision(3) << seconds * 1e3 << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Projections of the sparse store written by run_analysis --sparse: 1D or 2D
+// distributions of any stored axis with range cuts on the others, without
+// rerunning the event loop.
+//
+// Usage: sparse_query STORE [--list] [--scheme KEY] --x AXIS [--y AXIS]
+//                     [--cut AXIS:LO:HI ...] [--root FILE]
+//
+// A cut keeps the bins whose centre lies in [LO, HI); LO / HI may be -inf /
+// inf. Without --scheme the first scheme of the store is used. --root writes
+// the projection as TH1D / TH2D.
+
+#include "SparseHist.h"
+#include "Plotter.h"
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+// AXIS:LO:HI; the axis name itself has no ':'
+static bool parseCut(const SparseHist& store, const std::string& spec, SparseCut& cut) {
+    std::size_t p1 = spec.find(':');
+    std::size_t p2 = p1 == std::string::npos ? p1 : spec.find(':', p1 + 1);
+    if (p2 == std::string::npos) return false;
+    cut.axis = store.findAxis(spec.substr(0, p1));
+    if (cut.axis < 0) return false;
+    std::string lo = spec.substr(p1 + 1, p2 - p1 - 1), hi = spec.substr(p2 + 1);
+    char* end = nullptr;
+    cut.lo = std::strtod(lo.c_str(), &end);
+    if (lo.empty() || *end != '\0') return false;
+    cut.hi = std::strtod(hi.c_str(), &end);
+    return !hi.empty() && *end == '\0';
+}
+
+static void printProjection(const FastHist1D& h) {
+    const auto& sumw = h.getSumw();
+    const auto& sumw2 = h.getSumw2();
+    double width = (h.getXmax() - h.getXmin()) / h.getNbins();
+    double total = 0;
+    std::cout << std::setw(12) << "low" << std::setw(12) << "high" << std::setw(14) << "sum w"
+              << std::setw(14) << "error" << "\n";
+    for (int b = 0; b <= h.getNbins() + 1; ++b) {
+        total += sumw[b];
+        if (sumw[b] == 0 && sumw2[b] == 0) continue;
+        double lo = b == 0 ? -INFINITY : h.getXmin() + (b - 1) * width;
+        double hi = b == h.getNbins() + 1 ? INFINITY : h.getXmin() + b * width;
+        std::cout << std::setw(12) << lo << std::setw(12) << hi << std::setw(14) << sumw[b]
+                  << std::setw(14) << std::sqrt(sumw2[b]) << "\n";
+    }
+    std::cout << "Total: " << total << " (" << h.getEntries() << " entries)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string path, schemeKey, xName, yName, rootFile;
+    std::vector<std::string> cutSpecs;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--list")                         { list = true; }
+        else if (a == "--scheme" && i + 1 < argc)  { schemeKey = argv[++i]; }
+        else if (a == "--x" && i + 1 < argc)       { xName = argv[++i]; }
+        else if (a == "--y" && i + 1 < argc)       { yName = argv[++i]; }
+        else if (a == "--cut" && i + 1 < argc)     { cutSpecs.push_back(argv[++i]); }
+        else if (a == "--root" && i + 1 < argc)    { rootFile = argv[++i]; }
+        else if (!a.empty() && a[0] != '-' && path.empty()) { path = a; }
+        else {
+            path.clear();
+            break;
+        }
+    }
+    if (path.empty() || (!list && xName.empty())) {
+        std::cerr << "Usage: sparse_query STORE [--list] [--scheme KEY] --x AXIS [--y AXIS]\n"
+                     "                    [--cut AXIS:LO:HI ...] [--root FILE]" << std::endl;
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::map<std::string, SparseHist> stores;
+    if (!loadSparseStores(path, stores)) return 1;
+    if (stores.empty()) {
+        std::cerr << "ERROR: " << path << " holds no scheme" << std::endl;
+        return 1;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    if (list) {
+        for (auto& [key, store] : stores) {
+            std::cout << key << ": " << store.getEntries() << " entries, " << store.getOccupiedCells()
+                      << " occupied cells, " << store.getMemoryBytes() / 1024.0 << " kB\n";
+        }
+        const SparseHist& first = stores.begin()->second;
+        for (auto& ax : first.getAxes()) {
+            std::cout << "  axis " << ax.name << ": " << ax.nbins << " bins [" << ax.xmin << ", "
+                      << ax.xmax << ")\n";
+        }
+        if (xName.empty()) return 0;
+    }
+
+    auto it = schemeKey.empty() ? stores.begin() : stores.find(schemeKey);
+    if (it == stores.end()) {
+        std::cerr << "ERROR: Scheme '" << schemeKey << "' not in " << path << std::endl;
+        return 1;
+    }
+    const SparseHist& store = it->second;
+    int x = store.findAxis(xName);
+    int y = yName.empty() ? -1 : store.findAxis(yName);
+    if (x < 0 || (!yName.empty() && (y < 0 || y == x))) {
+        std::cerr << "ERROR: Unknown or repeated axis (see --list)" << std::endl;
+        return 1;
+    }
+    std::vector<SparseCut> cuts;
+    for (auto& spec : cutSpecs) {
+        SparseCut cut;
+        if (!parseCut(store, spec, cut)) {
+            std::cerr << "ERROR: Bad cut '" << spec << "' (AXIS:LO:HI)" << std::endl;
+            return 1;
+        }
+        cuts.push_back(cut);
+    }
+
+    auto t2 = std::chrono::steady_clock::now();
+    FastHist1D h1;
+    FastHist2D h2;
+    if (y < 0) h1 = store.project1D(x, cuts);
+    else       h2 = store.project2D(x, y, cuts);
+    auto t3 = std::chrono::steady_clock::now();
+
+    std::cout << "Scheme " << it->first << ", " << store.getOccupiedCells() << " occupied cells\n";
+    if (y < 0) {
+        printProjection(h1);
+    } else {
+        double total = 0;
+        for (double v : h2.getSumw()) total += v;
+        std::cout << xName << " vs " << yName << ": " << h2.getNbinsX() << " x " << h2.getNbinsY()
+                  << " bins, total " << total << " (" << h2.getEntries() << " entries)" << std::endl;
+    }
+
+    if (!rootFile.empty()) {
+        std::string dir = rootFile.find('/') == std::string::npos
+                              ? "." : rootFile.substr(0, rootFile.rfind('/'));
+        Plotter plotter(dir);
+        std::unique_ptr<TFile> out(TFile::Open(rootFile.c_str(), "RECREATE"));
+        if (!out || out->IsZombie()) {
+            std::cerr << "ERROR: Cannot write " << rootFile << std::endl;
+            return 1;
+        }
+        out->cd();
+        if (y < 0) plotter.toTH1(h1)->Write();
+        else       plotter.toTH2(h2)->Write();
+        out->Close();
+        std::cout << "Wrote " << rootFile << std::endl;
+    }
+
+    std::cerr << "Load " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+              << " ms, projection " << std::chrono::duration<double, std::milli>(t3 - t2).count()
+              << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Toy-MC / bootstrap study on the files of run_analysis --export-unbinned:
+// distribution of a window count (or of its excess over a sideband fit) in
+// pseudo-experiments, and the p-value of the observed value (see ToyMC.h).
+//
+// Usage: toy_study EXPORT.hhub [--mode model|bootstrap] [--model NAME]
+//                  [--statistic count|excess] [--toys N] [--seed S] [--threads N]
+//                  [--window LO:HI] [--category N] [--observed X]
+//                  [--fit-range LO:HI] [--blind LO:HI] [--output FILE]
+//
+// --observed defaults to the statistic of the input itself (meaningful only
+// for unblinded windows). --output writes one line per toy: statistic,
+// window, signal-region and sideband counts.
+
+#include "ToyMC.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+static bool parseRange(const std::string& s, double& lo, double& hi) {
+    std::size_t colon = s.find(':');
+    if (colon == std::string::npos) return false;
+    char* end = nullptr;
+    lo = std::strtod(s.c_str(), &end);
+    if (end != s.c_str() + colon) return false;
+    hi = std::strtod(s.c_str() + colon + 1, &end);
+    return *end == '\0' && hi > lo;
+}
+
+int main(int argc, char** argv) {
+    ToyOptions opts;
+    opts.model = {BkgShape::Exponential, 0};
+    std::string input, output, observedText;
+    int category = -1;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        std::string a = argv[i];
+        if (a == "--mode" && i + 1 < argc)            { ok = parseToyMode(argv[++i], opts.mode); }
+        else if (a == "--model" && i + 1 < argc)      { ok = parseBkgModel(argv[++i], opts.model); }
+        else if (a == "--statistic" && i + 1 < argc)  { ok = parseToyStatistic(argv[++i], opts.statistic); }
+        else if (a == "--toys" && i + 1 < argc)       { opts.nToys = std::atoll(argv[++i]); }
+        else if (a == "--seed" && i + 1 < argc)       { opts.seed = std::strtoull(argv[++i], nullptr, 10); }
+        else if (a == "--threads" && i + 1 < argc)    { opts.threads = std::max(0, std::atoi(argv[++i])); }
+        else if (a == "--window" && i + 1 < argc)     { ok = parseRange(argv[++i], opts.windowLow, opts.windowHigh); }
+        else if (a == "--category" && i + 1 < argc)   { category = std::atoi(argv[++i]); }
+        else if (a == "--observed" && i + 1 < argc)   { observedText = argv[++i]; }
+        else if (a == "--fit-range" && i + 1 < argc)  { ok = parseRange(argv[++i], opts.fit.fitLow, opts.fit.fitHigh); }
+        else if (a == "--blind" && i + 1 < argc)      { ok = parseRange(argv[++i], opts.fit.blindLow, opts.fit.blindHigh); }
+        else if (a == "--output" && i + 1 < argc)     { output = argv[++i]; }
+        else if (!a.empty() && a[0] != '-' && input.empty()) { input = a; }
+        else ok = false;
+    }
+    if (!ok || input.empty()) {
+        std::cerr << "Usage: toy_study EXPORT.hhub [--mode model|bootstrap] [--model NAME]\n"
+                     "                 [--statistic count|excess] [--toys N] [--seed S] [--threads N]\n"
+                     "                 [--window LO:HI] [--category N] [--observed X]\n"
+                     "                 [--fit-range LO:HI] [--blind LO:HI] [--output FILE]" << std::endl;
+        return 1;
+    }
+
+    UnbinnedFile file(input);
+    if (!file.isOpen()) {
+        std::cerr << "ERROR: " << file.getError() << std::endl;
+        return 1;
+    }
+    ColumnSpan<double> mgg = file.mgg(), weight = file.weight();
+    std::vector<double> m, w;
+    if (category >= 0) {
+        ColumnSpan<unsigned char> cat = file.category();
+        for (std::size_t i = 0; i < mgg.size(); ++i) {
+            if (cat[i] != category) continue;
+            m.push_back(mgg[i]);
+            w.push_back(weight[i]);
+        }
+        mgg = ColumnSpan<double>(m.data(), m.size());
+        weight = ColumnSpan<double>(w.data(), w.size());
+    }
+
+    EventSelector selector;
+    ToyResult r = runToys(opts, mgg, weight, selector);
+    if (!r.ok) {
+        std::cerr << "ERROR: " << r.error << std::endl;
+        return 1;
+    }
+
+    double observed = observedText.empty() ? r.data.statistic : std::atof(observedText.c_str());
+    double mean = 0, sq = 0, sr = 0, sb = 0;
+    for (auto& t : r.toys) {
+        if (t.failed) continue;
+        mean += t.statistic;
+        sq += t.statistic * t.statistic;
+        sr += t.signalRegion;
+        sb += t.sidebands;
+    }
+    double n = static_cast<double>(r.nUsable());
+    if (n > 0) {
+        mean /= n;
+        sr /= n;
+        sb /= n;
+    }
+    double rms = n > 0 ? std::sqrt(std::max(0.0, sq / n - mean * mean)) : 0;
+
+    std::cout << file.getScheme() << (category >= 0 ? ", category " + std::to_string(category) : "")
+              << ": " << mgg.size() << " events, "
+              << (opts.mode == ToyMode::Model ? "model (" + bkgModelName(opts.model) + ")" : std::string("bootstrap"))
+              << " toys, statistic "
+              << (opts.statistic == ToyStatistic::Count ? "count" : "excess over " + bkgModelName(opts.model) + " fit")
+              << " in [" << opts.windowLow << ", " << opts.windowHigh << ")\n";
+    std::cout << "Data:  window " << r.data.window << ", signal region " << r.data.signalRegion
+              << ", sidebands " << r.data.sidebands << ", statistic " << r.data.statistic << "\n";
+    std::cout << "Toys:  " << r.toys.size();
+    if (r.nFailed > 0) {
+        std::cout << " (" << r.nFailed << " = " << 100.0 * r.nFailed / r.toys.size()
+                  << "% left out: fit did not converge)";
+    }
+    std::cout << ", mean statistic " << mean << " +- " << rms
+              << ", mean signal region " << sr << ", mean sidebands " << sb << "\n";
+    std::cout << "Quantiles: 2.5% " << r.quantile(0.025) << ", 16% " << r.quantile(0.16) << ", 50% "
+              << r.quantile(0.5) << ", 84% " << r.quantile(0.84) << ", 97.5% " << r.quantile(0.975) << "\n";
+    std::cout << "p-value of " << observed << ": " << r.pValue(observed);
+    if (r.pValue(observed) == 0) std::cout << " (< " << 1.0 / std::max(1.0, n) << ")";
+    std::cout << "\n" << std::setprecision(4) << r.seconds << " s, " << r.toysPerSecond << " toys/s" << std::endl;
+
+    if (!output.empty()) {
+        std::ofstream out(output);
+        out << "# statistic window signal_region sidebands converged\n";
+        out << std::setprecision(10);
+        for (auto& t : r.toys) {
+            out << t.statistic << " " << t.window << " " << t.signalRegion << " " << t.sidebands << " "
+                << !t.failed << "\n";
+        }
+        if (!out) {
+            std::cerr << "ERROR: Cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}